@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <carma/carma.h>
+#include <carma/carma_string.h>
+
+#include "mang_lang.h"
+#include "mang_lang_string.h"
+
+// Transpiles a Manglang program to a C++ program, that is compiled and linked with manglang_lib.
+// With --test it also compiles and runs the transpiled programs,
+// and checks that they give the same result as the interpreter.
+
+namespace CommandLineArgumentIndex {
+    enum {PROGRAM_PATH, INPUT_PATH, OUTPUT_PATH};
+}
+
+StringBuilder makeOutputFilePath(const char* input_file_path, const char* suffix) {
+    auto result = StringBuilder{};
+    SERIALIZE_CSTRING(result, input_file_path);
+    DROP_BACK_UNTIL_ITEM(result, '.');
+    DROP_BACK(result);
+    SERIALIZE_CSTRING(result, suffix);
+    APPEND(result, '\0');
+    return result;
+}
+
+bool writeTextFile(const char* path, const char* text) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fprintf(file, "%s", text);
+    return fclose(file) == 0;
+}
+
+bool transpileFile(const char* input_file_path, const char* output_file_path) {
+    auto code = read_text_file(input_file_path);
+    if (IS_EMPTY(code)) {
+        perror("Error reading file");
+        return false;
+    }
+    auto program = transpile(code.data);
+    APPEND(program, '\0');
+    const auto ok = writeTextFile(output_file_path, program.data);
+    if (!ok) {
+        perror("Error writing file");
+    }
+    FREE_DARRAY(program);
+    FREE_DARRAY(code);
+    return ok;
+}
+
+// The files of --test are written to the build, instead of next to the programs.
+StringBuilder makeTestFilePath(const char* input_file_path, const char* suffix) {
+    auto file_name = input_file_path;
+    for (auto c = input_file_path; *c != '\0'; ++c) {
+        if (*c == '/' || *c == '\\') {
+            file_name = c + 1;
+        }
+    }
+    auto result = StringBuilder{};
+    SERIALIZE_CSTRING(result, MANGLANG_AOT_OUTPUT_DIR);
+    APPEND(result, '/');
+    SERIALIZE_CSTRING(result, file_name);
+    APPEND(result, '\0');
+    const auto path = makeOutputFilePath(result.data, suffix);
+    FREE_DARRAY(result);
+    return path;
+}
+
+bool compileFile(const char* source_path, const char* executable_path) {
+    const auto command = format_cstring(
+        "%s -std=c++20 -O2 %s -I %s -I %s %s %s -o %s",
+        MANGLANG_AOT_COMPILER,
+        source_path,
+        MANGLANG_AOT_INCLUDE_LIB,
+        MANGLANG_AOT_INCLUDE_CARMA,
+        MANGLANG_AOT_LIBRARY,
+        MANGLANG_AOT_LINK_LIBRARIES,
+        executable_path
+    );
+    const auto ok = system(command) == 0;
+    free((void*)command);
+    if (!ok) {
+        printf("Could not compile %s\n", source_path);
+    }
+    return ok;
+}
+
+bool runFile(const char* executable_path, const char* result_path) {
+    const auto command = format_cstring("%s > %s", executable_path, result_path);
+    const auto ok = system(command) == 0;
+    free((void*)command);
+    if (!ok) {
+        printf("Could not run %s\n", executable_path);
+    }
+    return ok;
+}
+
+bool isSameResult(const char* input_file_path, const char* result_path) {
+    auto actual = read_text_file(result_path);
+    auto code = read_text_file(input_file_path);
+    auto expected = evaluate_all(code.data);
+    APPEND(expected, '\0');
+    const auto ok = strcmp(actual.data ? actual.data : "", expected.data) == 0;
+    if (!ok) {
+        printf("%s gives a different result when it is transpiled.\n", input_file_path);
+    }
+    FREE_DARRAY(expected);
+    FREE_DARRAY(code);
+    FREE_DARRAY(actual);
+    return ok;
+}
+
+bool testFile(const char* input_file_path) {
+    auto source_path = makeTestFilePath(input_file_path, "_transpiled.cpp");
+    auto executable_path = makeTestFilePath(input_file_path, "_transpiled");
+    auto result_path = makeTestFilePath(input_file_path, "_transpiled.txt");
+    const auto ok =
+        transpileFile(input_file_path, source_path.data) &&
+        compileFile(source_path.data, executable_path.data) &&
+        runFile(executable_path.data, result_path.data) &&
+        isSameResult(input_file_path, result_path.data);
+    FREE_DARRAY(result_path);
+    FREE_DARRAY(executable_path);
+    FREE_DARRAY(source_path);
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && strcmp(argv[1], "--test") == 0) {
+        auto successes = 0;
+        for (auto i = 2; i < argc; ++i) {
+            successes += testFile(argv[i]);
+        }
+        printf("%d/%d transpiled programs successful.\n", successes, argc - 2);
+        return successes == argc - 2 ? 0 : 1;
+    }
+    if (argc < CommandLineArgumentIndex::INPUT_PATH + 1) {
+        printf("Expected input file.\n");
+        return 1;
+    }
+    const auto input_file_path = argv[CommandLineArgumentIndex::INPUT_PATH];
+    const auto default_output_file_path = makeOutputFilePath(input_file_path, "_transpiled.cpp");
+    const auto output_file_path = argc > CommandLineArgumentIndex::OUTPUT_PATH ?
+        argv[CommandLineArgumentIndex::OUTPUT_PATH] : default_output_file_path.data;
+    printf("Transpiling %s to %s ... ", input_file_path, output_file_path);
+    if (!transpileFile(input_file_path, output_file_path)) {
+        exit(EXIT_FAILURE);
+    }
+    printf("Done.\n");
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <time.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include <carma/carma.h>
 #include <carma/carma_string.h>
@@ -8,24 +9,86 @@
 #include "mang_lang.h"
 #include "mang_lang_string.h"
 
-namespace CommandLineArgumentIndex {
-    enum {PROGRAM_PATH, INPUT_PATH, OUTPUT_PATH};
+namespace Mode {
+    enum {EAGER, LAZY, PARALLEL, JIT, INTERN};
 }
 
-StringBuilder parseInputFilePath(int argc,  char **argv) {
+struct Flag {
+    const char* name;
+    int mode;
+};
+
+const Flag FLAGS[] = {
+    {"--lazy", Mode::LAZY},
+    {"--parallel", Mode::PARALLEL},
+    {"--jit", Mode::JIT},
+    {"--intern", Mode::INTERN},
+};
+
+struct CommandLine {
+    int mode;
+    const char* mode_flag;
+    const char* input_path;
+    const char* output_path;
+};
+
+// Flags can come before or after the paths, but only one of them can be given,
+// since the modes are not made to be combined.
+bool parseCommandLine(int argc, char **argv, CommandLine& command_line) {
+    command_line = CommandLine{Mode::EAGER, nullptr, nullptr, nullptr};
+    for (int i = 1; i < argc; ++i) {
+        const auto argument = argv[i];
+        if (strncmp(argument, "--", 2) != 0) {
+            if (!command_line.input_path) {
+                command_line.input_path = argument;
+            } else if (!command_line.output_path) {
+                command_line.output_path = argument;
+            } else {
+                printf("Unexpected argument %s.\n", argument);
+                return false;
+            }
+            continue;
+        }
+        const Flag* flag = nullptr;
+        for (const auto& f : FLAGS) {
+            if (strcmp(argument, f.name) == 0) {
+                flag = &f;
+            }
+        }
+        if (!flag) {
+            printf("Unknown flag %s. Expected --lazy, --parallel, --jit or --intern.\n", argument);
+            return false;
+        }
+        if (command_line.mode_flag) {
+            printf("Expected at most one of --lazy, --parallel, --jit and --intern, but got %s and %s.\n",
+                command_line.mode_flag, argument
+            );
+            return false;
+        }
+        command_line.mode = flag->mode;
+        command_line.mode_flag = flag->name;
+    }
+    if (!command_line.input_path) {
+        printf("Expected input file.\n");
+        return false;
+    }
+    return true;
+}
+
+StringBuilder parseInputFilePath(const CommandLine& command_line) {
     auto result = StringBuilder{};
-    SERIALIZE_CSTRING(result, argv[CommandLineArgumentIndex::INPUT_PATH]);
+    SERIALIZE_CSTRING(result, command_line.input_path);
     APPEND(result, '\0');
     return result;
 }
 
-StringBuilder parseOutputFilePath(int argc,  char **argv) {
+StringBuilder parseOutputFilePath(const CommandLine& command_line) {
     auto result = StringBuilder{};
-    if (argc >= CommandLineArgumentIndex::OUTPUT_PATH + 1) {
-        SERIALIZE_CSTRING(result, argv[CommandLineArgumentIndex::OUTPUT_PATH]);
+    if (command_line.output_path) {
+        SERIALIZE_CSTRING(result, command_line.output_path);
     }
     else {
-        SERIALIZE_CSTRING(result, argv[CommandLineArgumentIndex::INPUT_PATH]);
+        SERIALIZE_CSTRING(result, command_line.input_path);
         DROP_BACK_UNTIL_ITEM(result, '.');
         DROP_BACK(result);
         SERIALIZE_CSTRING(result, "_evaluated.txt");
@@ -34,14 +97,24 @@ StringBuilder parseOutputFilePath(int argc,  char **argv) {
     return result;
 }
 
+StringBuilder evaluate(int mode, const char* code) {
+    switch (mode) {
+        case Mode::LAZY: return evaluate_lazy(code);
+        case Mode::PARALLEL: return evaluate_parallel(code);
+        case Mode::JIT: return evaluate_jit(code);
+        case Mode::INTERN: return evaluate_interned(code);
+        default: return evaluate_all(code);
+    }
+}
+
 int main(int argc,  char **argv) {
     using namespace std;
-    if (argc < CommandLineArgumentIndex::INPUT_PATH + 1) {
-        printf("Expected input file.\n");
+    auto command_line = CommandLine{};
+    if (!parseCommandLine(argc, argv, command_line)) {
         return 1;
     }
-    auto input_file_path = parseInputFilePath(argc, argv);
-    auto output_file_path = parseOutputFilePath(argc, argv);
+    auto input_file_path = parseInputFilePath(command_line);
+    auto output_file_path = parseOutputFilePath(command_line);
     
     printf("Reading program from %s ... ",  input_file_path.data);
     auto code = read_text_file(input_file_path.data);
@@ -53,7 +126,7 @@ int main(int argc,  char **argv) {
     
     printf("Evaluating program ... ");
     const clock_t start = clock();
-    const auto result = evaluate_all(code.data);
+    const auto result = evaluate(command_line.mode, code.data);
     const double duration_total = (double)(clock() - start) / CLOCKS_PER_SEC;
     printf("Done in %.1f seconds.\n", duration_total);
     
@@ -4,7 +4,9 @@
 
 #include "exceptions.h"
 #include "factory.h"
+#include "jit.h"
 #include "mang_lang.h"
+#include "workers.h"
 
 typedef struct TestCase {
     const char* input;
@@ -87,6 +89,51 @@ void testEvaluateTypes(const char* case_name, TestCases test_cases) {
 
 void testEvaluateAll(const char* case_name, TestCases test_cases) {
     parameterizedTest(evaluate_all, "evaluate_all", case_name, test_cases);
+    parameterizedTest(evaluate_lazy, "evaluate_lazy", case_name, test_cases);
+    parameterizedTest(evaluate_interned, "evaluate_interned", case_name, test_cases);
+    parameterizedTest(evaluate_parallel, "evaluate_parallel", case_name, test_cases);
+}
+
+void testEvaluateParallel(const char* case_name, TestCases test_cases) {
+    parameterizedTest(evaluate_parallel, "evaluate_parallel", case_name, test_cases);
+}
+
+void testEvaluateJit(const char* case_name, TestCases test_cases) {
+    parameterizedTest(evaluate_jit, "evaluate_jit", case_name, test_cases);
+}
+
+// Describes the hot functions instead of the result,
+// so that the tests notice when the JIT only interprets them.
+StringBuilder evaluateJitStatistics(const char* code) {
+    auto result = evaluate_jit(code);
+    const auto statistics = getJitStatistics();
+    result.count = 0;
+    result = concatenate(result, "compiled ");
+    result = concatenate(result, statistics.compiled_functions > 0 ? "yes" : "no");
+    result = concatenate(result, ", interpreted ");
+    result = concatenate(result, statistics.interpreted_functions > 0 ? "yes" : "no");
+    APPEND(result, '\0');
+    return result;
+}
+
+void testEvaluateJitStatistics(const char* case_name, TestCases test_cases) {
+    parameterizedTest(evaluateJitStatistics, "evaluate_jit", case_name, test_cases);
+}
+
+// Evaluates the code twice and describes the second result and the memo caches that are left,
+// so that the tests notice when clearing the memory keeps the caches of the first program.
+StringBuilder evaluateTwice(const char* code) {
+    auto first = evaluate_all(code);
+    FREE_DARRAY(first);
+    auto result = evaluate_all(code);
+    result = concatenate(result, ", memo caches ");
+    result = concatenate(result, storage.memo_caches.empty() ? "none" : "some");
+    APPEND(result, '\0');
+    return result;
+}
+
+void testEvaluateTwice(const char* case_name, TestCases test_cases) {
+    parameterizedTest(evaluateTwice, "evaluate_all", case_name, test_cases);
 }
 
 int main() {
@@ -255,6 +302,112 @@ int main() {
         {"<(inc!0 inc!1)>", "<(1 2)>"},
         {"<(3 6) (4 8) (1 2) (2 4)>","<(1 2) (2 4) (3 6) (4 8)>"}
     ));
+    testEvaluateTypes("deque", TEST_CASES(
+        {"deque![]", "deque![]"},
+        {"deque![1 2]", "deque![NUMBER]"},
+        {"deque!\"ab\"", "deque![CHARACTER]"},
+        {"put!(1 deque![])", "deque![NUMBER]"},
+        {"take!deque![1 2]", "NUMBER"},
+        {"deque!1", "I found an error during type checking.\nThe deque function received a NUMBER, which it did not expect."},
+    ));
+    testEvaluateAll("deque", TEST_CASES(
+        {"deque![]", "deque![]"},
+        {"deque![1 2]", "deque![1 2]"},
+        {"deque!range!3", "deque![0 1 2]"},
+        {"put!(3 deque![1 2])", "deque![1 2 3]"},
+        {"take!deque![1 2]", "1"},
+        {"drop!deque![1 2]", "deque![2]"},
+        {"drop!deque![]", "deque![]"},
+        {"clear!deque![1 2]", "deque![]"},
+        {"x@{d=deque![1 2] x=d!1}", "2"},
+        {"a@{d=deque![1] a=put!(2 d) b=put!(3 d)}", "deque![1 2]"},
+        {"b@{d=deque![1] a=put!(2 d) b=put!(3 d)}", "deque![1 3]"},
+        {"q@{q=deque![1 2] q-- q+=3 q+=4 q--}", "deque![3 4]"},
+        {"equal?(deque![1 2] deque![1 2])", "yes"},
+        {"equal?(deque![1 2] deque![1])", "no"},
+        {"if deque![] then 1 else 0", "0"},
+        {"a@{d=deque![1] a=d!dynamic {}}", "\n\nI have found a dynamic type error.\nIt happens when indexing a deque.\nThe index is expected to be a NUMBER,\nbut now it is an EVALUATED_DICTIONARY.\n"},
+        {"deque!dynamic {}", "I found an error during evaluation.\nThe deque function received an EVALUATED_DICTIONARY, which it did not expect."},
+    ));
+    testEvaluateTypes("set", TEST_CASES(
+        {"set![]", "set![]"},
+        {"set![1 2]", "set![NUMBER]"},
+        {"put!(1 set![])", "set![NUMBER]"},
+        {"take!set![1 2]", "NUMBER"},
+        {"union!(set![1] set![2])", "set![NUMBER]"},
+    ));
+    testEvaluateAll("set", TEST_CASES(
+        {"set![]", "set![]"},
+        {"set![1 2 1]", "set![1 2]"},
+        {"set!\"abba\"", "set!['a' 'b']"},
+        {"set!range!3", "set![0 1 2]"},
+        {"put!(3 set![1 2])", "set![1 2 3]"},
+        {"put!(2 set![1 2])", "set![1 2]"},
+        {"put!([1 2] set![[1 2]])", "set![[1 2]]"},
+        {"take!set![1 2]", "1"},
+        {"drop!set![1 2]", "set![2]"},
+        {"drop!set![]", "set![]"},
+        {"clear!set![1 2]", "set![]"},
+        {"contains!(2 set![1 2])", "yes"},
+        {"contains!(3 set![1 2])", "no"},
+        {"contains!(\"ab\" set![\"ab\" \"cd\"])", "yes"},
+        {"contains!((1 2) set![(1 2)])", "yes"},
+        {"contains!(1 drop!set![1 2])", "no"},
+        {"a@{s=set![1] a=put!(2 s) b=put!(3 s)}", "set![1 2]"},
+        {"b@{s=set![1] a=put!(2 s) b=put!(3 s)}", "set![1 3]"},
+        {"s@{s=set![] c=[1 2 1 3] for i in c s+=i end}", "set![1 2 3]"},
+        {"union!(set![1 2] set![2 3])", "set![1 2 3]"},
+        {"intersection!(set![1 2] set![2 3])", "set![2]"},
+        {"difference!(set![1 2] set![2 3])", "set![1]"},
+        {"equal?(set![1 2] set![2 1])", "yes"},
+        {"equal?(set![1 2] set![1])", "no"},
+        {"if set![] then 1 else 0", "0"},
+        {"s@{t=<> s=set![t]}", "I found an error during evaluation.\nA set can not contain tables or grids, since they can change."},
+        {"s@{t=<> s=put!((1 t) set![])}", "I found an error during evaluation.\nA set can not contain tables or grids, since they can change."},
+        {"s@{g=grid!(1 1 0) s=set![] s+=[g]}", "I found an error during evaluation.\nA set can not contain tables or grids, since they can change."},
+        {"contains!(1 [1])", "I found an error during type checking.\nThe contains function expected a set, but it got an EVALUATED_STACK."},
+        {"contains!(1 \"a\")", "I found an error during type checking.\nThe contains function expected a set, but it got a STRING."},
+        {"set!dynamic 1", "I found an error during evaluation.\nThe set function received a NUMBER, which it did not expect."},
+    ));
+    testEvaluateTypes("grid", TEST_CASES(
+        {"grid![]", "[]"},
+        {"grid![[1 2] [3 4]]", "[[NUMBER]]"},
+        {"grid!\"ab\ncd\"", "[[CHARACTER]]"},
+        {"grid!(2 3 0)", "[[NUMBER]]"},
+        {"rows!grid![[1 2]]", "[[NUMBER]]"},
+        {"get!((0 0) grid![[1 2]] 0)", "NUMBER"},
+    ));
+    testEvaluateAll("grid", TEST_CASES(
+        {"grid![]", "[]"},
+        {"grid![[1 2] [3 4]]", "[[1 2] [3 4]]"},
+        {"grid![\"ab\" \"cd\"]", "[['a' 'b'] ['c' 'd']]"},
+        {"grid!\"ab\ncd\"", "[['a' 'b'] ['c' 'd']]"},
+        {"grid!\"ab\ncd\n\"", "[['a' 'b'] ['c' 'd']]"},
+        {"grid!(3 2 0)", "[[0 0 0] [0 0 0]]"},
+        {"grid!(-1 2 0)", "I found an error during evaluation.\nThe grid function expected a tuple (width height value) with non-negative width and height, and at most 67108864 cells."},
+        {"grid!(100000 100000 0)", "I found an error during evaluation.\nThe grid function expected a tuple (width height value) with non-negative width and height, and at most 67108864 cells."},
+        {"grid!(100000 0 0)", "[]"},
+        {"grid![[1 2] [3]]", "I found an error during evaluation.\nThe grid function expected rows of the same length, but row 1 has length 1 instead of 2."},
+        {"grid!dynamic [1 2]", "I found an error during evaluation.\nThe grid function expected rows that are stacks or strings, but it got a NUMBER."},
+        {"get!((0 'a') grid![[1 2]] 0)", "I found an error during evaluation.\nThe get function expected a position of two numbers, but it got a NUMBER and a CHARACTER."},
+        {"grid!dynamic 1", "I found an error during evaluation.\nThe grid function received a NUMBER, which it did not expect."},
+        {"get!((1 0) grid![[1 2] [3 4]] 0)", "2"},
+        {"get!((0 1) grid![[1 2] [3 4]] 0)", "3"},
+        {"get!([1 1] grid![[1 2] [3 4]] 0)", "4"},
+        {"get!((2 0) grid![[1 2] [3 4]] 0)", "0"},
+        {"get!((0 -1) grid![[1 2] [3 4]] 0)", "0"},
+        {"x@{g=grid![[1 2] [3 4]] x=g!(1 0)}", "2"},
+        {"put!((1 0 5) grid![[1 2] [3 4]])", "[[1 5] [3 4]]"},
+        {"g@{g=grid!(2 2 0) g+=(0 1 1) g+=(1 0 2)}", "[[0 2] [1 0]]"},
+        {"a@{a=grid!(1 1 0) b=grid!a b+=(0 0 1)}", "[[0]]"},
+        {"rows!grid![[1 2] [3 4]]", "[[1 2] [3 4]]"},
+        {"columns!grid![[1 2] [3 4]]", "[[1 3] [2 4]]"},
+        {"clear!grid![[1 2]]", "[]"},
+        {"equal?(grid![[1 2]] grid![[1 2]])", "yes"},
+        {"equal?(grid![[1 2]] grid![[1] [2]])", "no"},
+        {"if grid![] then 1 else 0", "0"},
+        {"put!((2 0 5) grid![[1 2]])", "Grid position out of range"},
+    ));
     testReformat("tuple", TEST_CASES(
         {"()", "()"},
         {"( )", "()"},
@@ -501,6 +654,15 @@ int main() {
         {"is (1 (2)) (1 (2)) then 1 else 2", "1"},
         {"is (1 (2)) (1 (3)) then 1 else 2", "2"},
     ));
+    testEvaluateAll("is table", TEST_CASES(
+        {"y@{f=in x out is x 'a' then 1 'b' then 2 else 3 y=[f!'a' f!'b' f!'c' f!1]}", "[1 2 3 3]"},
+        {"y@{f=in x out is x \"ab\" then 1 \"\" then 2 else 3 y=[f!\"ab\" f!\"\" f!\"a\" f!'a']}", "[1 2 3 3]"},
+        {"y@{f=in x out is x yes then 1 no then 2 else 3 y=[f!yes f!no f!0]}", "[1 2 3]"},
+        {"y@{f=in x out is x 0 then 1 1 then 2 else 3 y=[f!-0 f!1 f!nan]}", "[1 2 3]"},
+        {"y@{f=in x out is x 1 then 1 1 then 2 else 3 y=[f!1 f!2]}", "[1 3]"},
+        {"y@{f=in x out is x 1 then 1 'a' then 2 \"a\" then 3 [] then 4 else 5 y=[f!1 f!'a' f!\"a\" f![] f![1]]}", "[1 2 3 4 5]"},
+        {"y@{f=in x out is x nan then 1 0 then 2 else 3 y=[f!nan f!0]}", "[3 2]"},
+    ));
     testReformat("symbol", TEST_CASES(
         {"a", "a"},
         {"{a=1 b=a}", "{a=1 b=a}"},
@@ -589,6 +751,110 @@ int main() {
         {"f@{f=in x out x}", "in x out x"},
         {"f@{T=1 f=in T:x out x}", "in T:x out x"}, //TODO:
     ));
+    testEvaluateAll("constant folding", TEST_CASES(
+        {"in x out add!(x mul!(2 3))", "in x out add!(x mul!(2 3))"},
+        {"in x out if yes then inf else x", "in x out if yes then inf else x"},
+        {"y@{f=in x out is 'a' 'b' then 1 'a' then 2 else 3 y=f!0}", "2"},
+        {"{a=b b=add!(1 2) c=b}", "{a=ANY b=3 c=3}"},
+        {"{i=0 while less?(i 3) i=inc!i end j=i}", "{i=3 j=3}"},
+        {"r@{add=in x out 7 r=add!(1 2)}", "7"},
+        {"y@{x=1 f=in x out x y=f!2}", "2"},
+    ));
+    testEvaluateAll("lazy definitions", TEST_CASES(
+        {"r@{unused=fold!(add range!100000 0) r=fold!(add range!10 0)}", "45"},
+        {"r@{x=div!(1 dynamic 'a') r=1}", "1"},
+        {"r@{f=in x out add!(x c) a=f!1 c=2 r=a}", "1"},
+        {"x@{t=<(1 1)> u=put!((1 2) t) x=get!(1 t 0)}", "2"},
+        {"r@{g=grid!(2 1 0) a=get!((0 0) g 9) h=put!((0 0 5) g) r=(get!((0 0) h 9) a)}", "(5 0)"},
+        {"r@{f=in w out grid!(w 1 0) g=f!2 a=get!((0 0) g 9) h=put!((0 0 5) g) r=(get!((0 0) h 9) a)}", "(5 0)"},
+        {"g@{h=in f out f!0 g=h!(in x out g)}", "in x out g"},
+        {"{i=0 s=0 while less?(i 3) s=add!(s i) i=inc!i end r=s}", "{i=3 s=3 r=3}"},
+    ));
+    testEvaluateTypes("memo", TEST_CASES(
+        {"memo!in x out x", "FUNCTION"},
+        {"memo!in (x y) out x", "FUNCTION_TUPLE"},
+        {"memo_statistics!memo!in x out x", "(NUMBER NUMBER)"},
+        {"memo!1", "I found an error during type checking.\nThe memo function received a NUMBER, which it did not expect."},
+    ));
+    testEvaluateAll("memo", TEST_CASES(
+        {"memo!in x out x", "in x out x"},
+        {"y@{f=memo!in x out add!(x 1) y=f!1}", "2"},
+        {"y@{f=memo!in (a b) out sub!(a b) y=f!(3 1)}", "2"},
+        {"y@{f=memo!in n out dynamic if less?(n 2) then n else add!(f!sub!(n 1) f!sub!(n 2)) y=f!60}", "1548008755920"},
+        {"s@{f=memo!in n out dynamic if less?(n 2) then n else add!(f!sub!(n 1) f!sub!(n 2)) y=f!20 s=(y memo_statistics!f)}", "(6765 (18 21))"},
+        {"s@{f=memo!in s out take!s y=f!\"ab\" z=f!\"ab\" s=(y z memo_statistics!f)}", "('a' 'a' (1 1))"},
+        {"s@{f=memo!in d out x@d y=f!{x=1} z=f!{x=1} s=(y z memo_statistics!f)}", "(1 1 (0 0))"},
+        {"r@{f=memo!in x out <(x 0)> a=f!1 b=put!((1 5) a) c=f!1 r=get!(1 c 9)}", "0"},
+        {"r@{f=memo!in x out grid!(2 1 0) a=f!1 b=put!((1 0 5) a) c=f!1 r=get!((1 0) c 9)}", "0"},
+        {"s@{f=memo!in x out <(x 0)> a=f!1 c=f!1 s=memo_statistics!f}", "(0 2)"},
+        {"memo!dynamic 1", "I found an error during evaluation.\nThe memo function received a NUMBER, which it did not expect."},
+        {"memo_statistics!in x out x", "I found an error during evaluation.\nThe memo_statistics function received a FUNCTION, which it did not expect."},
+    ));
+    // More workers than processors, so that the tests fork workers on any machine.
+    setWorkerCount(4);
+    testEvaluateTypes("parallel", TEST_CASES(
+        {"parallel_map!(in x out (x x) [1 2])", "[(NUMBER NUMBER)]"},
+        {"parallel_map!(in x out x \"ab\")", "STRING"},
+        {"parallel_fold!(add [1 2] 0)", "NUMBER"},
+        {"parallel_fold!(add [] 0)", "NUMBER"},
+    ));
+    testEvaluateAll("parallel_map", TEST_CASES(
+        {"parallel_map!(in x out mul!(x x) [1 2 3])", "[1 4 9]"},
+        {"parallel_map!(in x out mul!(x 2) range!10)", "[0 2 4 6 8 10 12 14 16 18]"},
+        {"parallel_map!(in x out x [])", "[]"},
+        {"parallel_map!(in c out c \"abc\")", "\"abc\""},
+        {"parallel_map!(in x out (x [x] \"s\" 0.5 yes) [1 2])", "[(1 [1] \"s\" 0.500000 yes) (2 [2] \"s\" 0.500000 yes)]"},
+        {"parallel_map!(in x out {a=x} [1 2])", "[{a=1} {a=2}]"},
+        {"y@{f=in x out in y out add!(x y) y=map!(in g out g!1 parallel_map!(f [1 2]))}", "[2 3]"},
+        {"sum!parallel_map!(in x out mul!(x x) range!1000)", "332833500"},
+        {"parallel_map!(in x out x 1)", "I found an error during type checking.\nThe parallel_map function received a NUMBER, which it did not expect."},
+        {"r@{t=<> a=parallel_map!(in x out count!put!((x x) t) [1 2 3 4 5 6 7 8]) r=(a count!t)}", "([1 2 3 4 5 6 7 8] 8)"},
+        {"r@{t=<> u=<> a=parallel_map!(in s out count!put!((1 1) s) [t u t u t u t u]) r=(a count!t count!u)}", "([1 1 1 1 1 1 1 1] 1 1)"},
+        {"r@{g=grid!(8 1 0) a=parallel_map!(in x out get!((sub!(x 1) 0) put!((sub!(x 1) 0 x) g) 0) [1 2 3 4 5 6 7 8]) r=(a get!((7 0) g 9))}", "([1 2 3 4 5 6 7 8] 8)"},
+    ));
+    testEvaluateAll("parallel_fold", TEST_CASES(
+        {"parallel_fold!(add range!1001 0)", "500500"},
+        {"parallel_fold!(add [] 0)", "0"},
+        {"parallel_fold!(in (x s) out max!(x s) [3 9 2 7 1] 0)", "9"},
+        {"parallel_fold!(in (x s) out add!(x s) [1 2] 0.5)", "4"},
+        {"parallel_fold!1", "I found a type error while calling the function parallel_fold. The function expected a tuple of three items, but it got a NUMBER"},
+        {"parallel_fold!{}", "I found a type error while calling the function parallel_fold. The function expected a tuple of three items, but it got an EVALUATED_DICTIONARY"},
+        {"parallel_fold!(add 1 0)", "I found an error during type checking.\nThe parallel_fold function received a NUMBER, which it did not expect."},
+        {"r@{t=<> a=parallel_fold!(in (x s) out add!(s count!put!((x x) t)) [1 2 3 4 5 6 7 8] 0) r=(a count!t)}", "(36 8)"},
+        {"r@{g=grid!(1 1 0) a=parallel_fold!(in (x s) out add!(s get!((0 0) put!((0 0 add!(get!((0 0) g 0) 1)) g) 0)) [1 2 3 4 5 6 7 8] 0) r=(a get!((0 0) g 9))}", "(36 8)"},
+    ));
+    testEvaluateParallel("parallel definitions", TEST_CASES(
+        {"{a=add!(1 2) b=mul!(3 4)}", "{a=3 b=12}"},
+        {"{a=add!(1 2) b=mul!(a 4) c=sub!(b a) d=add!(a 1)}", "{a=3 b=12 c=9 d=4}"},
+        {"r@{f=in x out mul!(x x) a=f!3 b=f!4 r=add!(a b)}", "25"},
+        {"{a={x=add!(1 1)} b={y=mul!(2 2)}}", "{a={x=2} b={y=4}}"},
+        {"{a=in x out add!(x 1) b=a!1 c=a!2}", "{a=in x out add!(x 1) b=2 c=3}"},
+        {"{a=[add!(1 2) 3] b=\"ab\" c=(add!(1 1) sqrt!4)}", "{a=[3 3] b=\"ab\" c=(2 2)}"},
+        {"{a=add!(1 2) b=i@{i=0 while less?(i 3) i=inc!i end} c=mul!(a b)}", "{a=3 b=3 c=9}"},
+        {"s@{f=memo!in s out take!s y=f!\"ab\" z=f!\"ab\" s=(y z memo_statistics!f)}", "('a' 'a' (1 1))"},
+        {"s@{f=memo!in s out take!s m=memo_statistics y=f!\"ab\" z=f!\"ab\" s=(y z m!f)}", "('a' 'a' (1 1))"},
+        {"r@{g=grid!(2 1 0) n=get!((0 0) put!((0 0 5) g) 9) m=get!((0 0) g 9) r=(n m)}", "(5 5)"},
+        {"r@{f=in w out grid!(w 1 0) g=f!2 n=get!((0 0) put!((0 0 5) g) 9) m=get!((0 0) g 9) r=(n m)}", "(5 5)"},
+    ));
+    setWorkerCount(0);
+    testEvaluateTwice("memo after clearing memory", TEST_CASES(
+        {"s@{f=memo!in x out add!(x 1) y=f!1 z=f!1 s=(y z memo_statistics!f)}", "(2 2 (1 1)), memo caches none"},
+    ));
+    setJitWaiting(true);
+    testEvaluateJit("jit", TEST_CASES(
+        {"s@{f=in x out mul!(x x) s=0 i=2000 while i s=add!(s f!i) i=dec!i end}", "2668667000"},
+        {"s@{f=in (a b) out c@{c=a d=b for d c=inc!c end} s=0 i=2000 while i s=add!(s f!(i 2)) i=dec!i end}", "2005000"},
+        {"s@{f=in x out if x then yes else no s=0 i=2000 while i s=f!i i=dec!i end}", "yes"},
+    ));
+#ifdef MANGLANG_JIT
+    testEvaluateJitStatistics("jit statistics", TEST_CASES(
+        {"s@{f=in x out mul!(x x) s=0 i=2000 while i s=add!(s f!i) i=dec!i end}", "compiled yes, interpreted no"},
+        {"s@{f=in Number:x out Number:add!(mul!(x 3) 1) s=0 i=2000 while i s=add!(s f!i) i=dec!i end}", "compiled yes, interpreted no"},
+        {"s@{f=in x out if less?(x 5) then 1 else 0 s=0 i=2000 while i s=add!(s f!i) i=dec!i end}", "compiled yes, interpreted no"},
+        {"s@{s=0 i=2000 while i s=add!(s 1) i=sub!(i 1) end}", "compiled no, interpreted no"},
+    ));
+#endif
+    setJitWaiting(false);
     testEvaluateTypes("function dictionary", TEST_CASES(
         {"in {x} out x", "FUNCTION_DICTIONARY"},
         {"in {x y} out x", "FUNCTION_DICTIONARY"},
@@ -658,6 +924,17 @@ int main() {
     testEvaluateAll("recursive function", TEST_CASES(
         {"y@{f=in x out dynamic if x then add!(x f!dec!x) else 0 y=f!3}", "6"},
     ));
+    testEvaluateAll("closure environment", TEST_CASES(
+        {"y@{a=1 b={c={f=in x out add!(a x)}} g=f@c@b y=g!2}", "3"},
+        {"y@{a=1 b={a=2 f=in x out add!(a x)} g=f@b y=g!0}", "2"},
+        {"y@{a=1 f=in x out in z out add!(a z) b={c=0 g=f!0} h=g@b y=h!2}", "3"},
+        {"y@{a=1 f=in x out {b=2 g=in z out add!(x z)} d=f!3 h=g@d y=h!4}", "7"},
+        {"s@{s=0 fs=[1 2 3] for i in fs f=in x out add!(x s) s=f!i end}", "6"},
+        {"y@{a=1 f=in x out a a=2 y=f!0}", "2"},
+        {"a@{T=1 b={c=0 f=in T:x out x} g=f@b a=g!0}", "0"},
+        {"y@{a=1 b={c=2 f=in (x z) out add!(a x)} g=f@b y=g!(1 0)}", "2"},
+        {"y@{b={c=0 f=in x out dynamic if x then add!(x f!dec!x) else 0} g=f@b y=g!3}", "6"},
+    ));
     testReformat("dynamic", TEST_CASES(
         {"dynamic 1", "dynamic 1"},
     ));
@@ -731,6 +1008,12 @@ int main() {
         {"add!(1 0)", "1"},
         {"add!(0 1)", "1"},
         {"add!(-1 +1)", "0"},
+        {"a@{f=in Number:x out Number:add!(x 1) a=f!2}", "3"},
+        {"a@{f=in (x y) out mul!(x y) a=add!(f!(2 3) f!(4 5))}", "26"},
+        {"a@{x=dynamic 2 a=add!(x 1)}", "3"},
+        {"a@{t=(1 2) a=add!t}", "3"},
+        {"add!(1 2 3)", "I found a type error while calling the function add. The function expected a tuple of two items, but it got 3 items."},
+        {"add!(1 'a')", "\n\nI have found a type error.\nIt happens when calling the built-in function add.\nThe function expects to be called with a tuple of two NUMBERs,\nbut now the second item in the tuple is CHARACTER.\n"},
     ));
     testEvaluateAll("mul", TEST_CASES(
         {"mul!(0 1)", "0"},
@@ -765,6 +1048,40 @@ int main() {
         {"less?(0 -1)", "no"},
         {"less?(1 1)", "no"},
         {"less?(-1 -1)", "no"},
+        {"a@{x=1 a=less?(x add!(x 1))}", "yes"},
+    ));
+    testEvaluateAll("numeric", TEST_CASES(
+        {"a@{x=3 y=4 a=add!(mul!(x x) mul!(y y))}", "25"},
+        {"a@{x=7 a=mod!(add!(x 1) 3)}", "2"},
+        {"a@{x=1 y=2 a=less?(add!(x 1) y)}", "no"},
+        {"a@{f=in x out div!(sub!(x 1) 2) a=f!5}", "2"},
+        {"a@{f=in (x y) out sub!(mul!(x 10) y) a=f!(3 4)}", "26"},
+        {"a@{b={x=2} x=5 a=add!(x@b x)}", "7"},
+        {"a@{x=1.5 a=mul!(x sqrt!4)}", "3"},
+        {"a@{x=1 i=0 while less?(i 10) x=mul!(x 2) i=add!(i 1) end a=x}", "1024"},
+        {"a@{x=1 a=add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x add!(x x))))))))))))))))))}", "19"},
+    ));
+    testEvaluateAll("integer", TEST_CASES(
+        {"add!(9007199254740992 1)", "9007199254740993"},
+        {"sub!(-9223372036854775807 1)", "-9223372036854775808"},
+        {"mul!(3037000499 3037000499)", "9223372030926249001"},
+        {"div!(9007199254740993 1)", "9007199254740993"},
+        {"div!(7 2)", "3.500000"},
+        {"mod!(-7 3)", "-1"},
+        {"less?(9007199254740992 9007199254740993)", "yes"},
+        {"a@{x=9007199254740992 a=add!(x 1)}", "9007199254740993"},
+        {"a@{x=2.5 a=mul!(x 2)}", "5"},
+        {"sort![9007199254740993 9007199254740992 1.5]", "[1.500000 9007199254740992 9007199254740993]"},
+        {"[9007199254740992 inc!9007199254740992]", "[9007199254740992 9007199254740993]"},
+        {"r@{a=dynamic -1 r=div!(1 mul!(a 0))}", "-inf"},
+        {"r@{a=dynamic 0 r=div!(1 mul!(a -1))}", "-inf"},
+        {"r@{a=dynamic -1 r=div!(1 mul!(a -1))}", "1"},
+        {"div!(1 div!(0 -5))", "-inf"},
+        {"div!(1 div!(0 5))", "inf"},
+        {"div!(1 mod!(-4 2))", "-inf"},
+        {"div!(1 mod!(4 -2))", "inf"},
+        {"mod!(-5 2)", "-1"},
+        {"r@{a=dynamic -4 b=dynamic 0 r=(div!(1 mod!(a 2)) div!(1 div!(b -5)) div!(1 mul!(b a)))}", "(-inf -inf -inf)"},
     ));
     testEvaluateAll("is_increasing", TEST_CASES(
         {"is_increasing?[0 0]", "yes"},
@@ -829,6 +1146,40 @@ int main() {
         {"sqrt!1", "1"},
         {"sqrt!4", "2"},
     ));
+    testEvaluateAll("transcendental", TEST_CASES(
+        {"sin!0", "0"},
+        {"cos!0", "1"},
+        {"exp!0", "1"},
+        {"log!1", "0"},
+        {"round!mul!(1000 sin!div!(pi 2))", "1000"},
+        {"round!mul!(1000 log!exp!2)", "2000"},
+        {"sin![0 0]", "[0 0]"},
+        {"cos!range!2", "[1 0.540302]"},
+        {"exp![]", "[]"},
+    ));
+    testEvaluateAll("pow", TEST_CASES(
+        {"pow!(2 10)", "1024"},
+        {"pow!(3 39)", "4052555153018976267"},
+        {"pow!(2 -1)", "0.500000"},
+        {"pow!(4 0.5)", "2"},
+        {"pow!([1 2 3] [2 2])", "[1 4]"},
+    ));
+    testEvaluateAll("atan2", TEST_CASES(
+        {"atan2!(0 1)", "0"},
+        {"round!mul!(1000 atan2!(1 0))", "1571"},
+        {"atan2!([0] [1])", "[0]"},
+    ));
+    testEvaluateAll("min max", TEST_CASES(
+        {"min!(1 2)", "1"},
+        {"min!(2 1)", "1"},
+        {"max!(1 2)", "2"},
+        {"max!(2 1)", "2"},
+        {"min!(9007199254740993 9007199254740992)", "9007199254740992"},
+        {"max!([1 5] [4 2])", "[4 5]"},
+        {"min!([1 5] [4 2])", "[1 2]"},
+        {"min_item![3 1 2]", "1"},
+        {"max_item![3 1 2]", "3"},
+    ));
     testEvaluateAll("number", TEST_CASES(
         {"number!'0'", "48"},
         {"number!'9'", "57"},
@@ -1005,6 +1356,14 @@ int main() {
         {"equal?([0 1] [0 1])", "yes"},
         {"equal?([0 1] [1 1])", "no"},
         {"equal?([0 1] [0])", "no"},
+        {"equal?([0 [1 2]] [0 [1 2]])", "yes"},
+        {"equal?([0 [1 2]] [0 [1 3]])", "no"},
+        {"equal?([0 -0] [0 0])", "yes"},
+        {"x@{a=[nan] x=equal?(a a)}", "no"},
+        {"x@{a=[1 2] b=[1 2] x=[equal?(a b) equal?(put!(0 a) put!(0 b))]}", "[yes yes]"},
+        {"equal?([0 1 2] range!3)", "yes"},
+        {"x@{a=[1 2] b=put!(0 a) c=put!(0 a) x=equal?(b c)}", "yes"},
+        {"x@{a=[1 2] b=put!(0 a) c=put!(0 [1 3]) x=[equal?(b c) equal?(a [1 2])]}", "[no yes]"},
     ));
     testEvaluateTypes("equal stack", TEST_CASES(
         {"equal?([] [])", "NO"},
@@ -1031,6 +1390,9 @@ int main() {
         {R"(equal?("ab" "ab"))", "yes"},
         {R"(equal?("abc" "ab"))", "no"},
         {R"(equal?("ab" "abc"))", "no"},
+        {R"(x@{a="bc" b=put!('a' a) x=[equal?(b "abc") equal?(b "abd")]})", "[yes no]"},
+        {R"(equal?(("a" 1) ("a" 1)))", "yes"},
+        {R"(equal?(("a" 1) ("b" 1)))", "no"},
     ));
     testEvaluateAll("unequal string", TEST_CASES(
         {R"(unequal?("" ""))", "no"},
@@ -1150,6 +1512,10 @@ int main() {
         {"put!(2 0)", "2"},
         {"put!(1 1)", "2"},
         {"put!(2 1)", "3"},
+        {"result@{result=0 i=3 for i result+=i end}", "6"},
+    ));
+    testEvaluateAll("put error", TEST_CASES(
+        {"put!(1 'a')", "I found an error during type checking.\nThe put function received a CHARACTER, which it did not expect."},
     ));
     testEvaluateAll("put boolean", TEST_CASES(
         {"put!(no no)", "no"},
@@ -1357,12 +1723,24 @@ int main() {
         {"range!1", "[NUMBER]"},
         {"range!2", "[NUMBER]"},
         {"range!3", "[NUMBER]"},
+        {"range!'a'", "I found an error during type checking.\nThe range function received a CHARACTER, which it did not expect."},
     ));
     testEvaluateAll("range", TEST_CASES(
         {"range!0", "[]"},
         {"range!1", "[0]"},
         {"range!2", "[0 1]"},
         {"range!3", "[0 1 2]"},
+        {"get2!range!3", "2"},
+        {"take!drop!range!3", "1"},
+        {"drop!drop!drop!range!3", "[]"},
+        {"put!(3 range!3)", "[3 0 1 2]"},
+        {"reverse!range!3", "[2 1 0]"},
+        {"equal?(range!3 [0 1 2])", "yes"},
+        {"equal?([0 1] range!3)", "no"},
+        {"equal?(range!0 [])", "yes"},
+        {"s@{s=0 r=range!4 for x in r s=add!(s x) end}", "6"},
+        {"a@{r=range!3 a=r!dynamic {}}", "\n\nI have found a dynamic type error.\nIt happens when indexing a stack.\nThe index is expected to be a NUMBER,\nbut now it is an EVALUATED_DICTIONARY.\n"},
+        {"range!dynamic []", "I found an error during evaluation.\nThe range function received an EMPTY_STACK, which it did not expect."},
     ));
     testEvaluateAll("iteration", TEST_CASES(
         {"count!range!100", "100"},
@@ -1822,6 +2200,34 @@ int main() {
         {"merge_sorted!([0 2] [1 3])", "[0 1 2 3]"},
         {"merge_sorted!([0 1 2 5 8 9] [0 2 4 6 7])", "[0 0 1 2 2 4 5 6 7 8 9]"},
     ));
+    testEvaluateTypes("sort", TEST_CASES(
+        {"sort![]", "EMPTY_STACK"},
+        {"sort![2 1]", "[NUMBER]"},
+        {"sort!\"ba\"", "STRING"},
+        {"sort_key!(neg [2 1])", "[NUMBER]"},
+        {"sort![{a=1}]", "I found an error during type checking.\nThe sort function can not order an EVALUATED_DICTIONARY."},
+        {"sort!1", "I found an error during type checking.\nThe sort function received a NUMBER, which it did not expect."},
+    ));
+    testEvaluateAll("sort", TEST_CASES(
+        {"sort![]", "[]"},
+        {"sort!\"\"", "\"\""},
+        {"sort![3 1 2]", "[1 2 3]"},
+        {"sort![-1 inf 0 -inf 2]", "[-inf -1 0 2 inf]"},
+        {"sort!\"hello\"", "\"ehllo\""},
+        {"sort![[2 1] [1 5] [] [1]]", "[[] [1] [1 5] [2 1]]"},
+        {"sort![(2 'b') (1 'c') (2 'a')]", "[(1 'c') (2 'a') (2 'b')]"},
+        {"sort!reverse!range!3", "[0 1 2]"},
+        {"sort_key!(neg [1 3 2])", "[3 2 1]"},
+        {"sort_key!(get1 [(1 3) (2 1) (3 3) (4 0)])", "[(4 0) (2 1) (1 3) (3 3)]"},
+        {"sort_key!(count [\"ab\" \"c\" \"\"])", "[\"\" \"c\" \"ab\"]"},
+        {"sort![2 1.5 1]", "[1 1.500000 2]"},
+        {"sort![9223372036854775807 9223372036854775806 9223372036854775808]", "[9223372036854775806 9223372036854775807 9223372036854777856.000000]"},
+        {"sort!dynamic [1 'a' 0]", "I found an error during evaluation.\nThe sort function can not order a NUMBER and a CHARACTER."},
+        {"sort!dynamic [[1] ['a']]", "I found an error during evaluation.\nThe sort function can not order a NUMBER and a CHARACTER."},
+        {"sort!dynamic [{a=1}]", "I found an error during evaluation.\nThe sort function can not order an EVALUATED_DICTIONARY and an EVALUATED_DICTIONARY."},
+        {"sort_key!(in x out {} [1])", "I found an error during evaluation.\nThe sort_key function can not order an EVALUATED_DICTIONARY and an EVALUATED_DICTIONARY."},
+        {"sort!dynamic 1", "I found an error during evaluation.\nThe sort function received a NUMBER, which it did not expect."},
+    ));
     testEvaluateAll("indexing tuple", TEST_CASES(
         {"get0!(11 12 13 14 15 16 17 18 19 20)", "11"},
         {"get1!(11 12 13 14 15 16 17 18 19 20)", "12"},
@@ -1902,5 +2308,25 @@ int main() {
         {"squared_norm![3 4]", "25"},
         {"norm![3 4]", "5"},
     ));
+    testEvaluateAll("streams", TEST_CASES(
+        {"map!(add zip2!([1 2] [3 4 5]))", "[4 6]"},
+        {"map!(inc map!(inc [1 2]))", "[3 4]"},
+        {"map!(inc range!3)", "[1 2 3]"},
+        {"map!(in c out c \"abc\")", "\"abc\""},
+        {"reverse!map!(inc [1 2 3])", "[4 3 2]"},
+        {"reverse!clear_if!(in c out equal?(c 'b') \"abc\")", "\"ca\""},
+        {"fold!(add map!(inc range!4) 0)", "10"},
+        {"count_if!(in x out less?(x 3) map!(inc [1 2 3]))", "1"},
+        {"map_generic!(inc clear_if!(in x out equal?(x 2) [1 2 3]) [])", "[4 2]"},
+        {"count_if!(in x out yes [no no])", "2"},
+        {"map_generic!(in x out x [1 no 3] [])", "[3 no 1]"},
+        {"fold!(in (x acc) out put!(x acc) map!(in x out x [yes no yes]) [])", "[yes no yes]"},
+        {"map!(in (a b) out a zip2!([no yes] [1 2]))", "[no yes]"},
+        {"reverse!clear_if!(in x out x [yes no no])", "[no no]"},
+        {"range!0", "[]"},
+        {"map!(inc [])", "[]"},
+        {"{map=in (f x) out f!x a=map!(inc 1)}", "{map=in (f x) out f!x a=2}"},
+        {"map!(in x out x!0 [[1] 2])", "I found an error during evaluation.\nThe application operator (!) received a NUMBER, which I did not expect."},
+    ));
     return summarizeTests();
 }
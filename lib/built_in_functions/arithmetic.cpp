@@ -2,17 +2,26 @@
 
 #include <math.h>
 
+#include <vector>
+
 #include "binary_tuple.h"
+#include "container.h"
 #include "../factory.h"
 #include "../mang_lang_string.h"
+#include "../numeric.h"
 #include "../type_check.h"
 
 namespace arithmetic {
 namespace {
 
+// Integers are numbers, that are stored exactly.
+bool isType(Expression in, ExpressionType expected) {
+    return in.type == expected || (expected == NUMBER && in.type == INTEGER);
+}
+
 TypeCheck checkTypeUnaryFunction(Expression in, ExpressionType expected, const char* function) {
     auto result = MAKE(TypeCheck, .ok=true);
-    if (in.type != ANY && in.type != expected) {
+    if (in.type != ANY && !isType(in, expected)) {
         result.ok = false;
         result.error = makeErrorExpression({},
             "\n\nI have found a type error.\n"
@@ -27,12 +36,18 @@ TypeCheck checkTypeUnaryFunction(Expression in, ExpressionType expected, const c
     return result;
 }
 
-BinaryTuple checkTypeBinaryFunction(Expression in, ExpressionType expected, const char* function) {
-    auto result = getBinaryTuple(in, function);
-    if (!result.ok) {
+BinaryTuple checkTypeBinaryOperands(
+    Expression left, Expression right, ExpressionType expected, const char* function
+) {
+    auto result = MAKE(BinaryTuple, .left=left, .right=right, .ok=true);
+    // Errors of the operands are passed on, instead of being reported as type errors.
+    if (left.type == ERROR_EXPRESSION || right.type == ERROR_EXPRESSION) {
+        result.ok = false;
+        result.error = left.type == ERROR_EXPRESSION ? left : right;
         return result;
     }
-    if (result.left.type != ANY && result.left.type != expected) {
+    if (left.type != ANY && !isType(left, expected)) {
+        result.ok = false;
         result.error = makeErrorExpression({},
             "\n\nI have found a type error.\n"
             "It happens when calling the built-in function %s.\n"
@@ -40,11 +55,12 @@ BinaryTuple checkTypeBinaryFunction(Expression in, ExpressionType expected, cons
             "but now the first item in the tuple is %s.\n",
             function,
             getExpressionName(expected),
-            getExpressionName(result.left.type)
+            getExpressionName(left.type)
         );
         return result;
     }
-    if (result.right.type != ANY && result.right.type != expected) {
+    if (right.type != ANY && !isType(right, expected)) {
+        result.ok = false;
         result.error = makeErrorExpression({},
             "\n\nI have found a type error.\n"
             "It happens when calling the built-in function %s.\n"
@@ -52,11 +68,10 @@ BinaryTuple checkTypeBinaryFunction(Expression in, ExpressionType expected, cons
             "but now the second item in the tuple is %s.\n",
             function,
             getExpressionName(expected),
-            getExpressionName(result.right.type)
+            getExpressionName(right.type)
         );
         return result;
     }
-    result.ok = true;
     return result;
 }
 
@@ -64,45 +79,318 @@ Expression makeNumber(double x) {
     return makeNumber(CodeRange{}, x);
 }
 
+Expression makeBoolean(bool x) {
+    return x ? Expression{0, CodeRange{}, YES} : Expression{0, CodeRange{}, NO};
+}
+
+// The proven versions are called at call sites that the type pass proved.
+// They skip the checks of the tuple shape and of ANY types, and the building of type errors,
+// but keep one test of the operand types: errors can still flow into them at run-time,
+// and are reported as usual by falling back to the checked function.
+bool isNumberPair(Expression left, Expression right) {
+    return isNumber(left) && isNumber(right);
+}
+
+bool isIntegerPair(Expression left, Expression right) {
+    return left.type == INTEGER && right.type == INTEGER;
+}
+
+// The integer operations fall back to doubles when the result is not an integer,
+// when it does not fit in an integer, or when it is negative zero.
+
+Expression addNumbers(Expression left, Expression right) {
+    auto result = Integer{};
+    if (isIntegerPair(left, right) &&
+        addIntegers(getInteger(left), getInteger(right), result)) {
+        return makeInteger(CodeRange{}, result);
+    }
+    return makeNumber(getNumber(left) + getNumber(right));
+}
+
+Expression mulNumbers(Expression left, Expression right) {
+    auto result = Integer{};
+    if (isIntegerPair(left, right) &&
+        mulExactIntegers(getInteger(left), getInteger(right), result)) {
+        return makeInteger(CodeRange{}, result);
+    }
+    return makeNumber(getNumber(left) * getNumber(right));
+}
+
+Expression subNumbers(Expression left, Expression right) {
+    auto result = Integer{};
+    if (isIntegerPair(left, right) &&
+        subIntegers(getInteger(left), getInteger(right), result)) {
+        return makeInteger(CodeRange{}, result);
+    }
+    return makeNumber(getNumber(left) - getNumber(right));
+}
+
+Expression divNumbers(Expression left, Expression right) {
+    if (isIntegerPair(left, right) && isExactDivision(getInteger(left), getInteger(right))) {
+        return makeInteger(CodeRange{}, getInteger(left) / getInteger(right));
+    }
+    return makeNumber(getNumber(left) / getNumber(right));
+}
+
+Expression modNumbers(Expression left, Expression right) {
+    if (isIntegerPair(left, right) && isExactModulo(getInteger(left), getInteger(right))) {
+        return makeInteger(CodeRange{}, getInteger(left) % getInteger(right));
+    }
+    return makeNumber(fmod(getNumber(left), getNumber(right)));
+}
+
+Expression lessNumbers(Expression left, Expression right) {
+    if (isIntegerPair(left, right)) {
+        return makeBoolean(getInteger(left) < getInteger(right));
+    }
+    return makeBoolean(getNumber(left) < getNumber(right));
+}
+
+bool isNumbers(Expression in) {
+    return in.type == EVALUATED_STACK || in.type == EVALUATED_RANGE || in.type == EMPTY_STACK;
+}
+
+Expression makeNumbersTypeError(Expression in, const char* function) {
+    return makeErrorExpression(in.range,
+        "\n\nI have found a type error.\n"
+        "It happens when calling the built-in function %s.\n"
+        "The function expects to be called with a number or a stack of numbers,\n"
+        "but now got %s.\n",
+        function,
+        getExpressionName(in.type)
+    );
+}
+
+Expression makeStack(const std::vector<Expression>& items) {
+    auto stack = Expression{0, CodeRange{}, EMPTY_STACK};
+    for (auto it = items.rbegin(); it != items.rend(); ++it) {
+        stack = putEvaluatedStack(stack, *it);
+    }
+    return stack;
+}
+
+// Applies the function to a number, or to each number of a stack or range.
+// The numbers of a stack are gathered first, so that the function is applied
+// in one loop over unboxed numbers, that the compiler can vectorize.
+template<typename Function>
+Expression applyToNumbers(Expression in, Function function, const char* name) {
+    if (in.type == ERROR_EXPRESSION || in.type == ANY) {
+        return in;
+    }
+    if (isNumber(in)) {
+        return makeNumber(function(getNumber(in)));
+    }
+    if (!isNumbers(in)) {
+        return makeNumbersTypeError(in, name);
+    }
+    auto numbers = std::vector<Number>{};
+    for (auto container = in; container.type != EMPTY_STACK; container = container_functions::drop(container)) {
+        const auto item = container_functions::take(container);
+        // The type of a stack with unknown items stays unknown.
+        if (item.type == ANY) {
+            return in;
+        }
+        if (!isNumber(item)) {
+            return makeNumbersTypeError(item, name);
+        }
+        numbers.push_back(getNumber(item));
+    }
+    for (auto& number : numbers) {
+        number = function(number);
+    }
+    auto items = std::vector<Expression>{};
+    for (const auto number : numbers) {
+        items.push_back(makeNumber(number));
+    }
+    return makeStack(items);
+}
+
+// Applies the operation to two numbers, or to each pair of numbers of two stacks or ranges,
+// until the shortest one ends.
+template<typename Operation>
+Expression applyToNumberPairs(Expression left, Expression right, Operation operation, const char* name) {
+    if (left.type == ERROR_EXPRESSION) {
+        return left;
+    }
+    if (right.type == ERROR_EXPRESSION) {
+        return right;
+    }
+    if (left.type == ANY && right.type == ANY) {
+        return left;
+    }
+    const auto is_left_number = left.type == ANY || isNumber(left);
+    const auto is_right_number = right.type == ANY || isNumber(right);
+    if (is_left_number || is_right_number) {
+        auto type_check = checkTypeBinaryOperands(left, right, NUMBER, name);
+        if (!type_check.ok) return type_check.error;
+        return operation(left, right);
+    }
+    if (!isNumbers(left)) {
+        return makeNumbersTypeError(left, name);
+    }
+    if (!isNumbers(right)) {
+        return makeNumbersTypeError(right, name);
+    }
+    auto items = std::vector<Expression>{};
+    while (left.type != EMPTY_STACK && right.type != EMPTY_STACK) {
+        const auto left_item = container_functions::take(left);
+        const auto right_item = container_functions::take(right);
+        if (left_item.type == ANY || right_item.type == ANY) {
+            items.push_back(Expression{});
+        }
+        else if (!isNumber(left_item)) {
+            return makeNumbersTypeError(left_item, name);
+        }
+        else if (!isNumber(right_item)) {
+            return makeNumbersTypeError(right_item, name);
+        }
+        else {
+            items.push_back(operation(left_item, right_item));
+        }
+        left = container_functions::drop(left);
+        right = container_functions::drop(right);
+    }
+    return makeStack(items);
+}
+
+Expression powNumbers(Expression left, Expression right) {
+    // Integers to natural powers are multiplied exactly, while they fit.
+    if (isIntegerPair(left, right) && getInteger(right) >= 0) {
+        auto base = getInteger(left);
+        auto exponent = getInteger(right);
+        auto result = Integer{1};
+        auto is_exact = true;
+        while (exponent > 0 && is_exact) {
+            if (exponent & 1) {
+                is_exact = mulIntegers(result, base, result);
+            }
+            exponent >>= 1;
+            if (exponent > 0 && is_exact) {
+                is_exact = mulIntegers(base, base, base);
+            }
+        }
+        if (is_exact) {
+            return makeInteger(CodeRange{}, result);
+        }
+    }
+    return makeNumber(::pow(getNumber(left), getNumber(right)));
+}
+
+Expression atan2Numbers(Expression left, Expression right) {
+    return makeNumber(::atan2(getNumber(left), getNumber(right)));
+}
+
+// Like less, nan is neither smaller nor larger than other numbers.
+Expression minNumbers(Expression left, Expression right) {
+    return lessNumbers(left, right).type == YES ? left : right;
+}
+
+Expression maxNumbers(Expression left, Expression right) {
+    return lessNumbers(left, right).type == YES ? right : left;
+}
+
 } // namespace
 
 Expression add(Expression in) {
-    auto type_check = checkTypeBinaryFunction(in, NUMBER, "add");
-    if (!type_check.ok) return type_check.error;
-    return makeNumber(getNumber(type_check.left) + getNumber(type_check.right));
+    const auto tuple = getBinaryTuple(in, "add");
+    if (!tuple.ok) return tuple.error;
+    return addBinary(tuple.left, tuple.right);
 }
 
 Expression mul(Expression in) {
-    auto type_check = checkTypeBinaryFunction(in, NUMBER, "mul");
-    if (!type_check.ok) return type_check.error;
-    return makeNumber(getNumber(type_check.left) * getNumber(type_check.right));
+    const auto tuple = getBinaryTuple(in, "mul");
+    if (!tuple.ok) return tuple.error;
+    return mulBinary(tuple.left, tuple.right);
 }
 
 Expression sub(Expression in) {
-    auto type_check = checkTypeBinaryFunction(in, NUMBER, "sub");
-    if (!type_check.ok) return type_check.error;
-    return makeNumber(getNumber(type_check.left) - getNumber(type_check.right));
+    const auto tuple = getBinaryTuple(in, "sub");
+    if (!tuple.ok) return tuple.error;
+    return subBinary(tuple.left, tuple.right);
 }
 
 Expression div(Expression in) {
-    auto type_check = checkTypeBinaryFunction(in, NUMBER, "div");
-    if (!type_check.ok) return type_check.error;
-    return makeNumber(getNumber(type_check.left) / getNumber(type_check.right));
+    const auto tuple = getBinaryTuple(in, "div");
+    if (!tuple.ok) return tuple.error;
+    return divBinary(tuple.left, tuple.right);
 }
 
 Expression mod(Expression in) {
-    auto type_check = checkTypeBinaryFunction(in, NUMBER, "mod");
-    if (!type_check.ok) return type_check.error;
-    return makeNumber(fmod(getNumber(type_check.left), getNumber(type_check.right)));
+    const auto tuple = getBinaryTuple(in, "mod");
+    if (!tuple.ok) return tuple.error;
+    return modBinary(tuple.left, tuple.right);
 }
 
 Expression less(Expression in) {
-    auto type_check = checkTypeBinaryFunction(in, NUMBER, "less");
+    const auto tuple = getBinaryTuple(in, "less");
+    if (!tuple.ok) return tuple.error;
+    return lessBinary(tuple.left, tuple.right);
+}
+
+Expression addBinary(Expression left, Expression right) {
+    auto type_check = checkTypeBinaryOperands(left, right, NUMBER, "add");
+    if (!type_check.ok) return type_check.error;
+    return addNumbers(left, right);
+}
+
+Expression mulBinary(Expression left, Expression right) {
+    auto type_check = checkTypeBinaryOperands(left, right, NUMBER, "mul");
+    if (!type_check.ok) return type_check.error;
+    return mulNumbers(left, right);
+}
+
+Expression subBinary(Expression left, Expression right) {
+    auto type_check = checkTypeBinaryOperands(left, right, NUMBER, "sub");
     if (!type_check.ok) return type_check.error;
-    const auto left = getNumber(type_check.left);
-    const auto right = getNumber(type_check.right);
-    return left < right ?
-        Expression{0, CodeRange{}, YES} : Expression{0, CodeRange{}, NO};
+    return subNumbers(left, right);
+}
+
+Expression divBinary(Expression left, Expression right) {
+    auto type_check = checkTypeBinaryOperands(left, right, NUMBER, "div");
+    if (!type_check.ok) return type_check.error;
+    return divNumbers(left, right);
+}
+
+Expression modBinary(Expression left, Expression right) {
+    auto type_check = checkTypeBinaryOperands(left, right, NUMBER, "mod");
+    if (!type_check.ok) return type_check.error;
+    return modNumbers(left, right);
+}
+
+Expression lessBinary(Expression left, Expression right) {
+    auto type_check = checkTypeBinaryOperands(left, right, NUMBER, "less");
+    if (!type_check.ok) return type_check.error;
+    return lessNumbers(left, right);
+}
+
+Expression addProven(Expression left, Expression right) {
+    if (!isNumberPair(left, right)) return addBinary(left, right);
+    return addNumbers(left, right);
+}
+
+Expression mulProven(Expression left, Expression right) {
+    if (!isNumberPair(left, right)) return mulBinary(left, right);
+    return mulNumbers(left, right);
+}
+
+Expression subProven(Expression left, Expression right) {
+    if (!isNumberPair(left, right)) return subBinary(left, right);
+    return subNumbers(left, right);
+}
+
+Expression divProven(Expression left, Expression right) {
+    if (!isNumberPair(left, right)) return divBinary(left, right);
+    return divNumbers(left, right);
+}
+
+Expression modProven(Expression left, Expression right) {
+    if (!isNumberPair(left, right)) return modBinary(left, right);
+    return modNumbers(left, right);
+}
+
+Expression lessProven(Expression left, Expression right) {
+    if (!isNumberPair(left, right)) return lessBinary(left, right);
+    return lessNumbers(left, right);
 }
 
 Expression sqrt(Expression in) {
@@ -111,21 +399,80 @@ Expression sqrt(Expression in) {
     return makeNumber(::sqrt(getNumber(in)));
 }
 
+Expression sin(Expression in) {
+    return applyToNumbers(in, [](Number x) {return ::sin(x);}, "sin");
+}
+
+Expression cos(Expression in) {
+    return applyToNumbers(in, [](Number x) {return ::cos(x);}, "cos");
+}
+
+Expression exp(Expression in) {
+    return applyToNumbers(in, [](Number x) {return ::exp(x);}, "exp");
+}
+
+Expression log(Expression in) {
+    return applyToNumbers(in, [](Number x) {return ::log(x);}, "log");
+}
+
+Expression pow(Expression in) {
+    const auto tuple = getBinaryTuple(in, "pow");
+    if (!tuple.ok) return tuple.error;
+    return powBinary(tuple.left, tuple.right);
+}
+
+Expression atan2(Expression in) {
+    const auto tuple = getBinaryTuple(in, "atan2");
+    if (!tuple.ok) return tuple.error;
+    return atan2Binary(tuple.left, tuple.right);
+}
+
+Expression min(Expression in) {
+    const auto tuple = getBinaryTuple(in, "min");
+    if (!tuple.ok) return tuple.error;
+    return minBinary(tuple.left, tuple.right);
+}
+
+Expression max(Expression in) {
+    const auto tuple = getBinaryTuple(in, "max");
+    if (!tuple.ok) return tuple.error;
+    return maxBinary(tuple.left, tuple.right);
+}
+
+Expression powBinary(Expression left, Expression right) {
+    return applyToNumberPairs(left, right, powNumbers, "pow");
+}
+
+Expression atan2Binary(Expression left, Expression right) {
+    return applyToNumberPairs(left, right, atan2Numbers, "atan2");
+}
+
+Expression minBinary(Expression left, Expression right) {
+    return applyToNumberPairs(left, right, minNumbers, "min");
+}
+
+Expression maxBinary(Expression left, Expression right) {
+    return applyToNumberPairs(left, right, maxNumbers, "max");
+}
+
 Expression round(Expression in) {
     auto type_check = checkTypeUnaryFunction(in, NUMBER, "round");
     if (!type_check.ok) return type_check.error;
+    if (in.type == INTEGER) return in;
     return makeNumber(::round(getNumber(in)));
 }
 
 Expression roundUp(Expression in) {
     auto type_check = checkTypeUnaryFunction(in, NUMBER, "round_up");
     if (!type_check.ok) return type_check.error;
+    if (in.type == INTEGER) return in;
     return makeNumber(ceil(getNumber(in)));
 }
 
 Expression roundDown(Expression in) {
     auto type_check = checkTypeUnaryFunction(in, NUMBER, "round_down");
     if (!type_check.ok) return type_check.error;
+    if (in.type == INTEGER) return in;
     return makeNumber(floor(getNumber(in)));
 }
 
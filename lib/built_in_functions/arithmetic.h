@@ -6,17 +6,29 @@ namespace arithmetic {
 
 Expression add(Expression in);
 Expression addTyped(Expression in);
+Expression addBinary(Expression left, Expression right);
+Expression addProven(Expression left, Expression right);
 Expression mul(Expression in);
 Expression mulTyped(Expression in);
+Expression mulBinary(Expression left, Expression right);
+Expression mulProven(Expression left, Expression right);
 Expression sub(Expression in);
 Expression subTyped(Expression in);
+Expression subBinary(Expression left, Expression right);
+Expression subProven(Expression left, Expression right);
 Expression div(Expression in);
 Expression divTyped(Expression in);
+Expression divBinary(Expression left, Expression right);
+Expression divProven(Expression left, Expression right);
 Expression mod(Expression in);
 Expression modTyped(Expression in);
+Expression modBinary(Expression left, Expression right);
+Expression modProven(Expression left, Expression right);
 
 Expression less(Expression in);
 Expression lessTyped(Expression in);
+Expression lessBinary(Expression left, Expression right);
+Expression lessProven(Expression left, Expression right);
 
 Expression sqrt(Expression in);
 Expression sqrtTyped(Expression in);
@@ -27,6 +39,20 @@ Expression roundUpTyped(Expression in);
 Expression roundDown(Expression in);
 Expression roundDownTyped(Expression in);
 
+// These take numbers, or stacks of numbers that they apply to item by item.
+Expression sin(Expression in);
+Expression cos(Expression in);
+Expression exp(Expression in);
+Expression log(Expression in);
+Expression pow(Expression in);
+Expression powBinary(Expression left, Expression right);
+Expression atan2(Expression in);
+Expression atan2Binary(Expression left, Expression right);
+Expression min(Expression in);
+Expression minBinary(Expression left, Expression right);
+Expression max(Expression in);
+Expression maxBinary(Expression left, Expression right);
+
 Expression asciiNumber(Expression in);
 Expression asciiNumberTyped(Expression in);
 Expression asciiCharacter(Expression in);
@@ -10,9 +10,9 @@ BinaryTuple getBinaryTuple(Expression in, const char* function) {
             in.range,
             "I found a type error while calling the function %s. "
             "The function expected a tuple of two items, "
-            "but it got a %s",
+            "but it got %s %s",
             function,
-            getExpressionName(in.type)
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
         return result;
     }
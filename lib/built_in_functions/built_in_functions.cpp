@@ -5,12 +5,24 @@
 #include "../factory.h"
 #include "arithmetic.h"
 #include "container.h"
+#include "grid.h"
+#include "memo.h"
+#include "parallel.h"
+#include "set.h"
+#include "sort.h"
 
 static
-Definition makeDefinitionBuiltIn(size_t i, const char* name, FunctionPointer function) {
+Definition makeDefinitionBuiltIn(
+    size_t i,
+    const char* name,
+    FunctionPointer function,
+    BinaryFunctionPointer binary_function = nullptr,
+    BinaryFunctionPointer proven_binary_function = nullptr,
+    BuiltInEffect effect = EFFECT_NONE
+) {
     return Definition{
         {makeName(CodeRange{}, name, strlen(name)).index, i},
-        makeFunctionBuiltIn(CodeRange{}, {function}),
+        makeFunctionBuiltIn(CodeRange{}, {function, binary_function, proven_binary_function, effect}),
     };
 }
 
@@ -18,22 +30,46 @@ Expression builtIns() {
     size_t i  = 0;
     auto first = storage.definitions.count;
     makeDefinition({}, makeDefinitionBuiltIn(i++, "clear",      container_functions::clear));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "put",        container_functions::put));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "put",        container_functions::put, container_functions::putBinary));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "take",       container_functions::take));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "drop",       container_functions::drop));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "get",        container_functions::get));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "add",        arithmetic::add));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "mul",        arithmetic::mul));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "sub",        arithmetic::sub));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "div",        arithmetic::div));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "mod",        arithmetic::mod));
-    makeDefinition({}, makeDefinitionBuiltIn(i++, "less",       arithmetic::less));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "range",      container_functions::range));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "deque",      container_functions::deque));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "add",        arithmetic::add, arithmetic::addBinary, arithmetic::addProven));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "mul",        arithmetic::mul, arithmetic::mulBinary, arithmetic::mulProven));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sub",        arithmetic::sub, arithmetic::subBinary, arithmetic::subProven));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "div",        arithmetic::div, arithmetic::divBinary, arithmetic::divProven));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "mod",        arithmetic::mod, arithmetic::modBinary, arithmetic::modProven));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "less",       arithmetic::less, arithmetic::lessBinary, arithmetic::lessProven));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "round",      arithmetic::round));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "round_up",   arithmetic::roundUp));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "round_down", arithmetic::roundDown));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "sqrt",       arithmetic::sqrt));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sin",        arithmetic::sin));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "cos",        arithmetic::cos));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "exp",        arithmetic::exp));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "log",        arithmetic::log));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "pow",        arithmetic::pow, arithmetic::powBinary));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "atan2",      arithmetic::atan2, arithmetic::atan2Binary));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "min",        arithmetic::min, arithmetic::minBinary));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "max",        arithmetic::max, arithmetic::maxBinary));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "number",     arithmetic::asciiNumber));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "character",  arithmetic::asciiCharacter));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "memo",       memo_functions::memo));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "memo_statistics", memo_functions::memoStatistics, nullptr, nullptr, EFFECT_OBSERVES_CALLS));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sort",       sort_functions::sort));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sort_key",   sort_functions::sortKey));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "set",        set_functions::set));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "contains",   set_functions::contains));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "union",      set_functions::setUnion));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "intersection", set_functions::setIntersection));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "difference", set_functions::setDifference));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "grid",       grid_functions::grid, nullptr, nullptr, EFFECT_MUTABLE_RESULT));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "rows",       grid_functions::rows));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "columns",    grid_functions::columns));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "parallel_map", parallel_functions::parallelMap));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "parallel_fold", parallel_functions::parallelFold));
 
     auto last = storage.definitions.count;
     auto definitions = Indices{first, last - first};
@@ -50,6 +86,8 @@ Expression builtInsTypes() {
     makeDefinition({}, makeDefinitionBuiltIn(i++, "take",       container_functions::takeTyped));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "drop",       container_functions::dropTyped));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "get",        container_functions::getTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "range",      container_functions::rangeTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "deque",      container_functions::dequeTyped));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "add",        arithmetic::add));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "mul",        arithmetic::mul));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "sub",        arithmetic::sub));
@@ -60,8 +98,30 @@ Expression builtInsTypes() {
     makeDefinition({}, makeDefinitionBuiltIn(i++, "round_up",   arithmetic::roundUp));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "round_down", arithmetic::roundDown));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "sqrt",       arithmetic::sqrt));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sin",        arithmetic::sin));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "cos",        arithmetic::cos));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "exp",        arithmetic::exp));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "log",        arithmetic::log));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "pow",        arithmetic::pow));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "atan2",      arithmetic::atan2));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "min",        arithmetic::min));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "max",        arithmetic::max));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "number",     arithmetic::asciiNumber));
     makeDefinition({}, makeDefinitionBuiltIn(i++, "character",  arithmetic::asciiCharacter));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "memo",       memo_functions::memoTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "memo_statistics", memo_functions::memoStatisticsTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sort",       sort_functions::sortTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "sort_key",   sort_functions::sortKeyTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "set",        set_functions::setTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "contains",   set_functions::containsTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "union",      set_functions::setOperationTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "intersection", set_functions::setOperationTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "difference", set_functions::setOperationTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "grid",       grid_functions::gridTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "rows",       grid_functions::rowsTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "columns",    grid_functions::columnsTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "parallel_map", parallel_functions::parallelMapTyped));
+    makeDefinition({}, makeDefinitionBuiltIn(i++, "parallel_fold", parallel_functions::parallelFoldTyped));
     
     auto last = storage.definitions.count;
     auto definitions = Indices{first, last - first};
@@ -1,6 +1,10 @@
 #include "container.h"
 
+#include "arithmetic.h"
 #include "binary_tuple.h"
+#include "grid.h"
+#include "set.h"
+#include "../passes/evaluate.h"
 #include "../passes/serialize.h"
 #include "../exceptions.h"
 #include "../expression.h"
@@ -37,6 +41,84 @@ Expression putEvaluatedStack(Expression rest, Expression top) {
     return makeEvaluatedStack(rest.range, EvaluatedStack{top, rest});
 }
 
+Expression makeRange(Number start, Number stop, Number step) {
+    const auto is_empty = step > 0 ? start >= stop : start <= stop;
+    if (is_empty) {
+        return Expression{0, CodeRange{}, EMPTY_STACK};
+    }
+    return makeEvaluatedRange(CodeRange{}, EvaluatedRange{start, stop, step});
+}
+
+Expression stackFromRange(Expression range) {
+    DARRAY(Number) numbers = {};
+    for (auto item = range; item.type == EVALUATED_RANGE;) {
+        const auto range_struct = storage.evaluated_ranges.data[item.index];
+        APPEND(numbers, range_struct.start);
+        item = makeRange(range_struct.start + range_struct.step, range_struct.stop, range_struct.step);
+    }
+    auto stack = Expression{0, range.range, EMPTY_STACK};
+    while (!IS_EMPTY(numbers)) {
+        stack = putEvaluatedStack(stack, makeNumber(CodeRange{}, LAST_ITEM(numbers)));
+        DROP_BACK(numbers);
+    }
+    FREE_DARRAY(numbers);
+    return stack;
+}
+
+Expression makeEmptyDeque(CodeRange code) {
+    storage.deque_buffers.emplace_back();
+    return makeEvaluatedDeque(code, EvaluatedDeque{storage.deque_buffers.size() - 1, 0, 0});
+}
+
+Expression putDeque(Expression deque, Expression item) {
+    if (item.type == ERROR_EXPRESSION) {
+        return item;
+    }
+    auto deque_struct = storage.evaluated_deques.data[deque.index];
+    if (deque_struct.last != storage.deque_buffers.at(deque_struct.buffer).size()) {
+        const auto& buffer = storage.deque_buffers.at(deque_struct.buffer);
+        auto items = std::vector<Expression>(
+            buffer.begin() + deque_struct.first, buffer.begin() + deque_struct.last
+        );
+        storage.deque_buffers.push_back(std::move(items));
+        deque_struct = EvaluatedDeque{
+            storage.deque_buffers.size() - 1, 0, deque_struct.last - deque_struct.first
+        };
+    }
+    storage.deque_buffers.at(deque_struct.buffer).push_back(item);
+    ++deque_struct.last;
+    return makeEvaluatedDeque(deque.range, deque_struct);
+}
+
+bool isEmptyDeque(Expression deque) {
+    const auto deque_struct = storage.evaluated_deques.data[deque.index];
+    return deque_struct.first == deque_struct.last;
+}
+
+Expression takeDeque(Expression deque) {
+    const auto deque_struct = storage.evaluated_deques.data[deque.index];
+    if (deque_struct.first == deque_struct.last) {
+        return makeErrorExpression(deque.range, "Cannot take item from empty deque");
+    }
+    return storage.deque_buffers.at(deque_struct.buffer).at(deque_struct.first);
+}
+
+Expression takeDequeTyped(Expression deque) {
+    if (isEmptyDeque(deque)) {
+        return Expression{0, deque.range, ANY};
+    }
+    return takeDeque(deque);
+}
+
+Expression dropDeque(Expression deque) {
+    auto deque_struct = storage.evaluated_deques.data[deque.index];
+    if (deque_struct.first == deque_struct.last) {
+        return deque;
+    }
+    ++deque_struct.first;
+    return makeEvaluatedDeque(deque.range, deque_struct);
+}
+
 Expression putTable(Expression table, Expression item) {
     if (table.type == ERROR_EXPRESSION) {
         return table;
@@ -90,16 +172,22 @@ Expression clear(Expression in) {
     switch (in.type) {
         case ERROR_EXPRESSION: return in;
         case EVALUATED_STACK: return Expression{0, CodeRange{}, EMPTY_STACK};
+        case EVALUATED_RANGE: return Expression{0, CodeRange{}, EMPTY_STACK};
+        case EVALUATED_DEQUE: return makeEmptyDeque(CodeRange{});
+        case EVALUATED_SET: return makeEmptySet(CodeRange{});
         case EMPTY_STACK: return Expression{0, CodeRange{}, EMPTY_STACK};
         case STRING: return Expression{0, CodeRange{}, EMPTY_STRING};
         case EMPTY_STRING: return Expression{0, CodeRange{}, EMPTY_STRING};
         case EVALUATED_TABLE: return makeEvaluatedTable(CodeRange{}, EvaluatedTable{});
+        case EVALUATED_GRID: return makeEvaluatedGrid(CodeRange{}, EvaluatedGrid{0, 0, {}});
         case NUMBER: return makeNumber(CodeRange{}, 0);
+        case INTEGER: return makeNumber(CodeRange{}, 0);
         case YES: return Expression{0, CodeRange{}, NO};
         case NO: return in;
         default: return makeErrorExpression(in.range,
             "I found an error during evaluation.\n"
-            "The clear function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The clear function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
     }
 }
@@ -110,22 +198,27 @@ Expression clearTyped(Expression in) {
     switch (in.type) {
         case ERROR_EXPRESSION: return in;
         case EVALUATED_STACK: return in;
+        case EVALUATED_DEQUE: return in;
+        case EVALUATED_SET: return in;
         case EMPTY_STACK: return in;
         case STRING: return in;
         case EMPTY_STRING: return in;
         case EVALUATED_TABLE: return in;
+        case EVALUATED_GRID: return in;
         case NUMBER: return in;
+        case INTEGER: return in;
         case YES: return in;
         case NO: return in;
         default: return makeErrorExpression(in.range,
             "I found an error during type checking.\n"
-            "The clear function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The clear function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
     }
 }
 
 Expression putNumber(Expression collection, Expression item) {
-    if (item.type != ANY && item.type != NUMBER) {
+    if (item.type != ANY && !isNumber(item)) {
         return makeErrorExpression(collection.range,
             "\n\nI have found a static type error.\n"
             "It happens for the operation put!(NUMBER item).\n"
@@ -135,60 +228,75 @@ Expression putNumber(Expression collection, Expression item) {
             getExpressionName(item.type)
         );
     }
-    return makeNumber(CodeRange{}, getNumber(collection) + getNumber(item));
+    return arithmetic::addBinary(collection, item);
 }
 
-Expression put(Expression in) {
-    const auto tuple = getBinaryTuple(in, "put");
-    if (!tuple.ok) {
-        return tuple.error;
-    }
-    const auto item = tuple.left;
-    const auto collection = tuple.right;
+Expression putBinary(Expression item, Expression collection) {
     switch (collection.type) {
-        case ERROR_EXPRESSION: return in;
+        case ERROR_EXPRESSION: return collection;
         case EVALUATED_STACK: return putEvaluatedStack(collection, item);
+        case EVALUATED_RANGE: return putEvaluatedStack(stackFromRange(collection), item);
+        case EVALUATED_DEQUE: return putDeque(collection, item);
+        case EVALUATED_SET: return putSet(collection, item);
         case EMPTY_STACK: return putEvaluatedStack(collection, item);
         case STRING: return putString(collection, item);
         case EMPTY_STRING: return putString(collection, item);
         case EVALUATED_TABLE: return putTable(collection, item);
+        case EVALUATED_GRID: return putGrid(collection, item);
         case NUMBER: return putNumber(collection, item);
+        case INTEGER: return putNumber(collection, item);
         case YES: return item;
         case NO: return item;
-        default: return makeErrorExpression(in.range,
+        default: return makeErrorExpression(collection.range,
             "I found an error during evaluation.\n"
-            "The put function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The put function received %s %s, which it did not expect.",
+            getExpressionArticle(collection.type), getExpressionName(collection.type)
         );
     }
 }
 
-Expression putTyped(Expression in) {
+Expression put(Expression in) {
     const auto tuple = getBinaryTuple(in, "put");
     if (!tuple.ok) {
         return tuple.error;
     }
-    const auto item = tuple.left;
-    const auto collection = tuple.right;
+    return putBinary(tuple.left, tuple.right);
+}
+
+Expression putTypedBinary(Expression item, Expression collection) {
     if (item.type == ANY) {
         return collection;
     }
     switch (collection.type) {
-        case ERROR_EXPRESSION: return in;
+        case ERROR_EXPRESSION: return collection;
         case EVALUATED_STACK: return putEvaluatedStack(collection, item);
         case EMPTY_STACK: return putEvaluatedStack(collection, item);
         case STRING: return collection; // TODO: type check item
         case EMPTY_STRING: return putString(collection, item);
+        case EVALUATED_DEQUE: return isEmptyDeque(collection) ? putDeque(collection, item) : collection;
+        case EVALUATED_SET: return isEmptySet(collection) ? putSet(collection, item) : collection;
         case EVALUATED_TABLE: return putTableTyped(collection, item);
+        case EVALUATED_GRID: return putGridTyped(collection, item);
         case NUMBER: return putNumber(collection, item);
+        case INTEGER: return putNumber(collection, item);
         case YES: return item; // TODO: type check item
         case NO: return item;// TODO: type check item
-        default: return makeErrorExpression(in.range,
+        default: return makeErrorExpression(collection.range,
             "I found an error during type checking.\n"
-            "The put function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The put function received %s %s, which it did not expect.",
+            getExpressionArticle(collection.type), getExpressionName(collection.type)
         );
     }
 }
 
+Expression putTyped(Expression in) {
+    const auto tuple = getBinaryTuple(in, "put");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    return putTypedBinary(tuple.left, tuple.right);
+}
+
 template<typename T>
 Expression takeTable(const T& table) {
     if (table.empty()) {
@@ -214,7 +322,11 @@ Expression dropTable(const T& table) {
 }
 
 Expression dropNumber(Expression in) {
-    return makeNumber(CodeRange{}, getNumber(in) - 1);
+    return arithmetic::subBinary(in, makeInteger(CodeRange{}, 1));
+}
+
+Expression dropRange(EvaluatedRange range) {
+    return makeRange(range.start + range.step, range.stop, range.step);
 }
 
 Expression take(Expression in) {
@@ -223,15 +335,20 @@ Expression take(Expression in) {
     switch (type) {
         case ERROR_EXPRESSION: return in;
         case EVALUATED_STACK: return storage.evaluated_stacks.data[index].top;
+        case EVALUATED_RANGE: return makeNumber(CodeRange{}, storage.evaluated_ranges.data[index].start);
+        case EVALUATED_DEQUE: return takeDeque(in);
+        case EVALUATED_SET: return takeSet(in);
         case STRING: return storage.strings.data[index].top;
         case EVALUATED_TABLE: return takeTable(storage.evaluated_tables.at(index));
         case EVALUATED_TABLE_VIEW: return takeTable(storage.evaluated_table_views.data[index]);
         case NUMBER: return makeNumber(CodeRange{}, 1);
+        case INTEGER: return makeNumber(CodeRange{}, 1);
         case YES: return in;
         case NO: return in;
         default: return makeErrorExpression(in.range,
             "I found an error during evaluation.\n"
-            "The take function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The take function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
     }
 }
@@ -242,17 +359,21 @@ Expression takeTyped(Expression in) {
     switch (type) {
         case ERROR_EXPRESSION: return in;
         case EVALUATED_STACK: return storage.evaluated_stacks.data[index].top;
+        case EVALUATED_DEQUE: return takeDequeTyped(in);
+        case EVALUATED_SET: return takeSetTyped(in);
         case STRING: return storage.strings.data[index].top;
         case EVALUATED_TABLE: return takeTableTyped(storage.evaluated_tables.at(index), in);
         case EVALUATED_TABLE_VIEW: return takeTableTyped(storage.evaluated_table_views.data[index], in);
         case EMPTY_STACK: return Expression{0, in.range, ANY};
         case EMPTY_STRING: return Expression{0, in.range, CHARACTER};
         case NUMBER: return in;
+        case INTEGER: return in;
         case YES: return in;
         case NO: return in;
         default: return makeErrorExpression(in.range,
             "I found an error during type checking.\n"
-            "The take function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The take function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
     }
 }
@@ -261,17 +382,22 @@ Expression drop(Expression in) {
     switch (in.type) {
         case ERROR_EXPRESSION: return in;
         case EVALUATED_STACK: return storage.evaluated_stacks.data[in.index].rest;
+        case EVALUATED_RANGE: return dropRange(storage.evaluated_ranges.data[in.index]);
+        case EVALUATED_DEQUE: return dropDeque(in);
+        case EVALUATED_SET: return dropSet(in);
         case STRING: return storage.strings.data[in.index].rest;
         case EVALUATED_TABLE: return dropTable(storage.evaluated_tables.at(in.index));
         case EVALUATED_TABLE_VIEW: return dropTable(storage.evaluated_table_views.data[in.index]);
         case EMPTY_STACK: return in;
         case EMPTY_STRING: return in;
         case NUMBER: return dropNumber(in);
+        case INTEGER: return dropNumber(in);
         case NO: return in;
         case YES: return Expression{0, CodeRange{}, NO};
         default: return makeErrorExpression(in.range,
             "I found an error during evaluation.\n"
-            "The drop function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The drop function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
     }
 }
@@ -280,17 +406,21 @@ Expression dropTyped(Expression in) {
     switch (in.type) {
         case ERROR_EXPRESSION: return in;
         case EVALUATED_STACK: return in;
+        case EVALUATED_DEQUE: return in;
+        case EVALUATED_SET: return in;
         case STRING: return in;
         case EVALUATED_TABLE: return in;
         case EVALUATED_TABLE_VIEW: return in;
         case EMPTY_STACK: return in;
         case EMPTY_STRING: return in;
         case NUMBER: return in;
+        case INTEGER: return in;
         case NO: return in;
         case YES: return in;
         default: return makeErrorExpression(in.range,
             "I found an error during type checking.\n"
-            "The drop function received an %s, which it did not expect.", getExpressionName(in.type)
+            "The drop function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
         );
     }
 }
@@ -319,6 +449,9 @@ Expression get(Expression in) {
     const auto key = storage.expressions.data[evaluated_tuple.indices.data + 0];
     const auto table = storage.expressions.data[evaluated_tuple.indices.data + 1];
     const auto default_value = storage.expressions.data[evaluated_tuple.indices.data + 2];
+    if (table.type == EVALUATED_GRID) {
+        return getGrid(key, table, default_value);
+    }
     if (table.type != EVALUATED_TABLE) {
         return makeErrorExpression(table.range,
             "\n\nI have found a dynamic type error.\n"
@@ -361,7 +494,7 @@ Expression getTyped(Expression in) {
     }
     const auto table = storage.expressions.data[evaluated_tuple.indices.data + 1];
     const auto default_value = storage.expressions.data[evaluated_tuple.indices.data + 2];
-    if (table.type != EVALUATED_TABLE) {
+    if (table.type != EVALUATED_TABLE && table.type != EVALUATED_GRID) {
         return makeErrorExpression(table.range, 
             "\n\nI have found a dynamic type error.\n"
             "\nIt happens for the function get!(key table default).\n"
@@ -373,4 +506,77 @@ Expression getTyped(Expression in) {
     return default_value;
 }
 
+
+Expression range(Expression in) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    if (!isNumber(in)) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The range function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    return makeRange(0, getNumber(in), 1);
+}
+
+Expression rangeTyped(Expression in) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    if (!isNumber(in) && in.type != ANY) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The range function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    const auto empty_stack = Expression{0, in.range, EMPTY_STACK};
+    return makeEvaluatedStack(in.range, EvaluatedStack{makeNumber(in.range, 0), empty_stack});
+}
+
+
+Expression deque(Expression in) {
+    switch (in.type) {
+        case ERROR_EXPRESSION: return in;
+        case EVALUATED_STACK: break;
+        case EVALUATED_RANGE: break;
+        case EVALUATED_DEQUE: break;
+        case EVALUATED_SET: break;
+        case EMPTY_STACK: break;
+        case STRING: break;
+        case EMPTY_STRING: break;
+        default: return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The deque function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    auto result = makeEmptyDeque(in.range);
+    for (auto container = in; boolean(container).value; container = drop(container)) {
+        result = putDeque(result, take(container));
+    }
+    return result;
+}
+
+Expression dequeTyped(Expression in) {
+    switch (in.type) {
+        case ERROR_EXPRESSION: return in;
+        case ANY: return makeEmptyDeque(in.range);
+        case EVALUATED_STACK: break;
+        case EVALUATED_DEQUE: break;
+        case EVALUATED_SET: break;
+        case EMPTY_STACK: break;
+        case STRING: break;
+        case EMPTY_STRING: break;
+        default: return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The deque function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    return putTypedBinary(takeTyped(in), makeEmptyDeque(in.range));
+}
+
 }
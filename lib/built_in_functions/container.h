@@ -5,18 +5,26 @@
 Expression putString(Expression rest, Expression top);
 Expression putStack(Expression rest, Expression top);
 Expression putEvaluatedStack(Expression rest, Expression top);
+Expression stackFromRange(Expression range);
+bool isEmptyDeque(Expression deque);
 
 namespace container_functions {
 
 Expression clear(Expression in);
 Expression clearTyped(Expression in);
 Expression put(Expression in);
+Expression putBinary(Expression item, Expression collection);
 Expression putTyped(Expression in);
+Expression putTypedBinary(Expression item, Expression collection);
 Expression take(Expression in);
 Expression takeTyped(Expression in);
 Expression drop(Expression in);
 Expression dropTyped(Expression in);
 Expression get(Expression in);
 Expression getTyped(Expression in);
+Expression range(Expression in);
+Expression rangeTyped(Expression in);
+Expression deque(Expression in);
+Expression dequeTyped(Expression in);
 
 }
@@ -0,0 +1,423 @@
+#include "grid.h"
+
+#include "container.h"
+#include "../factory.h"
+#include "../passes/evaluate.h"
+
+namespace {
+
+// Gets the items of a tuple or stack with the expected number of items.
+bool getItems(Expression in, Expression* items, size_t count) {
+    if (in.type == EVALUATED_TUPLE) {
+        const auto tuple = storage.evaluated_tuples.data[in.index];
+        if (tuple.indices.count != count) {
+            return false;
+        }
+        for (size_t i = 0; i < count; ++i) {
+            items[i] = storage.expressions.data[tuple.indices.data + i];
+        }
+        return true;
+    }
+    if (in.type == EVALUATED_STACK || in.type == EMPTY_STACK) {
+        auto stack = in;
+        for (size_t i = 0; i < count; ++i) {
+            if (stack.type != EVALUATED_STACK) {
+                return false;
+            }
+            items[i] = container_functions::take(stack);
+            stack = container_functions::drop(stack);
+        }
+        return stack.type == EMPTY_STACK;
+    }
+    return false;
+}
+
+struct GridPosition {
+    size_t index;
+    bool inside;
+    Expression error;
+    bool ok;
+};
+
+GridPosition getGridPosition(Expression grid, Expression x, Expression y, const char* function) {
+    if (!isNumber(x) || !isNumber(y)) {
+        const auto error = makeErrorExpression(grid.range,
+            "I found an error during evaluation.\n"
+            "The %s expected a position of two numbers, but it got %s %s and %s %s.",
+            function,
+            getExpressionArticle(x.type), getExpressionName(x.type),
+            getExpressionArticle(y.type), getExpressionName(y.type)
+        );
+        return GridPosition{0, false, error, false};
+    }
+    const auto& grid_struct = storage.evaluated_grids.at(grid.index);
+    const auto x_number = getNumber(x);
+    const auto y_number = getNumber(y);
+    const auto inside =
+        0 <= x_number && x_number < (Number)grid_struct.width &&
+        0 <= y_number && y_number < (Number)grid_struct.height;
+    if (!inside) {
+        return GridPosition{0, false, {}, true};
+    }
+    return GridPosition{(size_t)x_number + (size_t)y_number * grid_struct.width, true, {}, true};
+}
+
+// The key is a tuple (x y) or a stack [x y].
+GridPosition getGridPosition(Expression grid, Expression key, const char* function) {
+    if (key.type == ERROR_EXPRESSION) {
+        return GridPosition{0, false, key, false};
+    }
+    Expression xy[2];
+    if (!getItems(key, xy, 2)) {
+        const auto error = makeErrorExpression(key.range,
+            "I found an error during evaluation.\n"
+            "The %s expected a position (x y), but it got %s %s.",
+            function,
+            getExpressionArticle(key.type), getExpressionName(key.type)
+        );
+        return GridPosition{0, false, error, false};
+    }
+    return getGridPosition(grid, xy[0], xy[1], function);
+}
+
+// The cell type of a grid type, which only has cells when it is known.
+Expression makeGridType(CodeRange code, Expression cell) {
+    if (cell.type == ANY) {
+        return makeEvaluatedGrid(code, EvaluatedGrid{0, 0, {}});
+    }
+    return makeEvaluatedGrid(code, EvaluatedGrid{1, 1, {cell}});
+}
+
+bool isRowContainer(Expression in) {
+    switch (in.type) {
+        case EVALUATED_STACK: return true;
+        case EVALUATED_RANGE: return true;
+        case EMPTY_STACK: return true;
+        case STRING: return true;
+        case EMPTY_STRING: return true;
+        default: return false;
+    }
+}
+
+// Returns false if the row does not have the same width as the previous rows.
+bool endRow(EvaluatedGrid& grid, size_t row_width) {
+    if (grid.height == 0) {
+        grid.width = row_width;
+    }
+    ++grid.height;
+    return row_width == grid.width;
+}
+
+Expression makeRowLengthError(Expression in, const EvaluatedGrid& grid, size_t row_width) {
+    return makeErrorExpression(in.range,
+        "I found an error during evaluation.\n"
+        "The grid function expected rows of the same length, "
+        "but row %zu has length %zu instead of %zu.",
+        grid.height - 1, row_width, grid.width
+    );
+}
+
+// Each line of the string is a row of characters.
+Expression makeGridFromString(Expression in) {
+    auto result = EvaluatedGrid{0, 0, {}};
+    auto row_width = size_t{0};
+    for (auto string = in; string.type == STRING; string = container_functions::drop(string)) {
+        const auto character = container_functions::take(string);
+        if (getCharacter(character) != '\n') {
+            result.cells.push_back(character);
+            ++row_width;
+            continue;
+        }
+        if (!endRow(result, row_width)) {
+            return makeRowLengthError(in, result, row_width);
+        }
+        row_width = 0;
+    }
+    if (row_width > 0 && !endRow(result, row_width)) {
+        return makeRowLengthError(in, result, row_width);
+    }
+    return makeEvaluatedGrid(in.range, std::move(result));
+}
+
+// Each item of the container is a row container of cells.
+Expression makeGridFromRows(Expression in) {
+    auto result = EvaluatedGrid{0, 0, {}};
+    for (auto rows = in; isRowContainer(rows) && boolean(rows).value; rows = container_functions::drop(rows)) {
+        const auto row = container_functions::take(rows);
+        if (!isRowContainer(row)) {
+            return makeErrorExpression(in.range,
+                "I found an error during evaluation.\n"
+                "The grid function expected rows that are stacks or strings, but it got %s %s.",
+                getExpressionArticle(row.type), getExpressionName(row.type)
+            );
+        }
+        auto row_width = size_t{0};
+        for (auto cells = row; boolean(cells).value; cells = container_functions::drop(cells)) {
+            result.cells.push_back(container_functions::take(cells));
+            ++row_width;
+        }
+        if (!endRow(result, row_width)) {
+            return makeRowLengthError(in, result, row_width);
+        }
+    }
+    return makeEvaluatedGrid(in.range, std::move(result));
+}
+
+// Larger grids are reported as errors, instead of failing to allocate their cells.
+// It is 1 GB of cells.
+const size_t MAX_GRID_CELLS = size_t{1} << 26;
+
+bool isGridSize(Expression size) {
+    // Written so that NaN is not a size.
+    return isNumber(size) && getNumber(size) >= 0 && getNumber(size) <= MAX_GRID_CELLS;
+}
+
+// grid!(width height value) is a grid where all cells have the same value.
+Expression makeFilledGrid(Expression in) {
+    Expression items[3];
+    if (!getItems(in, items, 3) || !isGridSize(items[0]) || !isGridSize(items[1]) ||
+        getNumber(items[0]) * getNumber(items[1]) > MAX_GRID_CELLS
+    ) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The grid function expected a tuple (width height value) "
+            "with non-negative width and height, and at most %zu cells.",
+            MAX_GRID_CELLS
+        );
+    }
+    const auto width = (size_t)getNumber(items[0]);
+    const auto height = (size_t)getNumber(items[1]);
+    return makeEvaluatedGrid(in.range,
+        EvaluatedGrid{width, height, std::vector<Expression>(width * height, items[2])}
+    );
+}
+
+Expression makeStackFromCells(const std::vector<Expression>& cells, size_t first, size_t step, size_t count) {
+    auto result = Expression{0, CodeRange{}, EMPTY_STACK};
+    for (size_t i = count; i > 0; --i) {
+        result = putEvaluatedStack(result, cells.at(first + (i - 1) * step));
+    }
+    return result;
+}
+
+// Both rows and columns have the type [[CELL]].
+Expression nestedStackType(Expression grid) {
+    if (grid.type == ERROR_EXPRESSION) {
+        return grid;
+    }
+    if (grid.type == ANY) {
+        return Expression{0, grid.range, ANY};
+    }
+    if (grid.type != EVALUATED_GRID) {
+        return makeErrorExpression(grid.range,
+            "I found an error during type checking.\n"
+            "The rows and columns functions expected a grid, but it got %s %s.",
+            getExpressionArticle(grid.type), getExpressionName(grid.type)
+        );
+    }
+    if (isEmptyGrid(grid)) {
+        return Expression{0, grid.range, EMPTY_STACK};
+    }
+    const auto cell = storage.evaluated_grids.at(grid.index).cells.at(0);
+    const auto empty = Expression{0, grid.range, EMPTY_STACK};
+    return putEvaluatedStack(empty, putEvaluatedStack(empty, cell));
+}
+
+Expression gridError(Expression in, const char* function) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    return makeErrorExpression(in.range,
+        "I found an error during evaluation.\n"
+        "The %s function expected a grid, but it got %s %s.",
+        function,
+        getExpressionArticle(in.type), getExpressionName(in.type)
+    );
+}
+
+} // namespace
+
+bool isEmptyGrid(Expression grid) {
+    return storage.evaluated_grids.at(grid.index).cells.empty();
+}
+
+Expression putGrid(Expression grid, Expression item) {
+    if (item.type == ERROR_EXPRESSION) {
+        return item;
+    }
+    Expression items[3];
+    if (!getItems(item, items, 3)) {
+        return makeErrorExpression(item.range,
+            "I found an error during evaluation.\n"
+            "Putting to a grid expected a tuple (x y value), but it got %s %s.",
+            getExpressionArticle(item.type), getExpressionName(item.type)
+        );
+    }
+    const auto position = getGridPosition(grid, items[0], items[1], "put function");
+    if (!position.ok) {
+        return position.error;
+    }
+    if (!position.inside) {
+        return makeErrorExpression(item.range, "Grid position out of range");
+    }
+    storage.evaluated_grids.at(grid.index).cells.at(position.index) = items[2];
+    return grid;
+}
+
+Expression putGridTyped(Expression grid, Expression item) {
+    if (item.type == ERROR_EXPRESSION) {
+        return item;
+    }
+    Expression items[3];
+    if (!getItems(item, items, 3)) {
+        return makeErrorExpression(item.range,
+            "I found an error during type checking.\n"
+            "Putting to a grid expected a tuple (x y value), but it got %s %s.",
+            getExpressionArticle(item.type), getExpressionName(item.type)
+        );
+    }
+    return isEmptyGrid(grid) ? makeGridType(grid.range, items[2]) : grid;
+}
+
+Expression getGrid(Expression key, Expression grid, Expression default_value) {
+    const auto position = getGridPosition(grid, key, "get function");
+    if (!position.ok) {
+        return position.error;
+    }
+    if (!position.inside) {
+        return default_value;
+    }
+    return storage.evaluated_grids.at(grid.index).cells.at(position.index);
+}
+
+Expression applyGridIndexing(Expression grid, Expression input) {
+    const auto position = getGridPosition(grid, input, "grid index");
+    if (!position.ok) {
+        return position.error;
+    }
+    if (!position.inside) {
+        return makeErrorExpression(grid.range, "Grid position out of range");
+    }
+    return storage.evaluated_grids.at(grid.index).cells.at(position.index);
+}
+
+Expression applyGridIndexingTypes(Expression grid) {
+    if (isEmptyGrid(grid)) {
+        return Expression{0, grid.range, ANY};
+    }
+    return storage.evaluated_grids.at(grid.index).cells.at(0);
+}
+
+bool isGridEqual(Expression left, Expression right) {
+    const auto& left_struct = storage.evaluated_grids.at(left.index);
+    const auto& right_struct = storage.evaluated_grids.at(right.index);
+    if (left_struct.width != right_struct.width || left_struct.height != right_struct.height) {
+        return false;
+    }
+    for (size_t i = 0; i < left_struct.cells.size(); ++i) {
+        if (!isEqual(left_struct.cells[i], right_struct.cells[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+namespace grid_functions {
+
+Expression grid(Expression in) {
+    switch (in.type) {
+        case ERROR_EXPRESSION: return in;
+        case STRING: return makeGridFromString(in);
+        case EMPTY_STRING: return makeEvaluatedGrid(in.range, EvaluatedGrid{0, 0, {}});
+        case EVALUATED_STACK: return makeGridFromRows(in);
+        case EVALUATED_RANGE: return makeGridFromRows(in);
+        case EMPTY_STACK: return makeEvaluatedGrid(in.range, EvaluatedGrid{0, 0, {}});
+        case EVALUATED_TUPLE: return makeFilledGrid(in);
+        case EVALUATED_GRID: {
+            auto copy = storage.evaluated_grids.at(in.index);
+            return makeEvaluatedGrid(in.range, std::move(copy));
+        }
+        default: return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The grid function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+}
+
+Expression gridTyped(Expression in) {
+    switch (in.type) {
+        case ERROR_EXPRESSION: return in;
+        case ANY: return makeGridType(in.range, in);
+        case STRING: return makeGridType(in.range, Expression{0, in.range, CHARACTER});
+        case EMPTY_STRING: return makeGridType(in.range, Expression{0, in.range, CHARACTER});
+        case EVALUATED_STACK: {
+            const auto row = container_functions::takeTyped(in);
+            if (row.type == ERROR_EXPRESSION) {
+                return row;
+            }
+            if (row.type == EMPTY_STACK || row.type == ANY) {
+                return makeGridType(in.range, Expression{0, in.range, ANY});
+            }
+            if (!isRowContainer(row)) {
+                return makeErrorExpression(in.range,
+                    "I found an error during type checking.\n"
+                    "The grid function expected rows that are stacks or strings, but it got %s %s.",
+                    getExpressionArticle(row.type), getExpressionName(row.type)
+                );
+            }
+            return makeGridType(in.range, container_functions::takeTyped(row));
+        }
+        case EMPTY_STACK: return makeGridType(in.range, Expression{0, in.range, ANY});
+        case EVALUATED_TUPLE: {
+            Expression items[3];
+            if (!getItems(in, items, 3)) {
+                return makeErrorExpression(in.range,
+                    "I found an error during type checking.\n"
+                    "The grid function expected a tuple (width height value)."
+                );
+            }
+            return makeGridType(in.range, items[2]);
+        }
+        case EVALUATED_GRID: return in;
+        default: return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The grid function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+}
+
+Expression rows(Expression in) {
+    if (in.type != EVALUATED_GRID) {
+        return gridError(in, "rows");
+    }
+    const auto& grid = storage.evaluated_grids.at(in.index);
+    auto result = Expression{0, in.range, EMPTY_STACK};
+    for (size_t y = grid.height; y > 0; --y) {
+        result = putEvaluatedStack(result, makeStackFromCells(grid.cells, (y - 1) * grid.width, 1, grid.width));
+    }
+    return result;
+}
+
+Expression rowsTyped(Expression in) {
+    return nestedStackType(in);
+}
+
+Expression columns(Expression in) {
+    if (in.type != EVALUATED_GRID) {
+        return gridError(in, "columns");
+    }
+    const auto& grid = storage.evaluated_grids.at(in.index);
+    auto result = Expression{0, in.range, EMPTY_STACK};
+    for (size_t x = grid.width; x > 0; --x) {
+        result = putEvaluatedStack(result, makeStackFromCells(grid.cells, x - 1, grid.width, grid.height));
+    }
+    return result;
+}
+
+Expression columnsTyped(Expression in) {
+    return nestedStackType(in);
+}
+
+}
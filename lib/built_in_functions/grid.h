@@ -0,0 +1,22 @@
+#pragma once
+
+#include "../expression.h"
+
+bool isEmptyGrid(Expression grid);
+Expression putGrid(Expression grid, Expression item);
+Expression putGridTyped(Expression grid, Expression item);
+Expression getGrid(Expression key, Expression grid, Expression default_value);
+Expression applyGridIndexing(Expression grid, Expression input);
+Expression applyGridIndexingTypes(Expression grid);
+bool isGridEqual(Expression left, Expression right);
+
+namespace grid_functions {
+
+Expression grid(Expression in);
+Expression gridTyped(Expression in);
+Expression rows(Expression in);
+Expression rowsTyped(Expression in);
+Expression columns(Expression in);
+Expression columnsTyped(Expression in);
+
+}
@@ -0,0 +1,137 @@
+#include "memo.h"
+
+#include <carma/carma.h>
+
+#include "../factory.h"
+#include "../passes/evaluate.h"
+
+namespace {
+
+// The number of results that are kept for each memoized function.
+// The least recently used result is dropped when there are more.
+const size_t MEMO_CAPACITY = 1 << 16;
+
+} // namespace
+
+bool isMemoValue(Expression expression) {
+    switch (expression.type) {
+        case NUMBER: return true;
+        case INTEGER: return true;
+        case CHARACTER: return true;
+        case YES: return true;
+        case NO: return true;
+        case EMPTY_STACK: return true;
+        case EMPTY_STRING: return true;
+        case STRING: return true;
+        case EVALUATED_STACK: {
+            for (auto item = expression; item.type == EVALUATED_STACK;) {
+                const auto stack = storage.evaluated_stacks.data[item.index];
+                if (!isMemoValue(stack.top)) {
+                    return false;
+                }
+                item = stack.rest;
+            }
+            return true;
+        }
+        case EVALUATED_TUPLE: {
+            FOR_EACH(i, storage.evaluated_tuples.data[expression.index].indices) {
+                if (!isMemoValue(storage.expressions.data[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+
+MemoLookup lookupMemo(size_t cache, size_t hash, Expression input) {
+    auto& memo_cache = storage.memo_caches.at(cache);
+    const auto range = memo_cache.index.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto entry = it->second;
+        if (isEqual(entry->input, input)) {
+            memo_cache.entries.splice(memo_cache.entries.begin(), memo_cache.entries, entry);
+            ++memo_cache.hits;
+            return MemoLookup{entry->output, true};
+        }
+    }
+    ++memo_cache.misses;
+    return MemoLookup{Expression{}, false};
+}
+
+void storeMemo(size_t cache, size_t hash, Expression input, Expression output) {
+    auto& memo_cache = storage.memo_caches.at(cache);
+    memo_cache.entries.push_front(MemoEntry{hash, input, output});
+    memo_cache.index.emplace(hash, memo_cache.entries.begin());
+    if (memo_cache.entries.size() <= MEMO_CAPACITY) {
+        return;
+    }
+    const auto oldest = std::prev(memo_cache.entries.end());
+    const auto range = memo_cache.index.equal_range(oldest->hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        if (it->second == oldest) {
+            memo_cache.index.erase(it);
+            break;
+        }
+    }
+    memo_cache.entries.erase(oldest);
+}
+
+namespace memo_functions {
+
+Expression memo(Expression in) {
+    if (in.type != FUNCTION && in.type != FUNCTION_TUPLE) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The memo function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    storage.memo_caches.emplace_back();
+    return makeFunctionMemo(in.range, FunctionMemo{in, storage.memo_caches.size() - 1});
+}
+
+// The type of a memoized function is the type of the function that it caches.
+Expression memoTyped(Expression in) {
+    if (in.type != FUNCTION && in.type != FUNCTION_TUPLE && in.type != ANY) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The memo function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    return in;
+}
+
+Expression memoStatistics(Expression in) {
+    if (in.type != FUNCTION_MEMO) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The memo_statistics function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    const auto cache = storage.memo_functions.data[in.index].cache;
+    const auto& memo_cache = storage.memo_caches.at(cache);
+    return makeEvaluatedTuple2(
+        makeNumber(in.range, (Number)memo_cache.hits),
+        makeNumber(in.range, (Number)memo_cache.misses)
+    );
+}
+
+Expression memoStatisticsTyped(Expression in) {
+    if (in.type != FUNCTION && in.type != FUNCTION_TUPLE && in.type != ANY) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The memo_statistics function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    return makeEvaluatedTuple2(
+        makeNumber(in.range, 0),
+        makeNumber(in.range, 0)
+    );
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "../expression.h"
+
+struct MemoLookup {
+    Expression value;
+    bool ok;
+};
+
+// Only inputs and outputs that are compared by value are cached.
+// Dictionaries, functions, tables and grids are not,
+// since they can change or can not be compared.
+bool isMemoValue(Expression expression);
+MemoLookup lookupMemo(size_t cache, size_t hash, Expression input);
+void storeMemo(size_t cache, size_t hash, Expression input, Expression output);
+
+namespace memo_functions {
+
+Expression memo(Expression in);
+Expression memoTyped(Expression in);
+Expression memoStatistics(Expression in);
+Expression memoStatisticsTyped(Expression in);
+
+}
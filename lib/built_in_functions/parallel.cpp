@@ -0,0 +1,346 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <unordered_set>
+#include <vector>
+
+#include "binary_tuple.h"
+#include "container.h"
+#include "../factory.h"
+#include "../passes/evaluate.h"
+#include "../workers.h"
+
+namespace {
+
+// More chunks than workers let workers that are done early take the remaining chunks.
+const size_t CHUNKS_PER_WORKER = 4;
+
+struct Chunk {
+    size_t begin;
+    size_t end;
+};
+
+bool isParallelContainer(Expression container) {
+    switch (container.type) {
+        case EVALUATED_STACK: return true;
+        case EVALUATED_RANGE: return true;
+        case EMPTY_STACK: return true;
+        case STRING: return true;
+        case EMPTY_STRING: return true;
+        default: return false;
+    }
+}
+
+bool isParallelContainerType(Expression container) {
+    return container.type == ANY ||
+        (container.type != EVALUATED_RANGE && isParallelContainer(container));
+}
+
+std::vector<Expression> containerItems(Expression container) {
+    auto items = std::vector<Expression>{};
+    for (auto c = container; c.type == EVALUATED_STACK || c.type == EVALUATED_RANGE || c.type == STRING;) {
+        items.push_back(container_functions::take(c));
+        c = container_functions::drop(c);
+    }
+    return items;
+}
+
+// The built-ins have no environment, and the standard library is evaluated in the built-ins.
+// Its tables and grids are only used as types, and nothing puts items to them.
+bool isStandardLibrary(Expression dictionary) {
+    const auto environment = storage.evaluated_dictionaries.data[dictionary.index].environment;
+    return environment.type != EVALUATED_DICTIONARY ||
+        storage.evaluated_dictionaries.data[environment.index].environment.type != EVALUATED_DICTIONARY;
+}
+
+// Workers can not put items to tables and grids of the interpreter, since they only have a copy.
+// So tasks that can reach them through their function or items are evaluated by the interpreter.
+// Deferred definitions do not depend on tables or grids, so they are not followed.
+bool canReachMutable(Expression expression, std::unordered_set<size_t>& visited) {
+    switch (expression.type) {
+        case EVALUATED_TABLE: return true;
+        case EVALUATED_TABLE_VIEW: return true;
+        case EVALUATED_GRID: return true;
+        case EVALUATED_STACK: {
+            for (auto item = expression; item.type == EVALUATED_STACK;) {
+                const auto stack = storage.evaluated_stacks.data[item.index];
+                if (canReachMutable(stack.top, visited)) {
+                    return true;
+                }
+                item = stack.rest;
+            }
+            return false;
+        }
+        case EVALUATED_TUPLE: {
+            FOR_EACH(i, storage.evaluated_tuples.data[expression.index].indices) {
+                if (canReachMutable(storage.expressions.data[i], visited)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        case EVALUATED_DEQUE: {
+            const auto deque = storage.evaluated_deques.data[expression.index];
+            const auto& items = storage.deque_buffers.at(deque.buffer);
+            for (auto i = deque.first; i < deque.last; ++i) {
+                if (canReachMutable(items.at(i), visited)) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default: break;
+    }
+    // Dictionaries and functions are visited once, since closures can refer back to them.
+    if (!visited.insert(expression.index * 256 + expression.type).second) {
+        return false;
+    }
+    switch (expression.type) {
+        case EVALUATED_DICTIONARY: {
+            if (isStandardLibrary(expression)) {
+                return false;
+            }
+            const auto dictionary = storage.evaluated_dictionaries.data[expression.index];
+            FOR_EACH(i, dictionary.definitions) {
+                if (canReachMutable(storage.definitions.data[i].expression, visited)) {
+                    return true;
+                }
+            }
+            return canReachMutable(dictionary.environment, visited);
+        }
+        case FUNCTION: return canReachMutable(storage.functions.data[expression.index].environment, visited);
+        case FUNCTION_TUPLE: return canReachMutable(storage.tuple_functions.data[expression.index].environment, visited);
+        case FUNCTION_DICTIONARY: return canReachMutable(storage.dictionary_functions.data[expression.index].environment, visited);
+        case FUNCTION_MEMO: return canReachMutable(storage.memo_functions.data[expression.index].function, visited);
+        default: return false;
+    }
+}
+
+bool canReachMutable(Expression function, const std::vector<Expression>& items, Expression init) {
+    auto visited = std::unordered_set<size_t>{};
+    if (canReachMutable(function, visited) || canReachMutable(init, visited)) {
+        return true;
+    }
+    for (const auto& item : items) {
+        if (canReachMutable(item, visited)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::vector<Chunk> makeChunks(size_t item_count, bool is_in_process) {
+    const auto workers = is_in_process ? 1 : getWorkerCount();
+    const auto count = workers < 2 ? std::min(item_count, size_t{1}) :
+        std::min(item_count, workers * CHUNKS_PER_WORKER);
+    auto chunks = std::vector<Chunk>{};
+    for (size_t i = 0; i < count; ++i) {
+        chunks.push_back(Chunk{i * item_count / count, (i + 1) * item_count / count});
+    }
+    return chunks;
+}
+
+Expression makeTupleOfItems(const std::vector<Expression>& items) {
+    const auto first = storage.expressions.count;
+    for (const auto& item : items) {
+        APPEND(storage.expressions, item);
+    }
+    return makeEvaluatedTuple(CodeRange{}, EvaluatedTuple{Indices{first, items.size()}});
+}
+
+Expression makeContainerError(Expression in, Expression container, const char* function) {
+    return makeErrorExpression(in.range,
+        "I found an error during evaluation.\n"
+        "The %s function received %s %s, which it did not expect.",
+        function,
+        getExpressionArticle(container.type), getExpressionName(container.type)
+    );
+}
+
+Expression makeContainerTypeError(Expression in, Expression container, const char* function) {
+    return makeErrorExpression(in.range,
+        "I found an error during type checking.\n"
+        "The %s function received %s %s, which it did not expect.",
+        function,
+        getExpressionArticle(container.type), getExpressionName(container.type)
+    );
+}
+
+struct FoldTuple {
+    Expression operation;
+    Expression container;
+    Expression init;
+    Expression error;
+    bool ok;
+};
+
+FoldTuple getFoldTuple(Expression in) {
+    auto result = MAKE(FoldTuple);
+    if (in.type != EVALUATED_TUPLE) {
+        result.error = makeErrorExpression(
+            in.range,
+            "I found a type error while calling the function parallel_fold. "
+            "The function expected a tuple of three items, "
+            "but it got %s %s",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+        return result;
+    }
+    const auto indices = storage.evaluated_tuples.data[in.index].indices;
+    if (indices.count != 3) {
+        result.error = makeErrorExpression(
+            in.range,
+            "I found a type error while calling the function parallel_fold. "
+            "The function expected a tuple of three items, "
+            "but it got %zu items.",
+            indices.count
+        );
+        return result;
+    }
+    result.operation = storage.expressions.data[indices.data + 0];
+    result.container = storage.expressions.data[indices.data + 1];
+    result.init = storage.expressions.data[indices.data + 2];
+    result.ok = true;
+    return result;
+}
+
+} // namespace
+
+namespace parallel_functions {
+
+// Each worker maps a chunk of items to a tuple of results.
+Expression parallelMap(Expression in) {
+    const auto tuple = getBinaryTuple(in, "parallel_map");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    const auto function = tuple.left;
+    const auto container = tuple.right;
+    if (container.type == ERROR_EXPRESSION) {
+        return container;
+    }
+    if (!isParallelContainer(container)) {
+        return makeContainerError(in, container, "parallel_map");
+    }
+    const auto items = containerItems(container);
+    const auto chunks = makeChunks(items.size(), canReachMutable(function, items, Expression{}));
+    const auto chunk_results = evaluateTasks(chunks.size(), [&](size_t i) {
+        auto outputs = std::vector<Expression>{};
+        for (auto j = chunks[i].begin; j < chunks[i].end; ++j) {
+            const auto output = applyFunctionValue(in.range, function, items[j]);
+            if (output.type == ERROR_EXPRESSION) {
+                return output;
+            }
+            outputs.push_back(output);
+        }
+        return makeTupleOfItems(outputs);
+    });
+    auto outputs = std::vector<Expression>{};
+    outputs.reserve(items.size());
+    for (const auto& chunk_result : chunk_results) {
+        if (chunk_result.type == ERROR_EXPRESSION) {
+            return chunk_result;
+        }
+        FOR_EACH(j, storage.evaluated_tuples.data[chunk_result.index].indices) {
+            outputs.push_back(storage.expressions.data[j]);
+        }
+    }
+    auto result = container_functions::clear(container);
+    for (auto it = outputs.rbegin(); it != outputs.rend(); ++it) {
+        result = container_functions::putBinary(*it, result);
+    }
+    return result;
+}
+
+Expression parallelMapTyped(Expression in) {
+    const auto tuple = getBinaryTuple(in, "parallel_map");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    const auto container = tuple.right;
+    if (container.type == ERROR_EXPRESSION) {
+        return container;
+    }
+    if (!isParallelContainerType(container)) {
+        return makeContainerTypeError(in, container, "parallel_map");
+    }
+    if (container.type != EVALUATED_STACK && container.type != STRING) {
+        return container;
+    }
+    const auto output = applyFunctionValueTypes(
+        in.range, tuple.left, container_functions::takeTyped(container)
+    );
+    if (output.type == ERROR_EXPRESSION) {
+        return output;
+    }
+    const auto empty = container.type == STRING ?
+        Expression{0, in.range, EMPTY_STRING} : Expression{0, in.range, EMPTY_STACK};
+    return container_functions::putTypedBinary(output, empty);
+}
+
+// Each worker folds a chunk of items, starting from the initial value.
+Expression parallelFold(Expression in) {
+    const auto tuple = getFoldTuple(in);
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    if (tuple.container.type == ERROR_EXPRESSION) {
+        return tuple.container;
+    }
+    if (!isParallelContainer(tuple.container)) {
+        return makeContainerError(in, tuple.container, "parallel_fold");
+    }
+    const auto items = containerItems(tuple.container);
+    const auto chunks = makeChunks(
+        items.size(), canReachMutable(tuple.operation, items, tuple.init)
+    );
+    const auto chunk_results = evaluateTasks(chunks.size(), [&](size_t i) {
+        auto result = tuple.init;
+        for (auto j = chunks[i].begin; j < chunks[i].end; ++j) {
+            result = applyFunctionValue(
+                in.range, tuple.operation, makeEvaluatedTuple2(items[j], result)
+            );
+            if (result.type == ERROR_EXPRESSION) {
+                return result;
+            }
+        }
+        return result;
+    });
+    if (chunk_results.empty()) {
+        return tuple.init;
+    }
+    auto result = chunk_results.front();
+    for (size_t i = 1; i < chunk_results.size(); ++i) {
+        if (result.type == ERROR_EXPRESSION) {
+            return result;
+        }
+        if (chunk_results[i].type == ERROR_EXPRESSION) {
+            return chunk_results[i];
+        }
+        result = applyFunctionValue(
+            in.range, tuple.operation, makeEvaluatedTuple2(chunk_results[i], result)
+        );
+    }
+    return result;
+}
+
+Expression parallelFoldTyped(Expression in) {
+    const auto tuple = getFoldTuple(in);
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    if (tuple.container.type == ERROR_EXPRESSION) {
+        return tuple.container;
+    }
+    if (!isParallelContainerType(tuple.container)) {
+        return makeContainerTypeError(in, tuple.container, "parallel_fold");
+    }
+    if (tuple.container.type != EVALUATED_STACK && tuple.container.type != STRING) {
+        return tuple.init;
+    }
+    return applyFunctionValueTypes(in.range, tuple.operation, makeEvaluatedTuple2(
+        container_functions::takeTyped(tuple.container), tuple.init
+    ));
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include "../expression.h"
+
+// The items are split into chunks that are evaluated by workers, see workers.h.
+// The functions must not put items in tables that they did not create,
+// since workers put items in their own copies of the tables.
+namespace parallel_functions {
+
+Expression parallelMap(Expression in);
+Expression parallelMapTyped(Expression in);
+// The operation must be associative, and the initial value must not change
+// what it is combined with, like 0 for add, since each chunk is folded from it
+// and the results of the chunks are then combined with the operation.
+Expression parallelFold(Expression in);
+Expression parallelFoldTyped(Expression in);
+
+}
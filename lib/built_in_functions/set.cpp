@@ -0,0 +1,308 @@
+#include "set.h"
+
+#include "binary_tuple.h"
+#include "container.h"
+#include "../factory.h"
+#include "../passes/evaluate.h"
+
+namespace {
+
+EvaluatedSet copySet(EvaluatedSet set) {
+    auto buffer = SetBuffer{};
+    const auto& items = storage.set_buffers.at(set.buffer).items;
+    for (auto i = set.first; i < set.last; ++i) {
+        buffer.positions.emplace(hashExpression(items.at(i)), buffer.items.size());
+        buffer.items.push_back(items.at(i));
+    }
+    storage.set_buffers.push_back(std::move(buffer));
+    return EvaluatedSet{storage.set_buffers.size() - 1, 0, set.last - set.first};
+}
+
+// Items are found by their hash, which would be wrong after items that can change, change.
+bool isSetItem(Expression item) {
+    switch (item.type) {
+        case EVALUATED_TABLE: return false;
+        case EVALUATED_TABLE_VIEW: return false;
+        case EVALUATED_GRID: return false;
+        case EVALUATED_STACK: {
+            for (auto i = item; i.type == EVALUATED_STACK;) {
+                const auto stack = storage.evaluated_stacks.data[i.index];
+                if (!isSetItem(stack.top)) {
+                    return false;
+                }
+                i = stack.rest;
+            }
+            return true;
+        }
+        case EVALUATED_TUPLE: {
+            FOR_EACH(i, storage.evaluated_tuples.data[item.index].indices) {
+                if (!isSetItem(storage.expressions.data[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default: return true;
+    }
+}
+
+Expression makeSetFrom(Expression in) {
+    auto result = makeEmptySet(in.range);
+    for (auto container = in; boolean(container).value; container = container_functions::drop(container)) {
+        result = putSet(result, container_functions::take(container));
+        if (result.type == ERROR_EXPRESSION) {
+            return result;
+        }
+    }
+    return result;
+}
+
+bool isSetInput(Expression in) {
+    switch (in.type) {
+        case EVALUATED_STACK: return true;
+        case EVALUATED_RANGE: return true;
+        case EVALUATED_DEQUE: return true;
+        case EVALUATED_SET: return true;
+        case EMPTY_STACK: return true;
+        case STRING: return true;
+        case EMPTY_STRING: return true;
+        default: return false;
+    }
+}
+
+struct SetPair {
+    Expression left;
+    Expression right;
+    Expression error;
+    bool ok;
+};
+
+SetPair getSetPair(Expression in, const char* function) {
+    const auto tuple = getBinaryTuple(in, function);
+    if (!tuple.ok) {
+        return SetPair{{}, {}, tuple.error, false};
+    }
+    if (tuple.left.type != EVALUATED_SET || tuple.right.type != EVALUATED_SET) {
+        const auto other = tuple.left.type != EVALUATED_SET ? tuple.left : tuple.right;
+        const auto error = other.type == ERROR_EXPRESSION ? other : makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The %s function expected two sets, but it got %s %s.",
+            function,
+            getExpressionArticle(other.type), getExpressionName(other.type)
+        );
+        return SetPair{{}, {}, error, false};
+    }
+    return SetPair{tuple.left, tuple.right, {}, true};
+}
+
+} // namespace
+
+Expression makeEmptySet(CodeRange code) {
+    storage.set_buffers.emplace_back();
+    return makeEvaluatedSet(code, EvaluatedSet{storage.set_buffers.size() - 1, 0, 0});
+}
+
+bool isEmptySet(Expression set) {
+    const auto set_struct = storage.evaluated_sets.data[set.index];
+    return set_struct.first == set_struct.last;
+}
+
+bool setContains(Expression set, Expression item) {
+    const auto set_struct = storage.evaluated_sets.data[set.index];
+    const auto& buffer = storage.set_buffers.at(set_struct.buffer);
+    const auto range = buffer.positions.equal_range(hashExpression(item));
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto position = it->second;
+        if (set_struct.first <= position && position < set_struct.last &&
+            isEqual(buffer.items.at(position), item)
+        ) {
+            return true;
+        }
+    }
+    return false;
+}
+
+Expression putSet(Expression set, Expression item) {
+    if (item.type == ERROR_EXPRESSION) {
+        return item;
+    }
+    if (!isSetItem(item)) {
+        return makeErrorExpression(item.range,
+            "I found an error during evaluation.\n"
+            "A set can not contain tables or grids, since they can change."
+        );
+    }
+    if (setContains(set, item)) {
+        return set;
+    }
+    auto set_struct = storage.evaluated_sets.data[set.index];
+    if (set_struct.last != storage.set_buffers.at(set_struct.buffer).items.size()) {
+        set_struct = copySet(set_struct);
+    }
+    auto& buffer = storage.set_buffers.at(set_struct.buffer);
+    buffer.positions.emplace(hashExpression(item), buffer.items.size());
+    buffer.items.push_back(item);
+    ++set_struct.last;
+    return makeEvaluatedSet(set.range, set_struct);
+}
+
+Expression takeSet(Expression set) {
+    const auto set_struct = storage.evaluated_sets.data[set.index];
+    if (set_struct.first == set_struct.last) {
+        return makeErrorExpression(set.range, "Cannot take item from empty set");
+    }
+    return storage.set_buffers.at(set_struct.buffer).items.at(set_struct.first);
+}
+
+Expression takeSetTyped(Expression set) {
+    if (isEmptySet(set)) {
+        return Expression{0, set.range, ANY};
+    }
+    return takeSet(set);
+}
+
+Expression dropSet(Expression set) {
+    auto set_struct = storage.evaluated_sets.data[set.index];
+    if (set_struct.first == set_struct.last) {
+        return set;
+    }
+    ++set_struct.first;
+    return makeEvaluatedSet(set.range, set_struct);
+}
+
+namespace set_functions {
+
+Expression set(Expression in) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    if (!isSetInput(in)) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The set function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    return makeSetFrom(in);
+}
+
+Expression setTyped(Expression in) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    if (in.type == ANY) {
+        return makeEmptySet(in.range);
+    }
+    if (!isSetInput(in)) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The set function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    return container_functions::putTypedBinary(
+        container_functions::takeTyped(in), makeEmptySet(in.range)
+    );
+}
+
+Expression contains(Expression in) {
+    const auto tuple = getBinaryTuple(in, "contains");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    if (tuple.right.type == ERROR_EXPRESSION) {
+        return tuple.right;
+    }
+    if (tuple.right.type != EVALUATED_SET) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The contains function expected a set, but it got %s %s.",
+            getExpressionArticle(tuple.right.type), getExpressionName(tuple.right.type)
+        );
+    }
+    const auto type = setContains(tuple.right, tuple.left) ? YES : NO;
+    return Expression{0, in.range, type};
+}
+
+Expression containsTyped(Expression in) {
+    const auto tuple = getBinaryTuple(in, "contains");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    if (tuple.right.type == ERROR_EXPRESSION) {
+        return tuple.right;
+    }
+    if (tuple.right.type != EVALUATED_SET && tuple.right.type != ANY) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The contains function expected a set, but it got %s %s.",
+            getExpressionArticle(tuple.right.type), getExpressionName(tuple.right.type)
+        );
+    }
+    return Expression{0, in.range, NO};
+}
+
+Expression setUnion(Expression in) {
+    const auto pair = getSetPair(in, "union");
+    if (!pair.ok) {
+        return pair.error;
+    }
+    auto result = pair.left;
+    for (auto set = pair.right; !isEmptySet(set); set = dropSet(set)) {
+        result = putSet(result, takeSet(set));
+    }
+    return result;
+}
+
+Expression setIntersection(Expression in) {
+    const auto pair = getSetPair(in, "intersection");
+    if (!pair.ok) {
+        return pair.error;
+    }
+    auto result = makeEmptySet(in.range);
+    for (auto set = pair.left; !isEmptySet(set); set = dropSet(set)) {
+        const auto item = takeSet(set);
+        if (setContains(pair.right, item)) {
+            result = putSet(result, item);
+        }
+    }
+    return result;
+}
+
+Expression setDifference(Expression in) {
+    const auto pair = getSetPair(in, "difference");
+    if (!pair.ok) {
+        return pair.error;
+    }
+    auto result = makeEmptySet(in.range);
+    for (auto set = pair.left; !isEmptySet(set); set = dropSet(set)) {
+        const auto item = takeSet(set);
+        if (!setContains(pair.right, item)) {
+            result = putSet(result, item);
+        }
+    }
+    return result;
+}
+
+// The result of union, intersection and difference has the type of the left set.
+Expression setOperationTyped(Expression in) {
+    const auto tuple = getBinaryTuple(in, "set operation");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    for (const auto set : {tuple.left, tuple.right}) {
+        if (set.type == ERROR_EXPRESSION) {
+            return set;
+        }
+        if (set.type != EVALUATED_SET && set.type != ANY) {
+            return makeErrorExpression(in.range,
+                "I found an error during type checking.\n"
+                "The set operation expected two sets, but it got %s %s.",
+                getExpressionArticle(set.type), getExpressionName(set.type)
+            );
+        }
+    }
+    return tuple.left.type == ANY ? tuple.right : tuple.left;
+}
+
+}
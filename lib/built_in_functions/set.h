@@ -0,0 +1,24 @@
+#pragma once
+
+#include "../expression.h"
+
+Expression makeEmptySet(CodeRange code);
+bool isEmptySet(Expression set);
+bool setContains(Expression set, Expression item);
+Expression putSet(Expression set, Expression item);
+Expression takeSet(Expression set);
+Expression takeSetTyped(Expression set);
+Expression dropSet(Expression set);
+
+namespace set_functions {
+
+Expression set(Expression in);
+Expression setTyped(Expression in);
+Expression contains(Expression in);
+Expression containsTyped(Expression in);
+Expression setUnion(Expression in);
+Expression setIntersection(Expression in);
+Expression setDifference(Expression in);
+Expression setOperationTyped(Expression in);
+
+}
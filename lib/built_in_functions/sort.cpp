@@ -0,0 +1,394 @@
+#include "sort.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "binary_tuple.h"
+#include "container.h"
+#include "../factory.h"
+#include "../passes/evaluate.h"
+
+namespace {
+
+struct SortItem {
+    uint64_t key; // Only used for radix sort.
+    size_t index;
+};
+
+bool isSortable(Expression container) {
+    switch (container.type) {
+        case EVALUATED_STACK: return true;
+        case EVALUATED_RANGE: return true;
+        case EMPTY_STACK: return true;
+        case STRING: return true;
+        case EMPTY_STRING: return true;
+        default: return false;
+    }
+}
+
+bool isSortableType(Expression container) {
+    return container.type == ANY || (container.type != EVALUATED_RANGE && isSortable(container));
+}
+
+// Returns false for items that the type pass knows can not be ordered.
+bool isOrderedType(Expression item) {
+    switch (item.type) {
+        case ANY: return true;
+        case NUMBER: return true;
+        case INTEGER: return true;
+        case CHARACTER: return true;
+        case STRING: return true;
+        case EMPTY_STRING: return true;
+        case EVALUATED_STACK: return true;
+        case EMPTY_STACK: return true;
+        case EVALUATED_TUPLE: return true;
+        default: return false;
+    }
+}
+
+bool isStackLike(Expression expression) {
+    return expression.type == EVALUATED_STACK ||
+        expression.type == EVALUATED_RANGE ||
+        expression.type == EMPTY_STACK;
+}
+
+bool isStringLike(Expression expression) {
+    return expression.type == STRING || expression.type == EMPTY_STRING;
+}
+
+// Maps numbers to unsigned integers with the same order,
+// so that they can be sorted by their bits.
+uint64_t sortableBits(Number number) {
+    // Zero and negative zero are equal, so they should have the same bits.
+    number = number + 0.0;
+    auto bits = uint64_t{0};
+    memcpy(&bits, &number, sizeof(number));
+    const auto sign = uint64_t{1} << 63;
+    return (bits & sign) ? ~bits : bits | sign;
+}
+
+int compareBits(uint64_t left, uint64_t right) {
+    return left < right ? -1 : right < left ? 1 : 0;
+}
+
+uint64_t radixKey(Expression item) {
+    if (item.type == CHARACTER) {
+        return (uint64_t)(unsigned char)getCharacter(item);
+    }
+    if (item.type == INTEGER) {
+        return (uint64_t)getInteger(item) ^ (uint64_t{1} << 63);
+    }
+    return sortableBits(getNumber(item));
+}
+
+// Compares an integer with a number exactly,
+// since converting an integer to a number can round it.
+int compareIntegerNumber(Integer left, Number right) {
+    if (isnan(right)) {
+        return compareBits(sortableBits((Number)left), sortableBits(right));
+    }
+    if (right >= 9223372036854775808.0) {
+        return -1;
+    }
+    if (right < -9223372036854775808.0) {
+        return 1;
+    }
+    const auto truncated = (Integer)right;
+    if (left != truncated) {
+        return left < truncated ? -1 : 1;
+    }
+    const auto fraction = right - (Number)truncated;
+    return fraction > 0 ? -1 : fraction < 0 ? 1 : 0;
+}
+
+int compareNumbers(Expression left, Expression right) {
+    if (left.type == INTEGER && right.type == INTEGER) {
+        return compareBits(radixKey(left), radixKey(right));
+    }
+    if (left.type == INTEGER) {
+        return compareIntegerNumber(getInteger(left), getNumber(right));
+    }
+    if (right.type == INTEGER) {
+        return -compareIntegerNumber(getInteger(right), getNumber(left));
+    }
+    return compareBits(sortableBits(getNumber(left)), sortableBits(getNumber(right)));
+}
+
+int compareSequences(Expression left, Expression right, Comparison& comparison) {
+    for (;;) {
+        const auto left_empty = left.type == EMPTY_STACK || left.type == EMPTY_STRING;
+        const auto right_empty = right.type == EMPTY_STACK || right.type == EMPTY_STRING;
+        if (left_empty || right_empty) {
+            return left_empty && right_empty ? 0 : left_empty ? -1 : 1;
+        }
+        const auto result = compareExpressions(
+            container_functions::take(left), container_functions::take(right), comparison
+        );
+        if (result != 0) {
+            return result;
+        }
+        left = container_functions::drop(left);
+        right = container_functions::drop(right);
+    }
+}
+
+int compareTuples(EvaluatedTuple left, EvaluatedTuple right, Comparison& comparison) {
+    FOR_EACH2(left_index, right_index, left.indices, right.indices) {
+        const auto result = compareExpressions(
+            storage.expressions.data[left_index], storage.expressions.data[right_index], comparison
+        );
+        if (result != 0) {
+            return result;
+        }
+    }
+    return compareBits(left.indices.count, right.indices.count);
+}
+
+// Stacks, ranges and strings of any length are ordered by their items.
+ExpressionType comparedType(Expression expression) {
+    if (isStackLike(expression)) {
+        return EVALUATED_STACK;
+    }
+    if (isStringLike(expression)) {
+        return STRING;
+    }
+    if (expression.type == INTEGER) {
+        return NUMBER;
+    }
+    return expression.type;
+}
+
+// Returns true if all items are integers, all items are other numbers,
+// or all items are characters.
+bool isRadixSortable(const std::vector<Expression>& items) {
+    if (items.empty()) {
+        return false;
+    }
+    const auto type = items.front().type;
+    if (type != NUMBER && type != INTEGER && type != CHARACTER) {
+        return false;
+    }
+    for (const auto& item : items) {
+        if (item.type != type) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Stable least significant digit radix sort, one byte at a time.
+// Bytes that are the same for all keys are skipped.
+void radixSort(std::vector<SortItem>& items) {
+    auto buffer = std::vector<SortItem>(items.size());
+    for (auto shift = 0; shift < 64; shift += 8) {
+        size_t counts[256] = {};
+        for (const auto& item : items) {
+            ++counts[(item.key >> shift) & 0xff];
+        }
+        if (counts[(items.front().key >> shift) & 0xff] == items.size()) {
+            continue;
+        }
+        auto offset = size_t{0};
+        for (auto& count : counts) {
+            const auto next = offset + count;
+            count = offset;
+            offset = next;
+        }
+        for (const auto& item : items) {
+            buffer[counts[(item.key >> shift) & 0xff]++] = item;
+        }
+        items.swap(buffer);
+    }
+}
+
+std::vector<Expression> containerItems(Expression container) {
+    auto items = std::vector<Expression>{};
+    for (auto c = container; c.type == EVALUATED_STACK || c.type == EVALUATED_RANGE || c.type == STRING;) {
+        items.push_back(container_functions::take(c));
+        c = container_functions::drop(c);
+    }
+    return items;
+}
+
+// Returns the indices of the items in the order of their keys.
+// Makes the comparison not ok if some keys have no order between them.
+std::vector<SortItem> sortedOrder(const std::vector<Expression>& keys, Comparison& comparison) {
+    auto order = std::vector<SortItem>(keys.size());
+    for (size_t i = 0; i < keys.size(); ++i) {
+        order[i] = SortItem{0, i};
+    }
+    if (isRadixSortable(keys)) {
+        for (auto& item : order) {
+            item.key = radixKey(keys[item.index]);
+        }
+        radixSort(order);
+        return order;
+    }
+    // Compare each key with the first one,
+    // so that keys without an order are found even if the sort skips them.
+    for (const auto& key : keys) {
+        compareExpressions(keys.front(), key, comparison);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](SortItem left, SortItem right) {
+        if (!comparison.ok) {
+            // Keep the order consistent, since the result is not used.
+            return left.index < right.index;
+        }
+        return compareExpressions(keys[left.index], keys[right.index], comparison) < 0;
+    });
+    return order;
+}
+
+Expression makeSortedContainer(
+    Expression container,
+    const std::vector<Expression>& items,
+    const std::vector<SortItem>& order
+) {
+    auto result = container_functions::clear(container);
+    for (auto it = order.rbegin(); it != order.rend(); ++it) {
+        result = container_functions::putBinary(items[it->index], result);
+    }
+    return result;
+}
+
+Expression makeOrderError(Expression in, Comparison comparison, const char* function) {
+    return makeErrorExpression(in.range,
+        "I found an error during evaluation.\n"
+        "The %s function can not order %s %s and %s %s.",
+        function,
+        getExpressionArticle(comparison.left), getExpressionName(comparison.left),
+        getExpressionArticle(comparison.right), getExpressionName(comparison.right)
+    );
+}
+
+} // namespace
+
+int compareExpressions(Expression left, Expression right, Comparison& comparison) {
+    const auto left_type = comparedType(left);
+    const auto right_type = comparedType(right);
+    if (comparison.ok && left_type == right_type) {
+        switch (left_type) {
+            case NUMBER: return compareNumbers(left, right);
+            case CHARACTER: return compareBits(
+                (unsigned char)getCharacter(left), (unsigned char)getCharacter(right)
+            );
+            case EVALUATED_STACK: return compareSequences(left, right, comparison);
+            case STRING: return compareSequences(left, right, comparison);
+            case EVALUATED_TUPLE: return compareTuples(
+                storage.evaluated_tuples.data[left.index],
+                storage.evaluated_tuples.data[right.index],
+                comparison
+            );
+            default: break;
+        }
+    }
+    if (comparison.ok) {
+        comparison = Comparison{false, left_type, right_type};
+    }
+    return 0;
+}
+
+namespace sort_functions {
+
+Expression sort(Expression in) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    if (!isSortable(in)) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The sort function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    const auto items = containerItems(in);
+    auto comparison = Comparison{true, ANY, ANY};
+    const auto order = sortedOrder(items, comparison);
+    if (!comparison.ok) {
+        return makeOrderError(in, comparison, "sort");
+    }
+    return makeSortedContainer(in, items, order);
+}
+
+Expression sortTyped(Expression in) {
+    if (in.type == ERROR_EXPRESSION) {
+        return in;
+    }
+    if (!isSortableType(in)) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The sort function received %s %s, which it did not expect.",
+            getExpressionArticle(in.type), getExpressionName(in.type)
+        );
+    }
+    if (in.type == EVALUATED_STACK) {
+        const auto item = container_functions::take(in);
+        if (!isOrderedType(item)) {
+            return makeErrorExpression(in.range,
+                "I found an error during type checking.\n"
+                "The sort function can not order %s %s.",
+                getExpressionArticle(item.type), getExpressionName(item.type)
+            );
+        }
+    }
+    return in;
+}
+
+Expression sortKey(Expression in) {
+    const auto tuple = getBinaryTuple(in, "sort_key");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    const auto key_function = tuple.left;
+    const auto container = tuple.right;
+    if (container.type == ERROR_EXPRESSION) {
+        return container;
+    }
+    if (!isSortable(container)) {
+        return makeErrorExpression(in.range,
+            "I found an error during evaluation.\n"
+            "The sort_key function received %s %s, which it did not expect.",
+            getExpressionArticle(container.type), getExpressionName(container.type)
+        );
+    }
+    const auto items = containerItems(container);
+    auto keys = std::vector<Expression>{};
+    keys.reserve(items.size());
+    for (const auto& item : items) {
+        const auto key = applyFunctionValue(in.range, key_function, item);
+        if (key.type == ERROR_EXPRESSION) {
+            return key;
+        }
+        keys.push_back(key);
+    }
+    auto comparison = Comparison{true, ANY, ANY};
+    const auto order = sortedOrder(keys, comparison);
+    if (!comparison.ok) {
+        return makeOrderError(in, comparison, "sort_key");
+    }
+    return makeSortedContainer(container, items, order);
+}
+
+Expression sortKeyTyped(Expression in) {
+    const auto tuple = getBinaryTuple(in, "sort_key");
+    if (!tuple.ok) {
+        return tuple.error;
+    }
+    if (tuple.right.type == ERROR_EXPRESSION) {
+        return tuple.right;
+    }
+    if (!isSortableType(tuple.right)) {
+        return makeErrorExpression(in.range,
+            "I found an error during type checking.\n"
+            "The sort_key function received %s %s, which it did not expect.",
+            getExpressionArticle(tuple.right.type), getExpressionName(tuple.right.type)
+        );
+    }
+    return tuple.right;
+}
+
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../expression.h"
+
+// Remembers the first two types that have no order between them.
+struct Comparison {
+    bool ok;
+    ExpressionType left;
+    ExpressionType right;
+};
+
+// Orders numbers, characters, strings, stacks and tuples.
+// Items that are equal according to isEqual compare as equal.
+// Other items, and items of different types, compare as equal
+// and make the comparison not ok.
+int compareExpressions(Expression left, Expression right, Comparison& comparison);
+
+namespace sort_functions {
+
+Expression sort(Expression in);
+Expression sortTyped(Expression in);
+Expression sortKey(Expression in);
+Expression sortKeyTyped(Expression in);
+
+}
@@ -11,6 +11,9 @@ const std::string STANDARD_LIBRARY = R"(
     Stack = []
     String = ""
     Table = <>
+    Deque = deque![]
+    Set = set![]
+    Grid = grid![]
     Numbers = [Number]
     Function = in x out x
 
@@ -209,9 +212,6 @@ const std::string STANDARD_LIBRARY = R"(
         end
     }
 
-    min = in (Number:left Number:right) out Number:if less?(left right) then left else right
-    max = in (Number:left Number:right) out Number:if less?(left right) then right else left
-
     min_item = in Numbers:in_stream out Number:fold!(min in_stream inf)
 
     max_item = in Numbers:in_stream out Number:fold!(max in_stream -inf)
@@ -329,14 +329,6 @@ const std::string STANDARD_LIBRARY = R"(
     count_item = in (item in_stream) out Number:
         count_if!(in x out equal?(x item) in_stream)
 
-    range = in Number:n out Numbers:numbers@{
-        numbers = []
-        m = n
-        for m
-            numbers += dec!m
-        end
-    }
-
     enumerate = in in_stream out Stack:zip2!(range!count!in_stream in_stream)
 
     get0 = in in_stream out in_stream!0
@@ -1,8 +1,11 @@
 #pragma once
 
+#include <list>
 #include <map>
 #include <stdint.h>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 #include "expression_type.h"
 
@@ -26,6 +29,7 @@ struct Expression {
 };
 
 using Number = double;
+using Integer = int64_t;
 using Character = char;
 using ErrorExpression = const char*;
 
@@ -44,9 +48,18 @@ struct BoundLocalName {
     size_t dictionary_index; // Index to this name and its data in the dictionary.
 };
 
+// Outcome of the static type pass for a node that is also checked at run-time.
+// Nodes that the type pass never reaches stay unvisited and are always checked.
+enum TypeProof {
+    TYPE_UNVISITED,
+    TYPE_PROVEN,
+    TYPE_UNPROVEN,
+};
+
 struct Argument {
     Expression type; // Optional
     size_t name;
+    TypeProof proof;
 };
 
 // TODO: type alias instead of struct?
@@ -57,6 +70,93 @@ struct DynamicExpression {
 struct TypedExpression {
     BoundGlobalName type_name;
     Expression value;
+    TypeProof proof;
+};
+
+// Replaces an expression with an equivalent one that is cheaper to evaluate.
+// The original expression is kept for serialization.
+struct FoldedExpression {
+    Expression original;
+    Expression folded;
+};
+
+enum StreamSourceType {
+    STREAM_CONTAINER, // Items of the left container.
+    STREAM_ZIP2, // Tuples of items of the left and right containers.
+};
+
+enum StreamStageType {
+    STREAM_MAP,
+    STREAM_CLEAR_IF,
+};
+
+enum StreamSinkType {
+    STREAM_COLLECT, // Puts the items in a container, in the same order.
+    STREAM_COLLECT_REVERSED, // Puts the items in a container, in reverse order.
+    STREAM_FOLD, // Folds the items with the sink function, starting from the sink input.
+    STREAM_COUNT_IF, // Counts the items that the sink function is true for.
+    STREAM_MAP_GENERIC, // Puts the items mapped by the sink function on the sink input.
+};
+
+struct StreamStage {
+    StreamStageType type;
+    Expression function;
+};
+
+// Replaces a composition of map, fold, reverse, zip2 and similar
+// functions from the standard library with one loop, without intermediate containers.
+// The original expression is evaluated instead when the stream does not apply.
+struct Stream {
+    Expression original;
+    StreamSourceType source;
+    Expression source_left;
+    Expression source_right;
+    Indices stages;
+    StreamSinkType sink;
+    Expression sink_function;
+    Expression sink_input;
+};
+
+enum NumericOperationType {
+    NUMERIC_CONSTANT, // Pushes the number of the operand.
+    NUMERIC_LOCAL, // Pushes the number at index operand.index of the evaluated dictionary.
+    NUMERIC_EXPRESSION, // Pushes the number that the operand evaluates to.
+    NUMERIC_ADD, // Pops two numbers and pushes the result.
+    NUMERIC_SUB,
+    NUMERIC_MUL,
+    NUMERIC_DIV,
+    NUMERIC_MOD,
+    NUMERIC_LESS, // Pops two numbers and gives yes or no. Only as the last operation.
+};
+
+struct NumericOperation {
+    NumericOperationType type;
+    Expression operand;
+};
+
+// Replaces calls of add, sub, mul, div, mod and less, that type checking proves
+// are made with numbers, with operations on a stack of unboxed numbers.
+// The built-in functions are not looked up, and the intermediate results are not boxed.
+// The original expression is evaluated instead when an operand is not a number.
+struct Numeric {
+    Expression original;
+    Indices operations;
+};
+
+// The most numbers that the stack of a numeric expression holds.
+const size_t NUMERIC_STACK_SIZE = 16;
+
+// A definition that is evaluated the first time that its name is looked up.
+// Lazy definitions that it depends on in the same dictionary have lower levels.
+struct LazyExpression {
+    Expression expression;
+    size_t level;
+};
+
+// The value of a lazy expression before it is evaluated.
+struct Thunk {
+    Expression expression;
+    Expression environment;
 };
 
 struct Alternative {
@@ -75,16 +175,42 @@ struct IsExpression {
     Expression expression_else;
 };
 
+// An is-expression where the left side of each alternative is a constant.
+// The matching alternative is looked up by the hash of the input,
+// instead of comparing the input with each alternative in order.
+struct IsTable {
+    Expression is;
+    size_t table;
+};
+
+// The constant left side of an alternative and its index in storage.alternatives.
+struct IsTableEntry {
+    Expression key;
+    size_t alternative;
+};
+
 struct Function {
     Expression environment;
     size_t argument;
     Expression body;
+    size_t environment_steps = 0; // Parents of the environment that the closure skips.
 };
 
 typedef Expression (*FunctionPointer)(Expression);
+typedef Expression (*BinaryFunctionPointer)(Expression, Expression);
+
+// Side effects of a built-in function, for passes that change the order of evaluation.
+enum BuiltInEffect {
+    EFFECT_NONE,
+    EFFECT_MUTABLE_RESULT, // Returns a container that is mutated in place, like a grid.
+    EFFECT_OBSERVES_CALLS, // Observes the calls of other functions, like memo_statistics.
+};
 
 struct FunctionBuiltIn {
     FunctionPointer function;
+    BinaryFunctionPointer binary_function; // Optional. Used for tuple literals of two items.
+    BinaryFunctionPointer proven_binary_function; // Optional. Used for call sites proven by the type pass.
+    BuiltInEffect effect = EFFECT_NONE;
 };
 
 struct FunctionDictionary {
@@ -97,6 +223,13 @@ struct FunctionTuple {
     Expression environment;
     Indices arguments;
     Expression body;
+    size_t environment_steps = 0; // Parents of the environment that the closure skips.
+};
+
+// A function or tuple function, whose results are cached.
+struct FunctionMemo {
+    Expression function;
+    size_t cache; // Index to the cache in the global storage.
 };
 
 struct LookupChild {
@@ -107,6 +240,8 @@ struct LookupChild {
 struct FunctionApplication {
     BoundGlobalName name;
     Expression child;
+    TypeProof proof; // Proof for calling proven_function with child.
+    FunctionPointer proven_function;
 };
 
 struct LookupSymbol {
@@ -116,6 +251,8 @@ struct LookupSymbol {
 struct String {
     Expression top;
     Expression rest;
+    size_t hash = 0; // Computed when first needed.
+    bool is_interned = false;
 };
 
 struct Tuple {
@@ -126,6 +263,8 @@ struct Tuple {
 // TODO: merge with Tuple for storage but keep type-code to know if it is evaluated.
 struct EvaluatedTuple {
     Indices indices;
+    size_t hash = 0; // Computed when first needed.
+    bool is_interned = false;
 };
 
 struct Stack {
@@ -137,6 +276,17 @@ struct Stack {
 struct EvaluatedStack {
     Expression top;
     Expression rest;
+    size_t hash = 0; // Computed when first needed.
+    bool is_interned = false;
+};
+
+// A stack of the numbers start, start + step, ... before stop,
+// that is computed when it is iterated instead of being stored.
+// It is never empty, since empty ranges are EMPTY_STACK.
+struct EvaluatedRange {
+    Number start;
+    Number stop;
+    Number step;
 };
 
 // STATEMENTS BEGIN
@@ -190,9 +340,41 @@ struct ForSimpleEndStatement {
 
 // STATEMENTS END
 
+// The statements of a dictionary are decoded to instructions when they are parsed.
+// The last instruction of a dictionary is OP_DICTIONARY_END,
+// or OP_DICTIONARY_END_PARALLEL when its lazy definitions are forced in parallel.
+enum InstructionType {
+    OP_DEFINITION, // index of Definition
+    OP_PUT, // index of PutAssignment
+    OP_PUT_EACH, // index of PutEachAssignment
+    OP_DROP, // index of DropAssignment
+    OP_WHILE, // index of WhileStatement, jump after end
+    OP_FOR, // index of ForStatement, jump after end
+    OP_FOR_SIMPLE, // index of ForSimpleStatement, jump after end
+    OP_WHILE_END, // jump to start
+    OP_FOR_END, // index of container in dictionary, jump to start
+    OP_RETURN,
+    OP_DICTIONARY_END,
+    // Superinstructions for common pairs of statements.
+    // They get the second statement from the next instruction:
+    OP_FOR_DEFINITION,
+    OP_DEFINITION_WHILE_END,
+    OP_DEFINITION_FOR_END,
+    OP_PUT_WHILE_END,
+    OP_PUT_FOR_END,
+    OP_DICTIONARY_END_PARALLEL,
+};
+
+struct Instruction {
+    InstructionType type;
+    size_t index;
+    size_t jump;
+};
+
 struct Dictionary {
     Indices statements;
     size_t definition_count;
+    Indices instructions;
 };
 
 struct EvaluatedDictionary {
@@ -218,6 +400,38 @@ struct EvaluatedTable {
     bool empty() const {return rows.empty();}
 };
 
+// The items first, first + 1, ... before last of a buffer.
+// Items are put at the back and taken from the front in O(1).
+// Putting at the back of the buffer reuses it, when no other deque has put there yet.
+// Otherwise the items are copied to a new buffer.
+struct EvaluatedDeque {
+    size_t buffer;
+    size_t first;
+    size_t last;
+};
+
+// The items first, first + 1, ... before last of a set buffer.
+// Like deques, sets share buffers when items are put at the end of them.
+struct EvaluatedSet {
+    size_t buffer;
+    size_t first;
+    size_t last;
+};
+
+// Items in the order they are put, and their positions by hash.
+struct SetBuffer {
+    std::vector<Expression> items;
+    std::unordered_multimap<size_t, size_t> positions;
+};
+
+// The cells of a grid row by row, so that the cell (x y) is at x + y * width.
+// Like tables, grids are mutated in place when putting cells.
+struct EvaluatedGrid {
+    size_t width;
+    size_t height;
+    std::vector<Expression> cells;
+};
+
 struct EvaluatedTableView {
     using Iterator = std::map<std::string, Row>::const_iterator;
     Iterator first;
@@ -226,3 +440,18 @@ struct EvaluatedTableView {
     Iterator end() const {return last;}
     bool empty() const {return first == last;}
 };
+
+struct MemoEntry {
+    size_t hash;
+    Expression input;
+    Expression output;
+};
+
+// Results of a memoized function, with the most recently used first.
+struct MemoCache {
+    using Iterator = std::list<MemoEntry>::iterator;
+    std::list<MemoEntry> entries;
+    std::unordered_multimap<size_t, Iterator> index;
+    size_t hits = 0;
+    size_t misses = 0;
+};
@@ -17,9 +17,14 @@ const char* getExpressionName(ExpressionType type) {
         case FUNCTION_BUILT_IN: return "FUNCTION_BUILT_IN";
         case FUNCTION_DICTIONARY: return "FUNCTION_DICTIONARY";
         case FUNCTION_TUPLE: return "FUNCTION_TUPLE";
+        case FUNCTION_MEMO: return "FUNCTION_MEMO";
         case STACK: return "STACK";
         case EVALUATED_STACK: return "EVALUATED_STACK";
         case EMPTY_STACK: return "EMPTY_STACK";
+        case EVALUATED_RANGE: return "EVALUATED_RANGE";
+        case EVALUATED_DEQUE: return "EVALUATED_DEQUE";
+        case EVALUATED_SET: return "EVALUATED_SET";
+        case EVALUATED_GRID: return "EVALUATED_GRID";
         case LOOKUP_CHILD: return "LOOKUP_CHILD";
         case FUNCTION_APPLICATION: return "FUNCTION_APPLICATION";
         case LOOKUP_SYMBOL: return "LOOKUP_SYMBOL";
@@ -37,14 +42,33 @@ const char* getExpressionName(ExpressionType type) {
         case FOR_SIMPLE_END_STATEMENT: return "FOR_SIMPLE_END_STATEMENT";
         case RETURN_STATEMENT: return "RETURN_STATEMENT";
         case NUMBER: return "NUMBER";
+        // Integers are numbers to the user, and only differ in how they are stored.
+        case INTEGER: return "NUMBER";
         case STRING: return "STRING";
         case EMPTY_STRING: return "EMPTY_STRING";
         case YES: return "YES";
         case NO: return "NO";
         case DYNAMIC_EXPRESSION: return "DYNAMIC_EXPRESSION";
         case TYPED_EXPRESSION: return "TYPED_EXPRESSION";
+        case FOLDED_EXPRESSION: return "FOLDED_EXPRESSION";
+        case STREAM: return "STREAM";
+        case IS_TABLE: return "IS_TABLE";
+        case NUMERIC: return "NUMERIC";
+        case LAZY_EXPRESSION: return "LAZY_EXPRESSION";
+        case THUNK: return "THUNK";
         case ERROR_EXPRESSION: return "ERROR_EXPRESSION";
         case ANY: return "ANY";
     }
     return "UNKNOWN_EXPRESSION"; // Should not happen
 }
+
+const char* getExpressionArticle(ExpressionType type) {
+    switch (getExpressionName(type)[0]) {
+        case 'A': return "an";
+        case 'E': return "an";
+        case 'I': return "an";
+        case 'O': return "an";
+        case 'U': return "an";
+        default: return "a";
+    }
+}
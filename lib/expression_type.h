@@ -16,9 +16,14 @@ enum ExpressionType {
     FUNCTION_BUILT_IN,
     FUNCTION_DICTIONARY,
     FUNCTION_TUPLE,
+    FUNCTION_MEMO,
     STACK,
     EVALUATED_STACK,
     EMPTY_STACK,
+    EVALUATED_RANGE,
+    EVALUATED_DEQUE,
+    EVALUATED_SET,
+    EVALUATED_GRID,
     LOOKUP_CHILD,
     FUNCTION_APPLICATION,
     LOOKUP_SYMBOL,
@@ -36,14 +41,23 @@ enum ExpressionType {
     FOR_SIMPLE_END_STATEMENT,
     RETURN_STATEMENT,
     NUMBER,
+    INTEGER,
     STRING,
     EMPTY_STRING,
     YES,
     NO,
     DYNAMIC_EXPRESSION,
     TYPED_EXPRESSION,
+    FOLDED_EXPRESSION,
+    STREAM,
+    IS_TABLE,
+    NUMERIC,
+    LAZY_EXPRESSION,
+    THUNK,
     ERROR_EXPRESSION,
     ANY,
 };
 
 const char* getExpressionName(ExpressionType type);
+// Returns "a" or "an", whichever goes before the name of the type.
+const char* getExpressionArticle(ExpressionType type);
@@ -1,5 +1,6 @@
 #include "factory.h"
 
+#include <cmath>
 #include <cstring>
 
 #include <carma/carma.h>
@@ -24,6 +25,59 @@ Expression makeExpression(
     return Expression{array.count - 1, code, type};
 }
 
+bool is_interning = false;
+
+bool isContainer(Expression expression) {
+    return expression.type == STRING ||
+        expression.type == EVALUATED_STACK ||
+        expression.type == EVALUATED_TUPLE;
+}
+
+size_t combineInternHash(size_t seed, Expression item) {
+    const auto value =
+        item.type == NUMBER || item.type == INTEGER || item.type == CHARACTER || isContainer(item) ?
+        item.index : 0;
+    seed ^= item.type + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2);
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+// Interned items are the same exactly when they are equal.
+bool isSameInterned(Expression left, Expression right) {
+    if (left.type != right.type) {
+        return false;
+    }
+    if (left.type == NUMBER || left.type == INTEGER || left.type == CHARACTER || isContainer(left)) {
+        return left.index == right.index;
+    }
+    return true;
+}
+
+// Strings and stacks are interned by their top and rest.
+template<typename ElementType, typename ArrayType>
+Expression makeInternedNode(
+    CodeRange code,
+    ElementType expression,
+    ExpressionType type,
+    ArrayType& array,
+    std::unordered_multimap<size_t, size_t>& interned
+) {
+    if (!is_interning || !isInterned(expression.top) || !isInterned(expression.rest)) {
+        return makeExpression(code, expression, type, array);
+    }
+    const auto hash = combineInternHash(combineInternHash(type, expression.top), expression.rest);
+    const auto range = interned.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto& node = array.data[it->second];
+        if (isSameInterned(node.top, expression.top) && isSameInterned(node.rest, expression.rest)) {
+            return Expression{it->second, code, type};
+        }
+    }
+    expression.is_interned = true;
+    const auto result = makeExpression(code, expression, type, array);
+    interned.emplace(hash, result.index);
+    return result;
+}
+
 } // namespace
 
 void clearMemory() {
@@ -33,19 +87,31 @@ void clearMemory() {
     
     FREE_DARRAY(storage.dynamic_expressions);
     FREE_DARRAY(storage.typed_expressions);
+    FREE_DARRAY(storage.folded_expressions);
+    FREE_DARRAY(storage.streams);
+    FREE_DARRAY(storage.stream_stages);
+    FREE_DARRAY(storage.numeric_operations);
+    FREE_DARRAY(storage.lazy_expressions);
+    FREE_DARRAY(storage.thunks);
     FREE_DARRAY(storage.dictionaries);
     FREE_DARRAY(storage.evaluated_dictionaries);
     FREE_DARRAY(storage.conditionals);
     FREE_DARRAY(storage.is_expressions);
     FREE_DARRAY(storage.alternatives);
+    FREE_DARRAY(storage.is_tables);
+    FREE_DARRAY(storage.numerics);
     FREE_DARRAY(storage.functions);
     FREE_DARRAY(storage.built_in_functions);
     FREE_DARRAY(storage.dictionary_functions);
     FREE_DARRAY(storage.tuple_functions);
+    FREE_DARRAY(storage.memo_functions);
     FREE_DARRAY(storage.tuples);
     FREE_DARRAY(storage.evaluated_tuples);
     FREE_DARRAY(storage.stacks);
     FREE_DARRAY(storage.evaluated_stacks);
+    FREE_DARRAY(storage.evaluated_ranges);
+    FREE_DARRAY(storage.evaluated_deques);
+    FREE_DARRAY(storage.evaluated_sets);
     FREE_DARRAY(storage.evaluated_table_views);
     FREE_DARRAY(storage.child_lookups);
     FREE_DARRAY(storage.function_applications);
@@ -62,6 +128,7 @@ void clearMemory() {
     FREE_DARRAY(storage.put_each_assignments);
     FREE_DARRAY(storage.drop_assignments);
     FREE_DARRAY(storage.statements);
+    FREE_DARRAY(storage.instructions);
     FREE_DARRAY(storage.expressions);
     FREE_DARRAY(storage.strings);
     FREE_DARRAY(storage.rows);
@@ -69,8 +136,41 @@ void clearMemory() {
     FREE_DARRAY(storage.names);
     
     FREE_TABLE(storage.name_index_table);
+    storage.name_keys.clear();
     
     storage.evaluated_tables.clear();
+    storage.deque_buffers.clear();
+    storage.set_buffers.clear();
+    storage.evaluated_grids.clear();
+    storage.is_table_entries.clear();
+    storage.interned_strings.clear();
+    storage.interned_stacks.clear();
+    storage.interned_tuples.clear();
+    storage.memo_caches.clear();
+}
+
+void setInterning(bool is_enabled) {
+    is_interning = is_enabled;
+}
+
+bool isInterned(Expression expression) {
+    switch (expression.type) {
+        case CHARACTER: return true;
+        case YES: return true;
+        case NO: return true;
+        case EMPTY_STACK: return true;
+        case EMPTY_STRING: return true;
+        case INTEGER: return true;
+        case NUMBER: {
+            // nan is not equal to itself, and negative zero is equal to zero.
+            const auto number = getNumber(expression);
+            return number == number && !(number == 0 && std::signbit(number));
+        }
+        case STRING: return storage.strings.data[expression.index].is_interned;
+        case EVALUATED_STACK: return storage.evaluated_stacks.data[expression.index].is_interned;
+        case EVALUATED_TUPLE: return storage.evaluated_tuples.data[expression.index].is_interned;
+        default: return false;
+    }
 }
 
 // MAKERS:
@@ -81,6 +181,14 @@ void clearMemory() {
 } while (0)
 
 Expression makeNumber(CodeRange code, Number expression) {
+    // Numbers without fractions are stored as integers, so that they stay exact
+    // beyond 2^53. Negative zero is kept as a double, to keep its sign.
+    const auto is_integral = expression >= -0x1p63 && expression < 0x1p63 &&
+        expression == static_cast<Number>(static_cast<Integer>(expression)) &&
+        !(expression == 0 && std::signbit(expression));
+    if (is_integral) {
+        return makeInteger(code, static_cast<Integer>(expression));
+    }
     auto result = Expression{};
     result.type = NUMBER;
     result.range = code;
@@ -88,6 +196,14 @@ Expression makeNumber(CodeRange code, Number expression) {
     return result;
 }
 
+Expression makeInteger(CodeRange code, Integer expression) {
+    auto result = Expression{};
+    result.type = INTEGER;
+    result.range = code;
+    BIT_CAST(expression, result.index);
+    return result;
+}
+
 Expression makeErrorExpression(CodeRange code, const char* format, ...) {
     va_list args;
     va_start(args, format);
@@ -112,6 +228,22 @@ Expression makeTypedExpression(CodeRange code, TypedExpression expression) {
     return makeExpression(code, expression, TYPED_EXPRESSION, storage.typed_expressions);
 }
 
+Expression makeFoldedExpression(CodeRange code, FoldedExpression expression) {
+    return makeExpression(code, expression, FOLDED_EXPRESSION, storage.folded_expressions);
+}
+
+Expression makeStream(CodeRange code, Stream expression) {
+    return makeExpression(code, expression, STREAM, storage.streams);
+}
+
+Expression makeLazyExpression(CodeRange code, LazyExpression expression) {
+    return makeExpression(code, expression, LAZY_EXPRESSION, storage.lazy_expressions);
+}
+
+Expression makeThunk(CodeRange code, Thunk expression) {
+    return makeExpression(code, expression, THUNK, storage.thunks);
+}
+
 Expression makeConditional(CodeRange code, Conditional expression) {
     return makeExpression(code, expression, CONDITIONAL, storage.conditionals);
 }
@@ -124,6 +256,14 @@ Expression makeAlternative(CodeRange code, Alternative expression) {
     return makeExpression(code, expression, ALTERNATIVE, storage.alternatives);
 }
 
+Expression makeIsTable(CodeRange code, IsTable expression) {
+    return makeExpression(code, expression, IS_TABLE, storage.is_tables);
+}
+
+Expression makeNumeric(CodeRange code, Numeric expression) {
+    return makeExpression(code, expression, NUMERIC, storage.numerics);
+}
+
 Expression makeDictionary(CodeRange code, Dictionary expression) {
     return makeExpression(code, expression, DICTIONARY, storage.dictionaries);
 }
@@ -148,12 +288,48 @@ Expression makeFunctionTuple(CodeRange code, FunctionTuple expression) {
     return makeExpression(code, expression, FUNCTION_TUPLE, storage.tuple_functions);
 }
 
+Expression makeFunctionMemo(CodeRange code, FunctionMemo expression) {
+    return makeExpression(code, expression, FUNCTION_MEMO, storage.memo_functions);
+}
+
 Expression makeTuple(CodeRange code, Tuple expression) {
     return makeExpression(code, expression, TUPLE, storage.tuples);
 }
 
 Expression makeEvaluatedTuple(CodeRange code, EvaluatedTuple expression) {
-    return makeExpression(code, expression, EVALUATED_TUPLE, storage.evaluated_tuples);
+    if (!is_interning) {
+        return makeExpression(code, expression, EVALUATED_TUPLE, storage.evaluated_tuples);
+    }
+    auto hash = size_t{EVALUATED_TUPLE};
+    FOR_EACH(i, expression.indices) {
+        const auto item = storage.expressions.data[i];
+        if (!isInterned(item)) {
+            return makeExpression(code, expression, EVALUATED_TUPLE, storage.evaluated_tuples);
+        }
+        hash = combineInternHash(hash, item);
+    }
+    const auto range = storage.interned_tuples.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it) {
+        const auto indices = storage.evaluated_tuples.data[it->second].indices;
+        if (indices.count != expression.indices.count) {
+            continue;
+        }
+        auto is_same = true;
+        FOR_EACH2(left, right, indices, expression.indices) {
+            is_same = is_same && isSameInterned(storage.expressions.data[left], storage.expressions.data[right]);
+        }
+        if (is_same) {
+            // Reuse the items of the new tuple, if nothing is stored after them.
+            if (expression.indices.data + expression.indices.count == storage.expressions.count) {
+                storage.expressions.count = expression.indices.data;
+            }
+            return Expression{it->second, code, EVALUATED_TUPLE};
+        }
+    }
+    expression.is_interned = true;
+    const auto result = makeExpression(code, expression, EVALUATED_TUPLE, storage.evaluated_tuples);
+    storage.interned_tuples.emplace(hash, result.index);
+    return result;
 }
 
 Expression makeEvaluatedTuple2(Expression a, Expression b) {
@@ -169,7 +345,19 @@ Expression makeStack(CodeRange code, Stack expression) {
 }
 
 Expression makeEvaluatedStack(CodeRange code, EvaluatedStack expression) {
-    return makeExpression(code, expression, EVALUATED_STACK, storage.evaluated_stacks);
+    return makeInternedNode(code, expression, EVALUATED_STACK, storage.evaluated_stacks, storage.interned_stacks);
+}
+
+Expression makeEvaluatedRange(CodeRange code, EvaluatedRange expression) {
+    return makeExpression(code, expression, EVALUATED_RANGE, storage.evaluated_ranges);
+}
+
+Expression makeEvaluatedDeque(CodeRange code, EvaluatedDeque expression) {
+    return makeExpression(code, expression, EVALUATED_DEQUE, storage.evaluated_deques);
+}
+
+Expression makeEvaluatedSet(CodeRange code, EvaluatedSet expression) {
+    return makeExpression(code, expression, EVALUATED_SET, storage.evaluated_sets);
 }
 
 Expression makeTable(CodeRange code, Table expression) {
@@ -181,6 +369,11 @@ Expression makeEvaluatedTable(CodeRange code, EvaluatedTable expression) {
     return Expression{storage.evaluated_tables.size() - 1, code, EVALUATED_TABLE};
 }
 
+Expression makeEvaluatedGrid(CodeRange code, EvaluatedGrid expression) {
+    storage.evaluated_grids.emplace_back(std::move(expression));
+    return Expression{storage.evaluated_grids.size() - 1, code, EVALUATED_GRID};
+}
+
 Expression makeEvaluatedTableView(CodeRange code, EvaluatedTableView expression) {
     return makeExpression(code, expression, EVALUATED_TABLE_VIEW, storage.evaluated_table_views);
 }
@@ -203,7 +396,9 @@ Expression makeName(CodeRange code, const char* data, size_t count) {
     GET_RANGE_KEY_VALUE(string, index, storage.name_index_table);
     if (index == SIZE_MAX) {
         index = storage.names.count;
-        SET_RANGE_KEY_VALUE(string, index, storage.name_index_table);
+        // The code characters can move when more code is added, so the key is copied.
+        const auto& key = storage.name_keys.emplace_back(data, count);
+        SET_RANGE_KEY_VALUE((StringView{key.data(), key.size()}), index, storage.name_index_table);
         CONCAT(storage.names, string);
         APPEND(storage.names, '\0');
         return Expression{index, code, NAME};
@@ -256,7 +451,7 @@ Expression makeForSimpleEndStatement(CodeRange code, ForSimpleEndStatement expre
 }
 
 Expression makeString(CodeRange code, String expression) {
-    return makeExpression(code, expression, STRING, storage.strings);
+    return makeInternedNode(code, expression, STRING, storage.strings, storage.interned_strings);
 }
 
 // GETTERS
@@ -272,11 +467,24 @@ Character getCharacter(Expression expression) {
 }
 
 Number getNumber(Expression expression) {
+    if (expression.type == INTEGER) {
+        return static_cast<Number>(getInteger(expression));
+    }
     Number result;
     BIT_CAST(expression.index, result);
     return result;
 }
 
+Integer getInteger(Expression expression) {
+    Integer result;
+    BIT_CAST(expression.index, result);
+    return result;
+}
+
+bool isNumber(Expression expression) {
+    return expression.type == NUMBER || expression.type == INTEGER;
+}
+
 ErrorExpression getErrorExpression(Expression expression) {
     ErrorExpression result;
     BIT_CAST(expression.index, result);
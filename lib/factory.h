@@ -1,6 +1,8 @@
 #pragma once
 
 #include <stdarg.h>
+#include <deque>
+#include <string>
 #include <vector>
 
 #include <carma/carma_string.h>
@@ -36,19 +38,31 @@ struct Storage {
 
     DARRAY(DynamicExpression) dynamic_expressions;
     DARRAY(TypedExpression) typed_expressions;
+    DARRAY(FoldedExpression) folded_expressions;
+    DARRAY(Stream) streams;
+    DARRAY(StreamStage) stream_stages;
+    DARRAY(NumericOperation) numeric_operations;
+    DARRAY(LazyExpression) lazy_expressions;
+    DARRAY(Thunk) thunks;
     DARRAY(Dictionary) dictionaries;
     DARRAY(EvaluatedDictionary) evaluated_dictionaries;
     DARRAY(Conditional) conditionals;
     DARRAY(IsExpression) is_expressions;
     DARRAY(Alternative) alternatives;
+    DARRAY(IsTable) is_tables;
+    DARRAY(Numeric) numerics;
     DARRAY(Function) functions;
     DARRAY(FunctionBuiltIn) built_in_functions;
     DARRAY(FunctionDictionary) dictionary_functions;
     DARRAY(FunctionTuple) tuple_functions;
+    DARRAY(FunctionMemo) memo_functions;
     DARRAY(Tuple) tuples;
     DARRAY(EvaluatedTuple) evaluated_tuples;
     DARRAY(Stack) stacks;
     DARRAY(EvaluatedStack) evaluated_stacks;
+    DARRAY(EvaluatedRange) evaluated_ranges;
+    DARRAY(EvaluatedDeque) evaluated_deques;
+    DARRAY(EvaluatedSet) evaluated_sets;
     DARRAY(EvaluatedTableView) evaluated_table_views;
     DARRAY(LookupChild) child_lookups;
     DARRAY(FunctionApplication) function_applications;
@@ -65,6 +79,7 @@ struct Storage {
     DARRAY(PutEachAssignment) put_each_assignments;
     DARRAY(DropAssignment) drop_assignments;
     DARRAY(Expression) statements;
+    DARRAY(Instruction) instructions;
     DARRAY(Expression) expressions;
     DARRAY(String) strings;
     DARRAY(Row) rows;
@@ -74,39 +89,76 @@ struct Storage {
     StringBuilder names;
     
     NameIndexTable name_index_table;
+    // The keys of name_index_table, which do not move when more are added:
+    std::deque<std::string> name_keys;
     
     std::vector<EvaluatedTable> evaluated_tables;
+    std::vector<std::vector<Expression>> deque_buffers;
+    std::vector<SetBuffer> set_buffers;
+    std::vector<EvaluatedGrid> evaluated_grids;
+    // The entries of each is table by the hash of their keys:
+    std::vector<std::unordered_multimap<size_t, IsTableEntry>> is_table_entries;
+    std::vector<MemoCache> memo_caches;
+    // Interned strings, stacks and tuples by the hash of their items:
+    std::unordered_multimap<size_t, size_t> interned_strings;
+    std::unordered_multimap<size_t, size_t> interned_stacks;
+    std::unordered_multimap<size_t, size_t> interned_tuples;
 };
 
 extern Storage storage;
 
 void clearMemory();
 
+// When interning is enabled, strings, stacks and tuples that are made
+// from the same items share the same index, so they are equal exactly
+// when their indices are equal. Items that are not plain values,
+// like dictionaries, tables, nan and negative zero, are not interned.
+void setInterning(bool is_enabled);
+// Returns true if the expression is a plain value or an interned container.
+bool isInterned(Expression expression);
+
 Character getCharacter(Expression expression);
+// Integers are promoted to doubles.
 Number getNumber(Expression expression);
+Integer getInteger(Expression expression);
+// Returns true for both numbers that are stored as doubles and as integers.
+bool isNumber(Expression expression);
 ErrorExpression getErrorExpression(Expression expression);
 
+// Stores the number as an integer when it has no fraction.
 Expression makeNumber(CodeRange code, Number expression);
+Expression makeInteger(CodeRange code, Integer expression);
 Expression makeErrorExpression(CodeRange code, const char* format, ...);
 Expression makeCharacter(CodeRange code, Character expression);
 Expression makeDynamicExpression(CodeRange code, DynamicExpression expression);
 Expression makeTypedExpression(CodeRange code, TypedExpression expression);
+Expression makeFoldedExpression(CodeRange code, FoldedExpression expression);
+Expression makeStream(CodeRange code, Stream expression);
+Expression makeLazyExpression(CodeRange code, LazyExpression expression);
+Expression makeThunk(CodeRange code, Thunk expression);
 Expression makeConditional(CodeRange code, Conditional expression);
 Expression makeIs(CodeRange code, IsExpression expression);
 Expression makeAlternative(CodeRange code, Alternative expression);
+Expression makeIsTable(CodeRange code, IsTable expression);
+Expression makeNumeric(CodeRange code, Numeric expression);
 Expression makeDictionary(CodeRange code, Dictionary expression);
 Expression makeEvaluatedDictionary(CodeRange code, EvaluatedDictionary expression);
 Expression makeFunction(CodeRange code, Function expression);
 Expression makeFunctionBuiltIn(CodeRange code, FunctionBuiltIn expression);
 Expression makeFunctionDictionary(CodeRange code, FunctionDictionary expression);
 Expression makeFunctionTuple(CodeRange code, FunctionTuple expression);
+Expression makeFunctionMemo(CodeRange code, FunctionMemo expression);
 Expression makeTuple(CodeRange code, Tuple expression);
 Expression makeEvaluatedTuple(CodeRange code, EvaluatedTuple expression);
 Expression makeEvaluatedTuple2(Expression a, Expression b);
 Expression makeStack(CodeRange code, Stack expression);
 Expression makeEvaluatedStack(CodeRange code, EvaluatedStack expression);
+Expression makeEvaluatedRange(CodeRange code, EvaluatedRange expression);
+Expression makeEvaluatedDeque(CodeRange code, EvaluatedDeque expression);
+Expression makeEvaluatedSet(CodeRange code, EvaluatedSet expression);
 Expression makeTable(CodeRange code, Table expression);
 Expression makeEvaluatedTable(CodeRange code, EvaluatedTable expression);
+Expression makeEvaluatedGrid(CodeRange code, EvaluatedGrid expression);
 Expression makeEvaluatedTableView(CodeRange code, EvaluatedTableView expression);
 Expression makeLookupChild(CodeRange code, LookupChild expression);
 Expression makeFunctionApplication(CodeRange code, FunctionApplication expression);
@@ -0,0 +1,337 @@
+#include "jit.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <unordered_map>
+
+#if !defined(_WIN32) && defined(MANGLANG_JIT)
+#include <dlfcn.h>
+#include <errno.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include <carma/carma.h>
+
+#include "built_in_functions/container.h"
+#include "factory.h"
+#include "mang_lang_string.h"
+#include "passes/transpile.h"
+#include "transpiled_program.h"
+
+namespace {
+
+// The number of calls before a function is compiled.
+const size_t JIT_THRESHOLD = 1000;
+// The number of calls of hot functions between checks if the compiler is done.
+const size_t JIT_POLL_INTERVAL = 1024;
+
+struct JitEntry {
+    size_t calls;
+    JitFunction function;
+    bool is_compiling;
+    bool is_failed;
+};
+
+struct Jit {
+    bool is_enabled;
+    bool is_unavailable;
+    bool is_compiler_checked;
+    bool is_stopped;
+    bool is_waiting;
+    size_t calls_since_poll;
+    JitStatistics statistics;
+    std::unordered_map<size_t, JitEntry> entries;
+    DARRAY(void*) libraries;
+    size_t library_count;
+    char directory[64];
+};
+
+Jit jit;
+
+size_t jitKey(Expression body) {
+    return body.index * 256 + body.type;
+}
+
+#if defined(_WIN32) || !defined(MANGLANG_JIT)
+
+bool startCompilation(size_t, Expression) {
+    jit.is_unavailable = true;
+    return false;
+}
+
+bool isCompiling() {
+    return false;
+}
+
+void pollCompilation(bool) {}
+
+void cancelCompilation() {}
+
+void leaveCompilation() {}
+
+void unloadLibraries() {}
+
+#else
+
+const JitApi JIT_API = {
+    beginDictionary,
+    applyFunctionBinary,
+    applyFunctionValue,
+    makeTupleOf,
+    lookupDictionary,
+    lookupChild,
+    boolean,
+    setDictionaryDefinition,
+    getDictionaryDefinition,
+    evaluate,
+    isEqual,
+    container_functions::take,
+    container_functions::drop,
+    container_functions::putBinary,
+};
+
+const char* jitCompiler() {
+    const auto compiler = getenv("MANGLANG_JIT_COMPILER");
+    return compiler ? compiler : MANGLANG_JIT_COMPILER;
+}
+
+// The compiler parses the headers itself when the precompiled header does not fit it.
+#ifdef MANGLANG_JIT_HEADER
+const char* const JIT_HEADER_OPTION = "-include " MANGLANG_JIT_HEADER;
+#else
+const char* const JIT_HEADER_OPTION = "";
+#endif
+
+bool writeTextFile(const char* path, StringBuilder text) {
+    FILE* file = fopen(path, "w");
+    if (file == NULL) {
+        return false;
+    }
+    fwrite(text.data, 1, text.count, file);
+    return fclose(file) == 0;
+}
+
+// The compiler is checked once, so that a function that does not compile
+// does not stop other functions from being compiled.
+bool hasCompiler() {
+    if (!jit.is_compiler_checked) {
+        jit.is_compiler_checked = true;
+        const auto command = format_cstring("%s --version >/dev/null 2>&1", jitCompiler());
+        jit.is_unavailable = system(command) != 0;
+        free((void*)command);
+    }
+    return !jit.is_unavailable;
+}
+
+JitFunction loadFunction(const char* library_path) {
+    const auto library = dlopen(library_path, RTLD_NOW | RTLD_LOCAL);
+    if (!library) {
+        return nullptr;
+    }
+    APPEND(jit.libraries, library);
+    const auto load = (void (*)(const JitApi*))dlsym(library, "manglang_jit_load");
+    const auto function = (JitFunction)dlsym(library, "manglang_jit_function");
+    if (!load || !function) {
+        return nullptr;
+    }
+    load(&JIT_API);
+    return function;
+}
+
+extern "C" char** environ;
+
+// The compiler runs in the background, one function at a time,
+// while the function is interpreted.
+struct Compilation {
+    pid_t pid;
+    size_t key;
+    const char* source_path;
+    const char* library_path;
+};
+
+Compilation compilation;
+
+void freeCompilation() {
+    remove(compilation.source_path);
+    remove(compilation.library_path);
+    free((void*)compilation.source_path);
+    free((void*)compilation.library_path);
+    compilation = Compilation{};
+}
+
+bool runInBackground(const char* command, pid_t& pid) {
+    char shell[] = "/bin/sh";
+    char option[] = "-c";
+    char* arguments[] = {shell, option, const_cast<char*>(command), nullptr};
+    return posix_spawn(&pid, shell, nullptr, nullptr, arguments, environ) == 0;
+}
+
+// Functions that would only call the interpreter are not compiled.
+bool startCompilation(size_t key, Expression body) {
+    if (!hasCompiler()) {
+        return false;
+    }
+    auto is_transpiled = false;
+    auto source = transpileFunction(StringBuilder{}, body, is_transpiled);
+    if (!is_transpiled) {
+        FREE_DARRAY(source);
+        return false;
+    }
+    if (jit.directory[0] == '\0') {
+        snprintf(jit.directory, sizeof(jit.directory), "/tmp/manglang_jit_XXXXXX");
+        if (!mkdtemp(jit.directory)) {
+            jit.directory[0] = '\0';
+            FREE_DARRAY(source);
+            return false;
+        }
+    }
+    const auto count = jit.library_count++;
+    compilation.key = key;
+    compilation.source_path = format_cstring("%s/function_%zu.cpp", jit.directory, count);
+    compilation.library_path = format_cstring("%s/function_%zu.so", jit.directory, count);
+    auto is_started = false;
+    if (writeTextFile(compilation.source_path, source)) {
+        const auto command = format_cstring(
+            "%s -std=c++20 -O2 -shared -fPIC -I %s -I %s %s %s -o %s 2>/dev/null",
+            jitCompiler(),
+            MANGLANG_JIT_INCLUDE_LIB,
+            MANGLANG_JIT_INCLUDE_CARMA,
+            JIT_HEADER_OPTION,
+            compilation.source_path,
+            compilation.library_path
+        );
+        is_started = runInBackground(command, compilation.pid);
+        free((void*)command);
+    }
+    FREE_DARRAY(source);
+    if (!is_started) {
+        freeCompilation();
+    }
+    return is_started;
+}
+
+bool isCompiling() {
+    return compilation.pid != 0;
+}
+
+// Loads the function when the compiler is done. Waits for the compiler if is_blocking.
+void pollCompilation(bool is_blocking) {
+    auto status = 0;
+    auto result = pid_t{};
+    do {
+        result = waitpid(compilation.pid, &status, is_blocking ? 0 : WNOHANG);
+    } while (result < 0 && errno == EINTR);
+    if (result == 0) {
+        return;
+    }
+    const auto is_compiled = result == compilation.pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    auto& entry = jit.entries[compilation.key];
+    entry.is_compiling = false;
+    entry.function = is_compiled ? loadFunction(compilation.library_path) : nullptr;
+    entry.is_failed = !entry.function;
+    if (entry.function) {
+        ++jit.statistics.compiled_functions;
+    } else {
+        ++jit.statistics.interpreted_functions;
+    }
+    freeCompilation();
+}
+
+// For worker processes, whose parent waits for the compiler and owns its files.
+void leaveCompilation() {
+    free((void*)compilation.source_path);
+    free((void*)compilation.library_path);
+    compilation = Compilation{};
+}
+
+void cancelCompilation() {
+    if (!isCompiling()) {
+        return;
+    }
+    kill(compilation.pid, SIGKILL);
+    while (waitpid(compilation.pid, nullptr, 0) < 0 && errno == EINTR) {}
+    freeCompilation();
+}
+
+void unloadLibraries() {
+    FOR_EACH(library, jit.libraries) {
+        dlclose(*library);
+    }
+    FREE_DARRAY(jit.libraries);
+    if (jit.directory[0] != '\0') {
+        rmdir(jit.directory);
+        jit.directory[0] = '\0';
+    }
+}
+
+#endif
+
+} // namespace
+
+void setJit(bool is_enabled) {
+    if (is_enabled && !jit.is_enabled) {
+        jit.statistics = JitStatistics{};
+    }
+    jit.is_enabled = is_enabled;
+}
+
+void stopJitCompilation() {
+    jit.is_stopped = true;
+    leaveCompilation();
+}
+
+void setJitWaiting(bool is_waiting) {
+    jit.is_waiting = is_waiting;
+}
+
+void addCompiledFunction(Expression body, JitFunction function) {
+    jit.entries[jitKey(body)] = JitEntry{0, function, false};
+}
+
+JitFunction hotFunction(Expression body) {
+    if (!jit.is_enabled || jit.is_unavailable) {
+        return nullptr;
+    }
+    if (isCompiling() && ++jit.calls_since_poll >= JIT_POLL_INTERVAL) {
+        jit.calls_since_poll = 0;
+        pollCompilation(false);
+    }
+    const auto key = jitKey(body);
+    auto& entry = jit.entries[key];
+    if (entry.function || entry.is_failed || entry.is_compiling) {
+        return entry.function;
+    }
+    // A hot function waits for the compiler to be done with the previous one.
+    if (++entry.calls < JIT_THRESHOLD || jit.is_stopped || isCompiling()) {
+        return nullptr;
+    }
+    entry.is_compiling = startCompilation(key, body);
+    if (!entry.is_compiling) {
+        entry.is_failed = true;
+        ++jit.statistics.interpreted_functions;
+        return nullptr;
+    }
+    if (jit.is_waiting) {
+        pollCompilation(true);
+    }
+    return jit.entries[key].function;
+}
+
+JitStatistics getJitStatistics() {
+    return jit.statistics;
+}
+
+void clearJit() {
+    cancelCompilation();
+    unloadLibraries();
+    jit.entries.clear();
+    jit.is_unavailable = false;
+    jit.is_compiler_checked = false;
+    jit.is_stopped = false;
+    jit.calls_since_poll = 0;
+    jit.library_count = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+// Functions that are called many times are transpiled to C++, compiled with
+// the system compiler to a shared library and loaded with dlopen.
+// The compiler runs in the background, and the function is interpreted until it is done.
+// The compiled functions call back into the interpreter via JitApi,
+// so that they do not depend on which symbols the interpreter exports.
+// When there is no compiler, or the JIT is not built, the functions are interpreted as usual.
+
+#include <initializer_list>
+
+#include "expression.h"
+#include "passes/evaluate.h"
+
+struct Operands;
+
+struct JitApi {
+    Expression (*beginDictionary)(Expression dictionary, Expression environment);
+    Expression (*applyFunctionBinary)(CodeRange range, Expression function, Operands operands, bool is_proven);
+    Expression (*applyFunctionValue)(CodeRange range, Expression function, Expression input);
+    Expression (*makeTupleOf)(CodeRange range, std::initializer_list<Expression> items);
+    Expression (*lookupDictionary)(CodeRange range, BoundGlobalName name, Expression expression);
+    Expression (*lookupChild)(CodeRange range, size_t name, Expression child);
+    BooleanResult (*boolean)(Expression expression);
+    void (*setDictionaryDefinition)(Expression evaluated_dictionary, BoundLocalName name, Expression value);
+    Expression (*getDictionaryDefinition)(Expression evaluated_dictionary, BoundLocalName name);
+    Expression (*evaluate)(Expression expression, Expression environment);
+    bool (*isEqual)(Expression left, Expression right);
+    Expression (*take)(Expression in);
+    Expression (*drop)(Expression in);
+    Expression (*putBinary)(Expression item, Expression collection);
+};
+
+typedef Expression (*JitFunction)(Expression environment);
+
+struct JitStatistics {
+    size_t compiled_functions;
+    // Hot functions that are interpreted, since they could not be compiled,
+    // or since they would only call the interpreter.
+    size_t interpreted_functions;
+};
+
+void setJit(bool is_enabled);
+// Keeps the compiled functions but compiles no new ones,
+// for worker processes that share the directory of the compiled functions.
+void stopJitCompilation();
+// Waits for the compiler when a function gets hot, instead of interpreting it meanwhile,
+// so that the tests know which functions are compiled.
+void setJitWaiting(bool is_waiting);
+// Uses the function for the body from its first call, for functions that are compiled ahead of time.
+void addCompiledFunction(Expression body, JitFunction function);
+// Counts the calls of a function body,
+// and returns its compiled function when it is hot and could be compiled.
+JitFunction hotFunction(Expression body);
+// Counts the hot functions since the JIT was enabled.
+JitStatistics getJitStatistics();
+// Unloads the compiled functions, which refer to the syntax trees in storage.
+void clearJit();
@@ -0,0 +1,76 @@
+#pragma once
+
+// Included once by each function that is compiled by the JIT.
+// It defines the functions of transpiled_program.h and passes/evaluate.h
+// that transpiled code calls, so that they call the interpreter via JitApi.
+
+#include "jit.h"
+#include "transpiled_program.h"
+
+static const JitApi* jit_api;
+
+extern "C" void manglang_jit_load(const JitApi* api) {
+    jit_api = api;
+}
+
+Expression beginDictionary(Expression dictionary, Expression environment) {
+    return jit_api->beginDictionary(dictionary, environment);
+}
+
+Expression applyFunctionBinary(
+    CodeRange range, Expression function, Operands operands, bool is_proven
+) {
+    return jit_api->applyFunctionBinary(range, function, operands, is_proven);
+}
+
+Expression applyFunctionValue(CodeRange range, Expression function, Expression input) {
+    return jit_api->applyFunctionValue(range, function, input);
+}
+
+Expression makeTupleOf(CodeRange range, std::initializer_list<Expression> items) {
+    return jit_api->makeTupleOf(range, items);
+}
+
+Expression lookupDictionary(CodeRange range, BoundGlobalName name, Expression expression) {
+    return jit_api->lookupDictionary(range, name, expression);
+}
+
+Expression lookupChild(CodeRange range, size_t name, Expression child) {
+    return jit_api->lookupChild(range, name, child);
+}
+
+BooleanResult boolean(Expression expression) {
+    return jit_api->boolean(expression);
+}
+
+void setDictionaryDefinition(Expression evaluated_dictionary, BoundLocalName name, Expression value) {
+    jit_api->setDictionaryDefinition(evaluated_dictionary, name, value);
+}
+
+Expression getDictionaryDefinition(Expression evaluated_dictionary, BoundLocalName name) {
+    return jit_api->getDictionaryDefinition(evaluated_dictionary, name);
+}
+
+Expression evaluate(Expression expression, Expression environment) {
+    return jit_api->evaluate(expression, environment);
+}
+
+bool isEqual(Expression left, Expression right) {
+    return jit_api->isEqual(left, right);
+}
+
+namespace container_functions {
+
+Expression take(Expression in) {
+    return jit_api->take(in);
+}
+
+Expression drop(Expression in) {
+    return jit_api->drop(in);
+}
+
+Expression putBinary(Expression item, Expression collection) {
+    return jit_api->putBinary(item, collection);
+}
+
+}
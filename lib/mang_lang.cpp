@@ -1,10 +1,15 @@
 #include "mang_lang.h"
 #include "factory.h"
+#include "jit.h"
 #include "built_in_functions/built_in_functions.h"
 #include "built_in_functions/standard_library.h"
+#include "passes/defer.h"
 #include "passes/evaluate.h"
+#include "passes/fold.h"
 #include "passes/parse.h"
 #include "passes/serialize.h"
+#include "passes/transpile.h"
+#include "passes/trim.h"
 #include "mang_lang_string.h"
 
 #include <carma/carma.h>
@@ -42,7 +47,8 @@ StringBuilder evaluate_types(const char* code) {
     return buffer;
 }
 
-StringBuilder evaluate_all(const char* code) {
+static
+StringBuilder evaluateProgram(const char* code, bool is_lazy, bool is_parallel) {
     const auto built_ins = builtIns();
     const auto built_ins_types = builtInsTypes();
     const auto std_ast = parse(STANDARD_LIBRARY.c_str());
@@ -63,10 +69,101 @@ StringBuilder evaluate_all(const char* code) {
     if (code_checked.type == ERROR_EXPRESSION) {
         return serializeAndClearMemory(code_checked);
     }
-    const auto std_evaluated = evaluate(std_ast, built_ins);
+    auto std_folded = trim(fold(std_ast, built_ins));
+    if (is_lazy) {
+        std_folded = defer(std_folded, Expression{}, built_ins, false);
+    }
+    const auto std_evaluated = evaluate(std_folded, built_ins);
     if (std_evaluated.type == ERROR_EXPRESSION) {
         return serializeAndClearMemory(std_evaluated);
     }
-    const auto code_evaluated = evaluate(code_ast, std_evaluated);
+    auto code_folded = trim(fold(code_ast, std_evaluated));
+    if (is_lazy) {
+        code_folded = defer(code_folded, std_folded, built_ins, is_parallel);
+    }
+    const auto code_evaluated = evaluate(code_folded, std_evaluated);
     return serializeAndClearMemory(code_evaluated);
 }
+
+StringBuilder evaluate_all(const char* code) {
+    return evaluateProgram(code, false, false);
+}
+
+StringBuilder evaluate_lazy(const char* code) {
+    return evaluateProgram(code, true, false);
+}
+
+StringBuilder evaluate_parallel(const char* code) {
+    return evaluateProgram(code, true, true);
+}
+
+StringBuilder evaluate_interned(const char* code) {
+    setInterning(true);
+    const auto result = evaluateProgram(code, false, false);
+    setInterning(false);
+    return result;
+}
+
+StringBuilder evaluate_jit(const char* code) {
+    setJit(true);
+    const auto result = evaluateProgram(code, false, false);
+    setJit(false);
+    clearJit();
+    return result;
+}
+
+StringBuilder transpile(const char* code) {
+    // The code is parsed first, so that the transpiled program gets the same syntax tree.
+    const auto code_ast = parse(code);
+    const auto built_ins_types = builtInsTypes();
+    const auto std_ast = parse(STANDARD_LIBRARY.c_str());
+    auto error = code_ast;
+    if (error.type != ERROR_EXPRESSION) {
+        error = evaluate_types(std_ast, built_ins_types);
+    }
+    if (error.type != ERROR_EXPRESSION) {
+        error = evaluate_types(code_ast, error);
+    }
+    auto buffer = StringBuilder{};
+    if (error.type == ERROR_EXPRESSION) {
+        auto message = serialize(StringBuilder{}, error);
+        APPEND(message, '\0');
+        buffer = transpileError(buffer, message.data);
+        FREE_DARRAY(message);
+    } else {
+        buffer = transpile(buffer, code_ast, code);
+    }
+    clearMemory();
+    return buffer;
+}
+
+StringBuilder evaluate_transpiled(
+    const char* code,
+    Expression ast,
+    TranspiledProgram program,
+    const TranspiledFunction* functions,
+    size_t function_count
+) {
+    const auto code_ast = parse(code);
+    if (code_ast.index != ast.index || code_ast.type != ast.type) {
+        clearMemory();
+        auto buffer = StringBuilder{};
+        return concatenate(buffer, "The transpiled program does not match its code.");
+    }
+    // The transpiled functions are called like compiled functions of the JIT,
+    // which compiles no other functions.
+    setJit(true);
+    stopJitCompilation();
+    for (size_t i = 0; i < function_count; ++i) {
+        addCompiledFunction(functions[i].body, functions[i].function);
+    }
+    const auto built_ins = builtIns();
+    const auto std_ast = parse(STANDARD_LIBRARY.c_str());
+    const auto std_folded = trim(fold(std_ast, built_ins));
+    const auto std_evaluated = evaluate(std_folded, built_ins);
+    const auto result = std_evaluated.type == ERROR_EXPRESSION ?
+        serializeAndClearMemory(std_evaluated) : serializeAndClearMemory(program(std_evaluated));
+    setJit(false);
+    clearJit();
+    return result;
+}
@@ -1,6 +1,33 @@
 #pragma once
+#include "expression.h"
 #include "mang_lang_string.h"
 
 StringBuilder reformat(const char* code);
 StringBuilder evaluate_types(const char* code);
 StringBuilder evaluate_all(const char* code);
+// Evaluates definitions the first time they are used, when it does not change the result.
+StringBuilder evaluate_lazy(const char* code);
+// Evaluates lazily, and evaluates independent definitions of dictionaries
+// that are evaluated once at the same time, in worker processes.
+StringBuilder evaluate_parallel(const char* code);
+// Shares the storage of strings, stacks and tuples that are made from the same items.
+StringBuilder evaluate_interned(const char* code);
+// Compiles functions to machine code when they are called many times, if there is a compiler.
+StringBuilder evaluate_jit(const char* code);
+// Transpiles a program to C++, which is compiled and linked with manglang_lib.
+StringBuilder transpile(const char* code);
+typedef Expression (*TranspiledProgram)(Expression environment);
+// The C++ function of a function body, that is evaluated in the environment of a call.
+struct TranspiledFunction {
+    Expression body;
+    Expression (*function)(Expression environment);
+};
+// Evaluates a transpiled program, which gets the syntax tree of its code.
+// The transpiled functions are called instead of evaluating their bodies.
+StringBuilder evaluate_transpiled(
+    const char* code,
+    Expression ast,
+    TranspiledProgram program,
+    const TranspiledFunction* functions,
+    size_t function_count
+);
@@ -0,0 +1,147 @@
+#pragma once
+
+// Arithmetic on unboxed numbers, for numeric expressions.
+// The functions are inline, so that functions that are transpiled and compiled
+// do the arithmetic natively, instead of calling the interpreter.
+// Integers stay integers when the result fits, and the rest are done with doubles,
+// like the built-in arithmetic functions.
+
+#include <math.h>
+
+#include <bit>
+
+#include "expression.h"
+
+// Integer arithmetic that returns false instead of overflowing.
+// The ranges are checked before the operation, since not all compilers have overflow built-ins.
+
+inline bool addIntegers(Integer left, Integer right, Integer& result) {
+    if (right > 0 ? left > INT64_MAX - right : left < INT64_MIN - right) {
+        return false;
+    }
+    result = left + right;
+    return true;
+}
+
+inline bool subIntegers(Integer left, Integer right, Integer& result) {
+    if (right < 0 ? left > INT64_MAX + right : left < INT64_MIN + right) {
+        return false;
+    }
+    result = left - right;
+    return true;
+}
+
+inline bool mulIntegers(Integer left, Integer right, Integer& result) {
+    const auto is_overflow = left > 0 ?
+        (right > 0 ? left > INT64_MAX / right : right < INT64_MIN / left) :
+        (right > 0 ? left < INT64_MIN / right : left != 0 && right < INT64_MAX / left);
+    if (is_overflow) {
+        return false;
+    }
+    result = left * right;
+    return true;
+}
+
+// A number on the stack of a numeric expression.
+// Unlike an expression it is not initialized, and it has no code range.
+struct StackNumber {
+    size_t bits;
+    ExpressionType type; // INTEGER or NUMBER.
+};
+
+inline bool isStackNumber(Expression expression) {
+    return expression.type == INTEGER || expression.type == NUMBER;
+}
+
+inline StackNumber makeStackNumber(Expression number) {
+    return StackNumber{number.index, number.type};
+}
+
+inline Expression makeExpressionFromStack(StackNumber number) {
+    return Expression{number.bits, CodeRange{}, number.type};
+}
+
+inline bool isIntegerPair(StackNumber left, StackNumber right) {
+    return left.type == INTEGER && right.type == INTEGER;
+}
+
+inline Integer getStackInteger(StackNumber number) {
+    return static_cast<Integer>(number.bits);
+}
+
+inline Number getStackNumber(StackNumber number) {
+    return number.type == INTEGER ?
+        static_cast<Number>(getStackInteger(number)) : std::bit_cast<Number>(number.bits);
+}
+
+inline StackNumber makeStackInteger(Integer integer) {
+    return StackNumber{static_cast<size_t>(integer), INTEGER};
+}
+
+// Stores the number as an integer when it has no fraction, like makeNumber.
+inline StackNumber makeStackNumber(Number number) {
+    const auto is_integral = number >= -0x1p63 && number < 0x1p63 &&
+        number == static_cast<Number>(static_cast<Integer>(number)) &&
+        !(number == 0 && signbit(number));
+    return is_integral ?
+        makeStackInteger(static_cast<Integer>(number)) :
+        StackNumber{std::bit_cast<size_t>(number), NUMBER};
+}
+
+inline StackNumber addStackNumbers(StackNumber left, StackNumber right) {
+    auto result = Integer{};
+    return isIntegerPair(left, right) &&
+        addIntegers(getStackInteger(left), getStackInteger(right), result) ?
+        makeStackInteger(result) : makeStackNumber(getStackNumber(left) + getStackNumber(right));
+}
+
+inline StackNumber subStackNumbers(StackNumber left, StackNumber right) {
+    auto result = Integer{};
+    return isIntegerPair(left, right) &&
+        subIntegers(getStackInteger(left), getStackInteger(right), result) ?
+        makeStackInteger(result) : makeStackNumber(getStackNumber(left) - getStackNumber(right));
+}
+
+// A zero result of mul, div and mod is negative zero when the signs of the operands differ,
+// or for mod when the left operand is negative, so it is left to doubles.
+// Integers can not be negative zero.
+
+inline bool mulExactIntegers(Integer left, Integer right, Integer& result) {
+    return mulIntegers(left, right, result) && !(result == 0 && (left < 0 || right < 0));
+}
+
+// Division by -1 is left to doubles, since it overflows for the smallest integer.
+inline bool isExactDivision(Integer left, Integer right) {
+    return right != 0 && right != -1 && left % right == 0 && !(left == 0 && right < 0);
+}
+
+inline bool isExactModulo(Integer left, Integer right) {
+    return right != 0 && right != -1 && !(left < 0 && left % right == 0);
+}
+
+inline StackNumber mulStackNumbers(StackNumber left, StackNumber right) {
+    auto result = Integer{};
+    return isIntegerPair(left, right) &&
+        mulExactIntegers(getStackInteger(left), getStackInteger(right), result) ?
+        makeStackInteger(result) : makeStackNumber(getStackNumber(left) * getStackNumber(right));
+}
+
+inline StackNumber divStackNumbers(StackNumber left, StackNumber right) {
+    if (isIntegerPair(left, right) && isExactDivision(getStackInteger(left), getStackInteger(right))) {
+        return makeStackInteger(getStackInteger(left) / getStackInteger(right));
+    }
+    return makeStackNumber(getStackNumber(left) / getStackNumber(right));
+}
+
+inline StackNumber modStackNumbers(StackNumber left, StackNumber right) {
+    if (isIntegerPair(left, right) && isExactModulo(getStackInteger(left), getStackInteger(right))) {
+        return makeStackInteger(getStackInteger(left) % getStackInteger(right));
+    }
+    return makeStackNumber(fmod(getStackNumber(left), getStackNumber(right)));
+}
+
+inline Expression lessStackNumbers(StackNumber left, StackNumber right) {
+    const auto is_less = isIntegerPair(left, right) ?
+        getStackInteger(left) < getStackInteger(right) : getStackNumber(left) < getStackNumber(right);
+    return Expression{0, CodeRange{}, is_less ? YES : NO};
+}
@@ -0,0 +1,356 @@
+#include "defer.h"
+
+#include <stdint.h>
+
+#include <algorithm>
+
+#include <carma/carma.h>
+
+#include "../factory.h"
+#include "scope.h"
+
+// This pass runs after folding and before evaluation, when evaluating lazily.
+// It wraps definitions in lazy expressions, which are evaluated the first time
+// their names are looked up, instead of when their dictionary is evaluated.
+// A definition is only deferred if that does not change the result of the program.
+// It should be assigned once outside of loops, and only depend on names that
+// are defined before it in the same way. It should also not depend on tables or grids,
+// since they are mutated, or on function arguments, since they can be tables or grids.
+// When evaluating in parallel, each deferred definition also gets a level that is
+// higher than the levels of the deferred definitions that it depends on,
+// and dictionaries that are evaluated once force their deferred definitions
+// level by level when they end, see forceDefinitionsInParallel.
+
+namespace {
+
+const size_t NO_SCOPE = SIZE_MAX;
+const size_t NO_NAME = SIZE_MAX;
+
+struct Scope {
+    Expression expression; // DICTIONARY, FUNCTION or FUNCTION_TUPLE.
+    size_t definition_name; // Name that a dictionary is currently defining.
+    size_t definition_level; // Lowest level that the current definition can have.
+    bool is_looping; // If a dictionary is currently inside a loop.
+};
+
+struct StableDefinition {
+    size_t scope;
+    size_t name;
+    size_t level; // Level after which the definition has its value.
+};
+
+struct Deferrer {
+    bool is_deferring;
+    bool is_parallel;
+    // Workers do not report the calls of functions back, so programs that use
+    // built-ins that observe calls, like memo_statistics, are evaluated without them.
+    bool is_calls_observed;
+    Expression built_ins;
+    DARRAY(Scope) scopes;
+    DARRAY(StableDefinition) stable_definitions;
+    DARRAY(Expression) parallel_dictionaries;
+};
+
+// The functions below return the outermost scope that an expression depends on
+// in a way that is not stable, or NO_SCOPE if it is stable in all scopes.
+size_t deferExpression(Deferrer& deferrer, Expression expression);
+
+size_t outermost(size_t a, size_t b) {
+    return a < b ? a : b;
+}
+
+bool isInsideFunction(const Deferrer& deferrer, size_t scope) {
+    for (auto i = scope + 1; i < deferrer.scopes.count; ++i) {
+        const auto type = deferrer.scopes.data[i].expression.type;
+        if (type == FUNCTION || type == FUNCTION_TUPLE) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const StableDefinition* findStableDefinition(const Deferrer& deferrer, size_t scope, size_t name) {
+    for (size_t i = 0; i < deferrer.stable_definitions.count; ++i) {
+        const auto& definition = deferrer.stable_definitions.data[i];
+        if (definition.scope == scope && definition.name == name) {
+            return &definition;
+        }
+    }
+    return nullptr;
+}
+
+BuiltInEffect getBuiltInEffect(const Deferrer& deferrer, size_t name) {
+    if (deferrer.built_ins.type != EVALUATED_DICTIONARY) {
+        return EFFECT_NONE;
+    }
+    FOR_EACH(i, storage.evaluated_dictionaries.data[deferrer.built_ins.index].definitions) {
+        const auto definition = storage.definitions.data[i];
+        if (definition.name.global_index == name && definition.expression.type == FUNCTION_BUILT_IN) {
+            return storage.built_in_functions.data[definition.expression.index].effect;
+        }
+    }
+    return EFFECT_NONE;
+}
+
+// Dictionaries in functions or loops can be evaluated many times.
+bool isEvaluatedOnce(const Deferrer& deferrer) {
+    for (size_t i = 0; i < deferrer.scopes.count; ++i) {
+        const auto scope = deferrer.scopes.data[i];
+        if (scope.expression.type != DICTIONARY || scope.is_looping) {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t deferName(Deferrer& deferrer, size_t name) {
+    for (auto scope = deferrer.scopes.count; scope-- > 0;) {
+        auto& s = deferrer.scopes.data[scope];
+        if (!isBinding(s.expression, name)) {
+            continue;
+        }
+        if (s.expression.type != DICTIONARY) {
+            return scope;
+        }
+        if (const auto definition = findStableDefinition(deferrer, scope, name)) {
+            s.definition_level = std::max(s.definition_level, definition->level);
+            return NO_SCOPE;
+        }
+        // A function can refer to the definition that it is part of,
+        // since it can only be called after the definition.
+        if (s.definition_name == name && isInsideFunction(deferrer, scope)) {
+            return NO_SCOPE;
+        }
+        return scope;
+    }
+    // Built-in functions do not change, but the containers that some of them make do.
+    const auto effect = getBuiltInEffect(deferrer, name);
+    if (effect == EFFECT_OBSERVES_CALLS) {
+        deferrer.is_calls_observed = true;
+    }
+    return effect == EFFECT_MUTABLE_RESULT ? 0 : NO_SCOPE;
+}
+
+bool isCheap(Expression expression) {
+    switch (expression.type) {
+        case FOLDED_EXPRESSION: return isCheap(storage.folded_expressions.data[expression.index].folded);
+        case TYPED_EXPRESSION: return isCheap(storage.typed_expressions.data[expression.index].value);
+        case NUMBER: return true;
+        case INTEGER: return true;
+        case CHARACTER: return true;
+        case YES: return true;
+        case NO: return true;
+        case EMPTY_STACK: return true;
+        case EMPTY_STRING: return true;
+        case STRING: return true;
+        case LOOKUP_SYMBOL: return true;
+        case FUNCTION: return true;
+        case FUNCTION_TUPLE: return true;
+        case FUNCTION_DICTIONARY: return true;
+        default: return false;
+    }
+}
+
+size_t deferStatements(Deferrer& deferrer, size_t scope) {
+    const auto dictionary = deferrer.scopes.data[scope].expression;
+    const auto statements = storage.dictionaries.data[dictionary.index].statements;
+    auto result = NO_SCOPE;
+    auto loop_depth = 0;
+    auto deferred_count = 0;
+    FOR_EACH(i, statements) {
+        const auto statement = storage.statements.data[i];
+        // The condition of a while loop is evaluated in each iteration.
+        deferrer.scopes.data[scope].is_looping = loop_depth > 0 || statement.type == WHILE_STATEMENT;
+        switch (statement.type) {
+            case DEFINITION: {
+                const auto definition = storage.definitions.data[statement.index];
+                const auto name = definition.name.global_index;
+                deferrer.scopes.data[scope].definition_name = name;
+                deferrer.scopes.data[scope].definition_level = 0;
+                const auto dependency = deferExpression(deferrer, definition.expression);
+                deferrer.scopes.data[scope].definition_name = NO_NAME;
+                const auto level = deferrer.scopes.data[scope].definition_level;
+                result = outermost(result, dependency);
+                const auto is_stable = loop_depth == 0 && dependency > scope &&
+                    countAssignments(statements, name) == 1;
+                if (!is_stable) {
+                    break;
+                }
+                if (!deferrer.is_deferring || isCheap(definition.expression)) {
+                    APPEND(deferrer.stable_definitions, (StableDefinition{scope, name, level}));
+                    break;
+                }
+                APPEND(deferrer.stable_definitions, (StableDefinition{scope, name, level + 1}));
+                const auto lazy_expression = makeLazyExpression(
+                    statement.range, LazyExpression{definition.expression, level}
+                );
+                storage.definitions.data[statement.index].expression = lazy_expression;
+                ++deferred_count;
+                break;
+            }
+            case PUT_ASSIGNMENT: {
+                const auto expression = storage.put_assignments.data[statement.index].expression;
+                result = outermost(result, deferExpression(deferrer, expression));
+                break;
+            }
+            case PUT_EACH_ASSIGNMENT: {
+                const auto expression = storage.put_each_assignments.data[statement.index].expression;
+                result = outermost(result, deferExpression(deferrer, expression));
+                break;
+            }
+            case WHILE_STATEMENT: {
+                const auto expression = storage.while_statements.data[statement.index].expression;
+                result = outermost(result, deferExpression(deferrer, expression));
+                ++loop_depth;
+                break;
+            }
+            case FOR_STATEMENT: ++loop_depth; break;
+            case FOR_SIMPLE_STATEMENT: ++loop_depth; break;
+            case WHILE_END_STATEMENT: --loop_depth; break;
+            case FOR_END_STATEMENT: --loop_depth; break;
+            case FOR_SIMPLE_END_STATEMENT: --loop_depth; break;
+            default: break;
+        }
+    }
+    deferrer.scopes.data[scope].is_looping = false;
+    if (deferrer.is_parallel && deferred_count >= 2 && isEvaluatedOnce(deferrer)) {
+        APPEND(deferrer.parallel_dictionaries, dictionary);
+    }
+    return result;
+}
+
+size_t deferDictionary(Deferrer& deferrer, Expression dictionary) {
+    const auto scope = deferrer.scopes.count;
+    const auto stable_definition_count = deferrer.stable_definitions.count;
+    APPEND(deferrer.scopes, (Scope{dictionary, NO_NAME, 0, false}));
+    const auto result = deferStatements(deferrer, scope);
+    deferrer.stable_definitions.count = stable_definition_count;
+    deferrer.scopes.count = scope;
+    return result;
+}
+
+size_t deferFunction(Deferrer& deferrer, Expression function) {
+    const auto function_struct = storage.functions.data[function.index];
+    auto result = deferExpression(deferrer, storage.arguments.data[function_struct.argument].type);
+    APPEND(deferrer.scopes, (Scope{function, NO_NAME, 0, false}));
+    result = outermost(result, deferExpression(deferrer, function_struct.body));
+    --deferrer.scopes.count;
+    return result;
+}
+
+size_t deferFunctionTuple(Deferrer& deferrer, Expression function) {
+    const auto function_struct = storage.tuple_functions.data[function.index];
+    auto result = NO_SCOPE;
+    FOR_EACH(i, function_struct.arguments) {
+        result = outermost(result, deferExpression(deferrer, storage.arguments.data[i].type));
+    }
+    APPEND(deferrer.scopes, (Scope{function, NO_NAME, 0, false}));
+    result = outermost(result, deferExpression(deferrer, function_struct.body));
+    --deferrer.scopes.count;
+    return result;
+}
+
+size_t deferAlternatives(Deferrer& deferrer, Indices alternatives) {
+    auto result = NO_SCOPE;
+    FOR_EACH(a, alternatives) {
+        const auto alternative = storage.alternatives.data[a];
+        result = outermost(result, deferExpression(deferrer, alternative.left));
+        result = outermost(result, deferExpression(deferrer, alternative.right));
+    }
+    return result;
+}
+
+size_t deferConditional(Deferrer& deferrer, Expression conditional) {
+    const auto conditional_struct = storage.conditionals.data[conditional.index];
+    const auto result = deferAlternatives(deferrer, conditional_struct.alternatives);
+    return outermost(result, deferExpression(deferrer, conditional_struct.expression_else));
+}
+
+size_t deferIs(Deferrer& deferrer, Expression is) {
+    const auto is_struct = storage.is_expressions.data[is.index];
+    auto result = deferExpression(deferrer, is_struct.input);
+    result = outermost(result, deferAlternatives(deferrer, is_struct.alternative));
+    return outermost(result, deferExpression(deferrer, is_struct.expression_else));
+}
+
+size_t deferTuple(Deferrer& deferrer, Expression tuple) {
+    auto result = NO_SCOPE;
+    FOR_EACH(i, storage.tuples.data[tuple.index].indices) {
+        result = outermost(result, deferExpression(deferrer, storage.expressions.data[i]));
+    }
+    return result;
+}
+
+size_t deferStack(Deferrer& deferrer, Expression stack) {
+    auto result = NO_SCOPE;
+    for (auto item = stack; item.type == STACK; item = storage.stacks.data[item.index].rest) {
+        const auto top = storage.stacks.data[item.index].top;
+        result = outermost(result, deferExpression(deferrer, top));
+    }
+    return result;
+}
+
+size_t deferFunctionApplication(Deferrer& deferrer, Expression function_application) {
+    const auto function_application_struct = storage.function_applications.data[function_application.index];
+    const auto result = deferName(deferrer, function_application_struct.name.global_index);
+    return outermost(result, deferExpression(deferrer, function_application_struct.child));
+}
+
+size_t deferTypedExpression(Deferrer& deferrer, Expression typed_expression) {
+    const auto typed_expression_struct = storage.typed_expressions.data[typed_expression.index];
+    const auto result = deferName(deferrer, typed_expression_struct.type_name.global_index);
+    return outermost(result, deferExpression(deferrer, typed_expression_struct.value));
+}
+
+size_t deferExpression(Deferrer& deferrer, Expression expression) {
+    switch (expression.type) {
+        case LOOKUP_SYMBOL: return deferName(deferrer, storage.symbol_lookups.data[expression.index].name.global_index);
+        case FUNCTION_APPLICATION: return deferFunctionApplication(deferrer, expression);
+        case TYPED_EXPRESSION: return deferTypedExpression(deferrer, expression);
+        case LOOKUP_CHILD: return deferExpression(deferrer, storage.child_lookups.data[expression.index].child);
+        case DYNAMIC_EXPRESSION: return deferExpression(deferrer, storage.dynamic_expressions.data[expression.index].expression);
+        case FOLDED_EXPRESSION: return deferExpression(deferrer, storage.folded_expressions.data[expression.index].folded);
+        case LAZY_EXPRESSION: return deferExpression(deferrer, storage.lazy_expressions.data[expression.index].expression);
+        case STREAM: return deferExpression(deferrer, storage.streams.data[expression.index].original);
+        case IS_TABLE: return deferExpression(deferrer, storage.is_tables.data[expression.index].is);
+        case NUMERIC: return deferExpression(deferrer, storage.numerics.data[expression.index].original);
+        case CONDITIONAL: return deferConditional(deferrer, expression);
+        case IS: return deferIs(deferrer, expression);
+        case DICTIONARY: return deferDictionary(deferrer, expression);
+        case FUNCTION: return deferFunction(deferrer, expression);
+        case FUNCTION_TUPLE: return deferFunctionTuple(deferrer, expression);
+        case TUPLE: return deferTuple(deferrer, expression);
+        case STACK: return deferStack(deferrer, expression);
+        // Tables are mutated, and dictionary functions look up names in their input.
+        case TABLE: return 0;
+        case FUNCTION_DICTIONARY: return 0;
+        default: return NO_SCOPE;
+    }
+}
+
+} // namespace
+
+// The environment is the dictionary that the expression is evaluated in,
+// for example the standard library, which has already been deferred.
+Expression defer(Expression expression, Expression environment, Expression built_ins, bool is_parallel) {
+    auto deferrer = Deferrer{};
+    deferrer.built_ins = built_ins;
+    if (environment.type == DICTIONARY) {
+        APPEND(deferrer.scopes, (Scope{environment, NO_NAME, 0, false}));
+        deferStatements(deferrer, 0);
+    }
+    deferrer.is_deferring = true;
+    deferrer.is_parallel = is_parallel;
+    deferExpression(deferrer, expression);
+    if (!deferrer.is_calls_observed) {
+        FOR_EACH(dictionary, deferrer.parallel_dictionaries) {
+            const auto instructions = storage.dictionaries.data[dictionary->index].instructions;
+            auto& last = storage.instructions.data[instructions.data + instructions.count - 1];
+            last.type = OP_DICTIONARY_END_PARALLEL;
+        }
+    }
+    FREE_DARRAY(deferrer.scopes);
+    FREE_DARRAY(deferrer.stable_definitions);
+    FREE_DARRAY(deferrer.parallel_dictionaries);
+    return expression;
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+struct Expression;
+
+// The built-ins are the evaluated dictionary of built-in functions, whose effects are marked.
+Expression defer(Expression expression, Expression environment, Expression built_ins, bool is_parallel);
@@ -1,15 +1,26 @@
 #include "evaluate.h"
 
+#include <bit>
 #include <cassert>
+#include <cmath>
 #include <string.h>
 
+#include <vector>
+
 #include <carma/carma.h>
 
+#include "../built_in_functions/arithmetic.h"
 #include "../built_in_functions/container.h"
+#include "../built_in_functions/grid.h"
+#include "../built_in_functions/memo.h"
+#include "../built_in_functions/set.h"
 #include "../exceptions.h"
 #include "../factory.h"
+#include "../jit.h"
 #include "../mang_lang_string.h"
+#include "../numeric.h"
 #include "../type_check.h"
+#include "../workers.h"
 #include "serialize.h"
 
 namespace {
@@ -19,12 +30,14 @@ struct OptionalLookup {
     bool ok;
 };
     
+// A dictionary has one definition per name, so the search stops at the first match.
 OptionalLookup optionalLookup(EvaluatedDictionary dictionary, size_t name) {
     auto result = MAKE(OptionalLookup);
     FOR_EACH(i, dictionary.definitions) {
         if (storage.definitions.data[i].name.global_index == name) {
-            result.value = storage.definitions.data[i].expression;
+            result.value = forceDefinition(i);
             result.ok = true;
+            return result;
         }
     }
     return result;
@@ -47,6 +60,36 @@ TypeCheck checkTypesEvaluatedStack(Expression super, Expression sub, const char*
     return checkTypes(stack_super, stack_sub, description);
 }
 
+TypeCheck checkTypesEvaluatedDeque(Expression super, Expression sub, const char* description) {
+    auto result = TypeCheck{.ok=true};
+    const auto deque_super = storage.evaluated_deques.data[super.index];
+    const auto deque_sub = storage.evaluated_deques.data[sub.index];
+    if (deque_super.first == deque_super.last || deque_sub.first == deque_sub.last) {
+        return result;
+    }
+    return checkTypes(
+        storage.deque_buffers.at(deque_super.buffer).at(deque_super.first),
+        storage.deque_buffers.at(deque_sub.buffer).at(deque_sub.first),
+        description
+    );
+}
+
+TypeCheck checkTypesEvaluatedSet(Expression super, Expression sub, const char* description) {
+    auto result = TypeCheck{.ok=true};
+    if (isEmptySet(super) || isEmptySet(sub)) {
+        return result;
+    }
+    return checkTypes(takeSet(super), takeSet(sub), description);
+}
+
+TypeCheck checkTypesEvaluatedGrid(Expression super, Expression sub, const char* description) {
+    auto result = TypeCheck{.ok=true};
+    if (isEmptyGrid(super) || isEmptyGrid(sub)) {
+        return result;
+    }
+    return checkTypes(applyGridIndexingTypes(super), applyGridIndexingTypes(sub), description);
+}
+
 TypeCheck checkTypesEvaluatedTable(Expression super, Expression sub, const char* description) {
     auto result = TypeCheck{.ok=true};
     const auto& table_super = storage.evaluated_tables.at(super.index);
@@ -113,7 +156,9 @@ TypeCheck checkTypes(Expression super, Expression sub, const char* description)
     auto result = TypeCheck{.ok=true};
     if (super.type == ANY || sub.type == ANY) return result;
     
-    if (super.type == NUMBER && sub.type == NUMBER) return result;
+    const auto is_super_number = super.type == NUMBER || super.type == INTEGER;
+    const auto is_sub_number = sub.type == NUMBER || sub.type == INTEGER;
+    if (is_super_number && is_sub_number) return result;
     if (super.type == CHARACTER && sub.type == CHARACTER) return result;
     
     if (super.type == NO && sub.type == NO) return result;
@@ -125,9 +170,11 @@ TypeCheck checkTypes(Expression super, Expression sub, const char* description)
     if (super.type == FUNCTION && sub.type == FUNCTION_DICTIONARY) return result;
     if (super.type == FUNCTION && sub.type == FUNCTION_TUPLE) return result;
     if (super.type == FUNCTION && sub.type == FUNCTION_BUILT_IN) return result;
+    if (super.type == FUNCTION && sub.type == FUNCTION_MEMO) return result;
     if (super.type == FUNCTION_DICTIONARY && sub.type == FUNCTION) return result;
     if (super.type == FUNCTION_TUPLE && sub.type == FUNCTION) return result;
     if (super.type == FUNCTION_BUILT_IN && sub.type == FUNCTION) return result;
+    if (super.type == FUNCTION_MEMO && sub.type == FUNCTION) return result;
     
     if (super.type == EMPTY_STRING && sub.type == EMPTY_STRING) return result;
     if (super.type == EMPTY_STRING && sub.type == STRING) return result;
@@ -140,9 +187,28 @@ TypeCheck checkTypes(Expression super, Expression sub, const char* description)
     if (super.type == EVALUATED_STACK && sub.type == EVALUATED_STACK) {
         return checkTypesEvaluatedStack(super, sub, description);
     }
+    // Ranges are stacks of numbers.
+    if (super.type == EVALUATED_RANGE || sub.type == EVALUATED_RANGE) {
+        const auto number = makeNumber(CodeRange{}, 0);
+        const auto stack = makeEvaluatedStack(CodeRange{}, EvaluatedStack{number, Expression{0, {}, EMPTY_STACK}});
+        return checkTypes(
+            super.type == EVALUATED_RANGE ? stack : super,
+            sub.type == EVALUATED_RANGE ? stack : sub,
+            description
+        );
+    }
     if (super.type == EVALUATED_TABLE && sub.type == EVALUATED_TABLE) {
         return checkTypesEvaluatedTable(super, sub, description);
     }
+    if (super.type == EVALUATED_DEQUE && sub.type == EVALUATED_DEQUE) {
+        return checkTypesEvaluatedDeque(super, sub, description);
+    }
+    if (super.type == EVALUATED_SET && sub.type == EVALUATED_SET) {
+        return checkTypesEvaluatedSet(super, sub, description);
+    }
+    if (super.type == EVALUATED_GRID && sub.type == EVALUATED_GRID) {
+        return checkTypesEvaluatedGrid(super, sub, description);
+    }
     if (super.type == EVALUATED_TUPLE && sub.type == EVALUATED_TUPLE) {
         return checkTypesEvaluatedTuple(super, sub, description);
     }
@@ -238,43 +304,50 @@ Expression evaluateLookupChild(
 ) {
     const auto lookup_child_struct = storage.child_lookups.data[lookup_child.index];
     const auto child = evaluator(lookup_child_struct.child, environment);
-    if (child.type == ERROR_EXPRESSION) {
-        return child;
-    }
-    if (child.type != EVALUATED_DICTIONARY) {
-        auto name = storage.names.data + lookup_child_struct.name;
-        return makeErrorExpression(lookup_child.range,
-            "\n\nI have found an error.\n"
-            "It happens when trying to lookup the child named \"%s\" in a dictionary,\n"
-            "but instead of a dictionary I got a %s.\n",
-            name,
-            getExpressionName(child.type)
-        );
+    return lookupChild(lookup_child.range, lookup_child_struct.name, child);
+}
+
+TypeProof mergeTypeProof(TypeProof proof, bool ok) {
+    if (!ok) return TYPE_UNPROVEN;
+    if (proof == TYPE_UNPROVEN) return TYPE_UNPROVEN;
+    return TYPE_PROVEN;
+}
+
+void checkArgumentTypes(size_t argument, Expression input, Expression environment) {
+    const auto a = storage.arguments.data[argument];
+    if (a.type.type == ANY) {
+        return;
     }
-    const auto dictionary = storage.evaluated_dictionaries.data[child.index];
-    return requiredLookup(dictionary, lookup_child_struct.name);
+    const auto type = evaluate_types(a.type, environment);
+    const auto type_check = checkTypes(input, type, "function call");
+    const auto ok = type_check.ok && input.type != ANY && type.type != ANY;
+    auto& proof = storage.arguments.data[argument].proof;
+    proof = mergeTypeProof(proof, ok);
 }
 
-template<typename Evaluator>
-void checkArgument(
-    Evaluator evaluator, const Argument& a, Expression input, Expression environment
-) {
+void checkArgument(size_t argument, Expression input, Expression environment) {
+    const auto a = storage.arguments.data[argument];
     if (a.type.type == ANY) {
         return;
     }
-    const auto type = evaluator(a.type, environment);
+    // The type pass has already checked this argument for all calls it reached.
+    if (a.proof == TYPE_PROVEN) {
+        return;
+    }
+    const auto type = evaluate(a.type, environment);
     checkTypes(input, type, "function call");
 }
 
-template<typename Evaluator>
+template<typename Evaluator, typename ArgumentChecker>
 Expression applyFunction(
     Evaluator evaluator,
+    ArgumentChecker argument_checker,
     Expression function,
     Expression input
 ) {
     const auto function_struct = storage.functions.data[function.index];
     const auto argument = storage.arguments.data[function_struct.argument];
-    checkArgument(evaluator, argument, input, function_struct.environment);
+    argument_checker(function_struct.argument, input, function_struct.environment);
     // TODO: allocate on storage.definitions directly?
     // This is a trade-off between heap fragmentation and automated memory cleanup.
     // Allocation:
@@ -288,9 +361,10 @@ Expression applyFunction(
     return evaluator(function_struct.body, middle);
 }
 
-template<typename Evaluator>
+template<typename Evaluator, typename ArgumentChecker>
 Expression applyFunctionDictionary(
     Evaluator evaluator,
+    ArgumentChecker argument_checker,
     Expression function,
     Expression input
 ) {
@@ -307,15 +381,16 @@ Expression applyFunctionDictionary(
     FOR_EACH(i, function_struct.arguments) {
         const auto argument = storage.arguments.data[i];
         const auto expression = requiredLookup(evaluated_dictionary, argument.name);
-        checkArgument(evaluator, argument, expression, function_struct.environment);
+        argument_checker(i, expression, function_struct.environment);
     }
     // TODO: pass along environment? Is some use case missing now?
     return evaluator(function_struct.body, input);
 }
 
-template<typename Evaluator>
+template<typename Evaluator, typename ArgumentChecker>
 Expression applyFunctionTuple(
     Evaluator evaluator,
+    ArgumentChecker argument_checker,
     Expression function,
     Expression input
 ) {
@@ -349,7 +424,7 @@ Expression applyFunctionTuple(
     for (size_t i = 0; i < num_inputs; ++i) {
         const auto argument = storage.arguments.data[argument_index + i];
         const auto expression = storage.expressions.data[tuple.indices.data + i];
-        checkArgument(evaluator, argument, expression, function_struct.environment);
+        argument_checker(argument_index + i, expression, function_struct.environment);
         makeDefinition({}, Definition{BoundLocalName{argument.name, i}, expression});
     }
     auto last = storage.definitions.count;
@@ -360,10 +435,43 @@ Expression applyFunctionTuple(
     return evaluator(function_struct.body, middle);
 }
 
+Expression applyMemoizedFunction(Expression function, Expression input) {
+    if (function.type == FUNCTION_TUPLE) {
+        return applyFunctionTuple(evaluate, checkArgument, function, input);
+    }
+    return applyFunction(evaluate, checkArgument, function, input);
+}
+
+Expression applyFunctionMemo(Expression function, Expression input) {
+    const auto memo = storage.memo_functions.data[function.index];
+    if (!isMemoValue(input)) {
+        return applyMemoizedFunction(memo.function, input);
+    }
+    const auto hash = hashExpression(input);
+    const auto lookup = lookupMemo(memo.cache, hash, input);
+    if (lookup.ok) {
+        return lookup.value;
+    }
+    const auto output = applyMemoizedFunction(memo.function, input);
+    if (isMemoValue(output)) {
+        storeMemo(memo.cache, hash, input, output);
+    }
+    return output;
+}
+
+Expression captureEnvironment(Expression environment, size_t steps) {
+    for (size_t i = 0; i < steps && environment.type == EVALUATED_DICTIONARY; ++i) {
+        environment = storage.evaluated_dictionaries.data[environment.index].environment;
+    }
+    return environment;
+}
+
 Expression evaluateFunction(Expression function, Expression environment) {
     const auto function_struct = storage.functions.data[function.index];
     return makeFunction(function.range, {
-        environment, function_struct.argument, function_struct.body
+        captureEnvironment(environment, function_struct.environment_steps),
+        function_struct.argument,
+        function_struct.body
     });
 }
 
@@ -383,30 +491,43 @@ Expression evaluateFunctionTuple(
 ) {
     const auto function_tuple_struct = storage.tuple_functions.data[function_tuple.index];
     return makeFunctionTuple(function_tuple.range, {
-        environment, function_tuple_struct.arguments, function_tuple_struct.body
+        captureEnvironment(environment, function_tuple_struct.environment_steps),
+        function_tuple_struct.arguments,
+        function_tuple_struct.body
     });
 }
 
-Expression lookupDictionary(CodeRange range, BoundGlobalName name, Expression expression) {
-    if (expression.type != EVALUATED_DICTIONARY) {
-        auto symbol = storage.names.data + name.global_index;
-        auto expression_name = getExpressionName(expression.type);
-        return makeErrorExpression(range,
-            "Cannot find symbol %s in environment of type %s.", symbol, expression_name);
-    }
-    const auto dictionary = storage.evaluated_dictionaries.data[expression.index];
-    const auto result = optionalLookup(dictionary, name.global_index);
-    if (result.ok) {
-        return result.value;
-    }
-    return lookupDictionary(range, name, dictionary.environment);
-}
-
 Expression lookupSymbolInDictionary(Expression symbol, Expression environment) {
     auto name = storage.symbol_lookups.data[symbol.index].name;
     return lookupDictionary(symbol.range, name, environment);
 }
     
+bool isKnownInput(Expression input) {
+    if (input.type == ANY) return false;
+    if (input.type != EVALUATED_TUPLE) return true;
+    const auto tuple = storage.evaluated_tuples.data[input.index];
+    FOR_EACH(i, tuple.indices) {
+        if (storage.expressions.data[i].type == ANY) return false;
+    }
+    return true;
+}
+
+Expression applyFunctionBuiltInTypes(
+    Expression function_application, Expression function, Expression input
+) {
+    if (input.type == ERROR_EXPRESSION) return input;
+    const auto function_struct = storage.built_in_functions.data[function.index];
+    const auto result = function_struct.function(input);
+    auto& application = storage.function_applications.data[function_application.index];
+    const auto is_same_function = application.proof == TYPE_UNVISITED ||
+        application.proven_function == function_struct.function;
+    const auto ok = result.type != ERROR_EXPRESSION &&
+        is_same_function && isKnownInput(input);
+    application.proof = mergeTypeProof(application.proof, ok);
+    application.proven_function = function_struct.function;
+    return result;
+}
+
 Expression applyFunctionBuiltIn(
     Expression function, Expression input
 ) {
@@ -415,19 +536,42 @@ Expression applyFunctionBuiltIn(
     return function_struct.function(input);
 }
 
-struct BooleanResult {
-    bool value;
-    Expression error;
-};
+bool isTupleLiteralOfTwo(Expression expression) {
+    return expression.type == TUPLE &&
+        storage.tuples.data[expression.index].indices.count == 2;
+}
+
+// Evaluates the items of a tuple literal directly into the two operands,
+// so that calls like add!(x 1) do not allocate any evaluated tuple.
+Expression applyFunctionBuiltInBinary(
+    Expression function_application, Expression function, Expression environment
+) {
+    const auto function_struct = storage.built_in_functions.data[function.index];
+    const auto application = storage.function_applications.data[function_application.index];
+    const auto tuple = storage.tuples.data[application.child.index];
+    const auto left = evaluate(storage.expressions.data[tuple.indices.data + 0], environment);
+    const auto right = evaluate(storage.expressions.data[tuple.indices.data + 1], environment);
+    if (application.proof == TYPE_PROVEN &&
+        application.proven_function == function_struct.function &&
+        function_struct.proven_binary_function
+    ) {
+        return function_struct.proven_binary_function(left, right);
+    }
+    return function_struct.binary_function(left, right);
+}
 
 BooleanResult booleanTypes(Expression expression) {
     auto result = MAKE(BooleanResult);
     switch (expression.type) {
         case ERROR_EXPRESSION: return MAKE(BooleanResult, .error=expression);
         case NUMBER: return result;
+        case INTEGER: return result;
         case YES: return result;
         case NO: return result;
         case EVALUATED_TABLE: return result;
+        case EVALUATED_DEQUE: return result;
+        case EVALUATED_SET: return result;
+        case EVALUATED_GRID: return result;
         case EVALUATED_STACK: return result;
         case EMPTY_STACK: return result;
         case STRING: return result;
@@ -442,36 +586,16 @@ BooleanResult booleanTypes(Expression expression) {
     }
 }
     
-BooleanResult boolean(Expression expression) {
-    const auto type = expression.type;
-    const auto index = expression.index;
-    switch (type) {
-    case ERROR_EXPRESSION: return MAKE(BooleanResult, .error=expression);
-    case EVALUATED_TABLE: return MAKE(BooleanResult, .value=!storage.evaluated_tables.at(index).empty());
-    case EVALUATED_TABLE_VIEW: return MAKE(BooleanResult, .value=!storage.evaluated_table_views.data[index].empty());
-    case NUMBER: return MAKE(BooleanResult, .value=static_cast<bool>(getNumber(expression)));
-    case YES: return MAKE(BooleanResult, .value=true);
-    case NO: return MAKE(BooleanResult, .value=false);
-    case EVALUATED_STACK: return MAKE(BooleanResult, .value=true);
-    case EMPTY_STACK: return MAKE(BooleanResult, .value=false);
-    case STRING: return MAKE(BooleanResult, .value=true);
-    case EMPTY_STRING: return MAKE(BooleanResult, .value=false);
-    default: return MAKE(BooleanResult, .error=makeErrorExpression(expression.range,
-        "I found an error while trying to evaluate a boolean expression.\n"
-        "I got an unexpected type %s.", getExpressionName(type)));
-    }
-}
-
 Expression applyTupleIndexing(Expression tuple, Expression input) {
     const auto tuple_struct = storage.evaluated_tuples.data[tuple.index];
-    if (input.type != NUMBER) {
+    if (!isNumber(input)) {
         return makeErrorExpression(tuple.range,
             "\n\nI have found a type error.\n"
             "It happens when indexing a tuple.\n"
             "The index is expected to be a %s,\n"
-            "but now it is a %s.\n",
+            "but now it is %s %s.\n",
             getExpressionName(NUMBER),
-            getExpressionName(input.type)
+            getExpressionArticle(input.type), getExpressionName(input.type)
         );
     }
     const auto number = getNumber(input);
@@ -502,12 +626,17 @@ Expression applyStackIndexingTypes(Expression stack) {
     return storage.evaluated_stacks.data[stack.index].top;
 }
 
+Expression applyDequeIndexingTypes(Expression deque) {
+    if (isEmptyDeque(deque)) {
+        return Expression{0, deque.range, ANY};
+    }
+    return container_functions::take(deque);
+}
+
 Expression applyStringIndexingTypes(Expression string) {
     return storage.strings.data[string.index].top;
 }
 
-bool isEqual(Expression left, Expression right);
-
 bool isTuplePairwiseEqual(EvaluatedTuple left, EvaluatedTuple right) {
     if (left.indices.count != right.indices.count) {
         return false;
@@ -545,6 +674,142 @@ bool isStackPairwiseEqual(Expression left, Expression right) {
     return left.type == EMPTY_STACK && right.type == EMPTY_STACK;
 }
 
+size_t combineHash(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15 + (seed << 6) + (seed >> 2));
+}
+
+// Zero is used for hashes that are not computed yet.
+size_t nonZeroHash(size_t hash) {
+    return hash == 0 ? 1 : hash;
+}
+
+size_t hashNumber(Number number) {
+    // Zero and negative zero are equal, so they should have the same hash.
+    if (number == 0) {
+        return 0;
+    }
+    auto bits = size_t{0};
+    memcpy(&bits, &number, sizeof(number));
+    return bits;
+}
+
+// The hash of a string node combines the hash of its rest with its top,
+// so that the strings that share the rest also share its cached hash.
+size_t hashString(Expression string) {
+    auto uncached = std::vector<size_t>{};
+    auto hash = size_t{STRING};
+    for (auto item = string; item.type == STRING;) {
+        const auto node = storage.strings.data[item.index];
+        if (node.hash != 0) {
+            hash = node.hash;
+            break;
+        }
+        uncached.push_back(item.index);
+        item = node.rest;
+    }
+    for (auto it = uncached.rbegin(); it != uncached.rend(); ++it) {
+        const auto top = storage.strings.data[*it].top;
+        hash = nonZeroHash(combineHash(hash, (size_t)getCharacter(top)));
+        storage.strings.data[*it].hash = hash;
+    }
+    return hash;
+}
+
+size_t hashEvaluatedStack(Expression stack) {
+    auto uncached = std::vector<size_t>{};
+    auto hash = size_t{EVALUATED_STACK};
+    for (auto item = stack; item.type == EVALUATED_STACK;) {
+        const auto node = storage.evaluated_stacks.data[item.index];
+        if (node.hash != 0) {
+            hash = node.hash;
+            break;
+        }
+        uncached.push_back(item.index);
+        item = node.rest;
+    }
+    for (auto it = uncached.rbegin(); it != uncached.rend(); ++it) {
+        const auto top_hash = hashExpression(storage.evaluated_stacks.data[*it].top);
+        hash = nonZeroHash(combineHash(hash, top_hash));
+        storage.evaluated_stacks.data[*it].hash = hash;
+    }
+    return hash;
+}
+
+// Ranges are equal to stacks with the same numbers, so they are hashed the same way,
+// starting from the last number.
+size_t hashRange(Expression range) {
+    auto numbers = std::vector<Expression>{};
+    for (auto item = range; item.type == EVALUATED_RANGE; item = container_functions::drop(item)) {
+        numbers.push_back(container_functions::take(item));
+    }
+    auto hash = size_t{EVALUATED_STACK};
+    for (auto it = numbers.rbegin(); it != numbers.rend(); ++it) {
+        hash = nonZeroHash(combineHash(hash, hashExpression(*it)));
+    }
+    return hash;
+}
+
+size_t hashEvaluatedTuple(Expression tuple) {
+    const auto cached = storage.evaluated_tuples.data[tuple.index].hash;
+    if (cached != 0) {
+        return cached;
+    }
+    auto hash = size_t{EVALUATED_TUPLE};
+    FOR_EACH(i, storage.evaluated_tuples.data[tuple.index].indices) {
+        hash = combineHash(hash, hashExpression(storage.expressions.data[i]));
+    }
+    hash = nonZeroHash(hash);
+    storage.evaluated_tuples.data[tuple.index].hash = hash;
+    return hash;
+}
+
+// Compares ranges with ranges and stacks, without building stacks from the ranges.
+bool isRangePairwiseEqual(Expression left, Expression right) {
+    while (left.type != EMPTY_STACK && right.type != EMPTY_STACK) {
+        if (left.type != EVALUATED_STACK && left.type != EVALUATED_RANGE) {
+            return false;
+        }
+        if (right.type != EVALUATED_STACK && right.type != EVALUATED_RANGE) {
+            return false;
+        }
+        if (!isEqual(container_functions::take(left), container_functions::take(right))) {
+            return false;
+        }
+        left = container_functions::drop(left);
+        right = container_functions::drop(right);
+    }
+    return left.type == EMPTY_STACK && right.type == EMPTY_STACK;
+}
+
+bool isDequePairwiseEqual(EvaluatedDeque left, EvaluatedDeque right) {
+    if (left.last - left.first != right.last - right.first) {
+        return false;
+    }
+    const auto& left_buffer = storage.deque_buffers.at(left.buffer);
+    const auto& right_buffer = storage.deque_buffers.at(right.buffer);
+    for (size_t i = 0; i < left.last - left.first; ++i) {
+        if (!isEqual(left_buffer.at(left.first + i), right_buffer.at(right.first + i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Sets are equal when they have the same items, in any order.
+bool isSetEqual(Expression left, Expression right) {
+    const auto left_struct = storage.evaluated_sets.data[left.index];
+    const auto right_struct = storage.evaluated_sets.data[right.index];
+    if (left_struct.last - left_struct.first != right_struct.last - right_struct.first) {
+        return false;
+    }
+    for (auto set = left; !isEmptySet(set); set = dropSet(set)) {
+        if (!setContains(right, takeSet(set))) {
+            return false;
+        }
+    }
+    return true;
+}
+
 bool isStringPairwiseEqual(Expression left, Expression right) {
     while (left.type != EMPTY_STRING && right.type != EMPTY_STRING) {
         CHECK_INTERNAL(left.type == STRING,
@@ -568,50 +833,214 @@ bool isStringPairwiseEqual(Expression left, Expression right) {
     return left.type == EMPTY_STRING && right.type == EMPTY_STRING;
 }
 
+Expression evaluateDynamicExpressionTyped(Expression expression) {
+    return Expression{0, expression.range, ANY};
+}
 
-bool isEqual(Expression left, Expression right) {
-    const auto left_type = left.type;
-    const auto right_type = right.type;
-    if (left_type == NUMBER && right_type == NUMBER) {
-        return getNumber(left) == getNumber(right);
+Expression evaluateDynamicExpression(Expression expression, Expression environment) {
+    const auto inner_expression = storage.dynamic_expressions.data[expression.index].expression;
+    return evaluate(inner_expression, environment);
+}
+
+Expression evaluateFoldedExpressionTypes(Expression expression, Expression environment) {
+    const auto original = storage.folded_expressions.data[expression.index].original;
+    return evaluate_types(original, environment);
+}
+
+Expression evaluateFoldedExpression(Expression expression, Expression environment) {
+    const auto folded = storage.folded_expressions.data[expression.index].folded;
+    return evaluate(folded, environment);
+}
+
+bool isStreamContainer(Expression expression) {
+    switch (expression.type) {
+        case EVALUATED_STACK: return true;
+        case EVALUATED_RANGE: return true;
+        case EMPTY_STACK: return true;
+        case STRING: return true;
+        case EMPTY_STRING: return true;
+        default: return false;
     }
-    if (left_type == CHARACTER && right_type == CHARACTER) {
-        return getCharacter(left) == getCharacter(right);
+}
+
+struct StreamState {
+    Expression left;
+    Expression right;
+};
+
+// The status of an item of a stream is kept apart from the item,
+// since items can be any expression, including yes and no.
+enum StreamStatus {
+    STREAM_ITEM, // The item is passed on.
+    STREAM_CLEARED, // A stage clears the item.
+    STREAM_END, // The source is empty.
+    STREAM_FAILED, // The original expression is evaluated instead.
+};
+
+StreamStatus nextStreamItem(const Stream& stream, StreamState& state, Expression& item) {
+    const auto left = boolean(state.left);
+    if (left.error.type == ERROR_EXPRESSION) {
+        return STREAM_FAILED;
     }
-    if (left_type == YES && right_type == YES) {
-        return true;
+    if (stream.source == STREAM_CONTAINER) {
+        if (!left.value) {
+            return STREAM_END;
+        }
+        item = container_functions::take(state.left);
+        state.left = container_functions::drop(state.left);
+        return STREAM_ITEM;
     }
-    if (left_type == NO && right_type == NO) {
-        return true;
+    const auto right = boolean(state.right);
+    if (right.error.type == ERROR_EXPRESSION) {
+        return STREAM_FAILED;
     }
-    if (left_type == EMPTY_STACK && right_type == EMPTY_STACK) {
-        return true;
+    if (!left.value || !right.value) {
+        return STREAM_END;
     }
-    if (left_type == EVALUATED_STACK && right_type == EVALUATED_STACK) {
-        return isStackPairwiseEqual(left, right);
+    item = makeEvaluatedTuple2(
+        container_functions::take(state.left), container_functions::take(state.right)
+    );
+    state.left = container_functions::drop(state.left);
+    state.right = container_functions::drop(state.right);
+    return STREAM_ITEM;
+}
+
+StreamStatus applyStreamStages(
+    const Stream& stream, const Expression* stage_functions, Expression& item
+) {
+    for (size_t i = 0; i < stream.stages.count; ++i) {
+        const auto stage = storage.stream_stages.data[stream.stages.data + i];
+        const auto value = applyFunctionValue(stream.original.range, stage_functions[i], item);
+        if (value.type == ERROR_EXPRESSION) {
+            return STREAM_FAILED;
+        }
+        if (stage.type == STREAM_MAP) {
+            item = value;
+            continue;
+        }
+        const auto condition = boolean(value);
+        if (condition.error.type == ERROR_EXPRESSION) {
+            return STREAM_FAILED;
+        }
+        if (condition.value) {
+            return STREAM_CLEARED;
+        }
     }
-    if (left_type == EMPTY_STRING && right_type == EMPTY_STRING) {
-        return true;
+    return STREAM_ITEM;
+}
+
+// Evaluates a stream as one loop, or returns ERROR_EXPRESSION
+// when the original expression should be evaluated instead.
+Expression evaluateStreamLoop(const Stream& stream, Expression environment) {
+    const auto fallback = Expression{0, stream.original.range, ERROR_EXPRESSION};
+    const auto left = evaluate(stream.source_left, environment);
+    const auto right = stream.source == STREAM_ZIP2 ?
+        evaluate(stream.source_right, environment) : Expression{};
+    auto state = StreamState{left, right};
+    if (stream.source == STREAM_CONTAINER && !isStreamContainer(left)) {
+        return fallback;
+    }
+    if (stream.source == STREAM_ZIP2 && (!isStreamContainer(left) || !isStreamContainer(right))) {
+        return fallback;
+    }
+    auto stage_functions = Expressions{};
+    FOR_EACH(i, stream.stages) {
+        APPEND(stage_functions, evaluate(storage.stream_stages.data[i].function, environment));
+    }
+    const auto sink_function = stream.sink_function.type == CHARACTER ?
+        stream.sink_function : evaluate(stream.sink_function, environment);
+    auto result = stream.sink_input.type == CHARACTER ?
+        stream.sink_input : evaluate(stream.sink_input, environment);
+    if (stream.sink == STREAM_COUNT_IF) {
+        result = makeNumber(CodeRange{}, 0);
     }
-    if (left_type == STRING && right_type == STRING) {
-        return isStringPairwiseEqual(left, right);
+    auto items = Expressions{};
+    for (;;) {
+        auto item = Expression{};
+        auto status = nextStreamItem(stream, state, item);
+        if (status == STREAM_ITEM) {
+            status = applyStreamStages(stream, stage_functions.data, item);
+        }
+        if (status == STREAM_END) {
+            break;
+        }
+        if (status == STREAM_FAILED) {
+            result = fallback;
+            break;
+        }
+        if (status == STREAM_CLEARED) {
+            continue;
+        }
+        switch (stream.sink) {
+            case STREAM_COLLECT:
+            case STREAM_COLLECT_REVERSED: {
+                APPEND(items, item);
+                break;
+            }
+            case STREAM_FOLD: {
+                result = applyFunctionValue(
+                    stream.original.range, sink_function, makeEvaluatedTuple2(item, result)
+                );
+                break;
+            }
+            case STREAM_MAP_GENERIC: {
+                const auto value = applyFunctionValue(stream.original.range, sink_function, item);
+                result = container_functions::putBinary(value, result);
+                break;
+            }
+            case STREAM_COUNT_IF: {
+                const auto condition = boolean(
+                    applyFunctionValue(stream.original.range, sink_function, item)
+                );
+                if (condition.error.type == ERROR_EXPRESSION) {
+                    result = condition.error;
+                } else if (condition.value) {
+                    result = makeNumber(CodeRange{}, getNumber(result) + 1);
+                }
+                break;
+            }
+        }
+        if (result.type == ERROR_EXPRESSION) {
+            result = fallback;
+            break;
+        }
     }
-    if (left_type == EVALUATED_TUPLE && right_type == EVALUATED_TUPLE) {
-        return isTuplePairwiseEqual(
-            storage.evaluated_tuples.data[left.index],
-            storage.evaluated_tuples.data[right.index]
-        );
+    if (result.type != ERROR_EXPRESSION && (
+        stream.sink == STREAM_COLLECT || stream.sink == STREAM_COLLECT_REVERSED
+    )) {
+        result = stream.source == STREAM_CONTAINER ?
+            container_functions::clear(left) : Expression{0, CodeRange{}, EMPTY_STACK};
+        for (size_t i = 0; i < items.count && result.type != ERROR_EXPRESSION; ++i) {
+            const auto j = stream.sink == STREAM_COLLECT ? items.count - 1 - i : i;
+            result = container_functions::putBinary(items.data[j], result);
+        }
+        if (result.type == ERROR_EXPRESSION) {
+            result = fallback;
+        }
     }
-    return false;
+    FREE_DARRAY(items);
+    FREE_DARRAY(stage_functions);
+    return result;
 }
 
-Expression evaluateDynamicExpressionTyped(Expression expression) {
-    return Expression{0, expression.range, ANY};
+Expression evaluateStream(Expression expression, Expression environment) {
+    const auto stream = storage.streams.data[expression.index];
+    const auto result = evaluateStreamLoop(stream, environment);
+    if (result.type == ERROR_EXPRESSION) {
+        // The original expression gives the same errors as without streams.
+        return evaluate(stream.original, environment);
+    }
+    return result;
 }
 
-Expression evaluateDynamicExpression(Expression expression, Expression environment) {
-    const auto inner_expression = storage.dynamic_expressions.data[expression.index].expression;
-    return evaluate(inner_expression, environment);
+Expression evaluateLazyExpressionTypes(Expression expression, Expression environment) {
+    const auto lazy_expression = storage.lazy_expressions.data[expression.index].expression;
+    return evaluate_types(lazy_expression, environment);
+}
+
+Expression evaluateLazyExpression(Expression expression, Expression environment) {
+    const auto lazy_expression = storage.lazy_expressions.data[expression.index].expression;
+    return makeThunk(expression.range, Thunk{lazy_expression, environment});
 }
 
 Expression evaluateConditionalTypes(
@@ -685,71 +1114,80 @@ Expression evaluateIs(Expression is, Expression environment) {
     return evaluate(is_struct.expression_else, environment);
 }
 
-template<typename Evaluator>
-Expression evaluateTypedExpression(
-    Evaluator evaluator, Expression expression, Expression environment
-) {
-    auto name = storage.typed_expressions.data[expression.index].type_name;
-    const auto type = lookupDictionary(expression.range, name, environment);
-    const auto value = evaluator(storage.typed_expressions.data[expression.index].value, environment);
-    checkTypes(type, value, "typed expression");
-    return value;
-}
-
-Indices initializeDefinitions(const Dictionary& dictionary) {
-    // TODO: allocate on storage.expressions directly.
-    // Allocation:
-    auto first = storage.definitions.count;
-    auto definitions = Indices{first, dictionary.definition_count};
-    FOR_EACH(i, definitions) {
-        makeDefinition(CodeRange{}, Definition{});
-    }
-    FOR_EACH(i, dictionary.statements) {
-        auto statement = storage.statements.data[i];
-        auto type = statement.type;
-        if (type == DEFINITION) {
-            auto definition = storage.definitions.data[statement.index];
-            definition.expression = Expression{0, statement.range, ANY};
-            auto dictionary_index = definition.name.dictionary_index;
-            storage.definitions.data[first + dictionary_index] = definition;
+// The original expression is evaluated instead when an operand is not a number.
+Expression evaluateNumeric(Expression numeric, Expression environment) {
+    const auto numeric_struct = storage.numerics.data[numeric.index];
+    StackNumber stack[NUMERIC_STACK_SIZE];
+    auto count = size_t{0};
+    FOR_EACH(i, numeric_struct.operations) {
+        const auto operation = storage.numeric_operations.data[i];
+        if (operation.type == NUMERIC_CONSTANT) {
+            stack[count++] = makeStackNumber(operation.operand);
+            continue;
         }
-        else if (type == FOR_STATEMENT) {
-            auto for_statement = storage.for_statements.data[statement.index];
-            auto dictionary_index = for_statement.item_name.dictionary_index;
-            auto definition = Definition{
-                for_statement.item_name, Expression{0, statement.range, ANY}
-            };
-            storage.definitions.data[first + dictionary_index] = definition;
+        if (operation.type == NUMERIC_LOCAL || operation.type == NUMERIC_EXPRESSION) {
+            const auto definitions = storage.evaluated_dictionaries.data[environment.index].definitions;
+            const auto value = operation.type == NUMERIC_LOCAL ?
+                forceDefinition(definitions.data + operation.operand.index) :
+                evaluate(operation.operand, environment);
+            if (!isStackNumber(value)) {
+                return evaluate(numeric_struct.original, environment);
+            }
+            stack[count++] = makeStackNumber(value);
+            continue;
+        }
+        --count;
+        const auto left = stack[count - 1];
+        const auto right = stack[count];
+        switch (operation.type) {
+            case NUMERIC_ADD: stack[count - 1] = addStackNumbers(left, right); break;
+            case NUMERIC_SUB: stack[count - 1] = subStackNumbers(left, right); break;
+            case NUMERIC_MUL: stack[count - 1] = mulStackNumbers(left, right); break;
+            case NUMERIC_DIV: stack[count - 1] = divStackNumbers(left, right); break;
+            case NUMERIC_MOD: stack[count - 1] = modStackNumbers(left, right); break;
+            case NUMERIC_LESS: return lessStackNumbers(left, right);
+            default: break;
         }
     }
-    auto last = storage.definitions.count;
-    return Indices{first, last - first};
+    return makeExpressionFromStack(stack[0]);
 }
 
-void setDictionaryDefinition(
-    Expression evaluated_dictionary, BoundLocalName name, Expression value
-) {
-    CHECK_INTERNAL(
-        evaluated_dictionary.type == EVALUATED_DICTIONARY,
-        "setDictionaryDefinition expected %s got %s",
-        getExpressionName(EVALUATED_DICTIONARY),
-        getExpressionName(evaluated_dictionary.type)
-    );
-    auto first = storage.evaluated_dictionaries.data[evaluated_dictionary.index].definitions.data;
-    storage.definitions.data[first + name.dictionary_index].expression = value;
+Expression evaluateIsTable(Expression is_table, Expression environment) {
+    const auto is_table_struct = storage.is_tables.data[is_table.index];
+    const auto is_struct = storage.is_expressions.data[is_table_struct.is.index];
+    const auto value = evaluate(is_struct.input, environment);
+    const auto& entries = storage.is_table_entries.at(is_table_struct.table);
+    const auto range = entries.equal_range(hashExpression(value));
+    for (auto it = range.first; it != range.second; ++it) {
+        if (isEqual(value, it->second.key)) {
+            const auto alternative = storage.alternatives.data[it->second.alternative];
+            return evaluate(alternative.right, environment);
+        }
+    }
+    return evaluate(is_struct.expression_else, environment);
 }
 
-Expression getDictionaryDefinition(
-    Expression evaluated_dictionary, BoundLocalName name
-) {
-    CHECK_INTERNAL(
-        evaluated_dictionary.type == EVALUATED_DICTIONARY,
-        "getDictionaryDefinition expected %s got %s",
-        getExpressionName(EVALUATED_DICTIONARY),
-        getExpressionName(evaluated_dictionary.type)
-    );
-    auto first = storage.evaluated_dictionaries.data[evaluated_dictionary.index].definitions.data;
-    return storage.definitions.data[first + name.dictionary_index].expression;
+Expression evaluateTypedExpressionTypes(Expression expression, Expression environment) {
+    auto name = storage.typed_expressions.data[expression.index].type_name;
+    const auto type = lookupDictionary(expression.range, name, environment);
+    const auto value = evaluate_types(storage.typed_expressions.data[expression.index].value, environment);
+    const auto type_check = checkTypes(type, value, "typed expression");
+    const auto ok = type_check.ok && type.type != ANY && value.type != ANY;
+    auto& proof = storage.typed_expressions.data[expression.index].proof;
+    proof = mergeTypeProof(proof, ok);
+    return value;
+}
+
+Expression evaluateTypedExpression(Expression expression, Expression environment) {
+    const auto typed_expression = storage.typed_expressions.data[expression.index];
+    const auto value = evaluate(typed_expression.value, environment);
+    // The type pass has already checked this expression everywhere it reached it.
+    if (typed_expression.proof == TYPE_PROVEN) {
+        return value;
+    }
+    const auto type = lookupDictionary(expression.range, typed_expression.type_name, environment);
+    checkTypes(type, value, "typed expression");
+    return value;
 }
 
 Expression evaluateDictionaryTypes(
@@ -782,8 +1220,7 @@ Expression evaluateDictionaryTypes(
             const auto value = evaluate_types(right_expression, result);
             if (value.type == ERROR_EXPRESSION) return value;
             const auto current = getDictionaryDefinition(result, put_assignment.name);
-            const auto tuple = makeEvaluatedTuple2(value, current);
-            const auto new_value = container_functions::putTyped(tuple);
+            const auto new_value = container_functions::putTypedBinary(value, current);
             setDictionaryDefinition(result, put_assignment.name, new_value);
         }
         else if (type == PUT_EACH_ASSIGNMENT) {
@@ -797,8 +1234,7 @@ Expression evaluateDictionaryTypes(
             {
                 const auto current = getDictionaryDefinition(result, put_each_assignment.name);
                 const auto value = container_functions::takeTyped(container);
-                const auto tuple = makeEvaluatedTuple2(value, current);
-                const auto new_value = container_functions::putTyped(tuple);
+                const auto new_value = container_functions::putTypedBinary(value, current);
                 setDictionaryDefinition(result, put_each_assignment.name, new_value);
             }
         }
@@ -833,135 +1269,267 @@ Expression evaluateDictionaryTypes(
     return result;
 }
 
+// Forces the lazy definitions of a dictionary that is evaluated once, level by level,
+// so that the definitions on the same level are evaluated by different workers.
+void forceDefinitionsInParallel(const Dictionary& dictionary, Expression evaluated_dictionary) {
+    const auto first = storage.evaluated_dictionaries.data[evaluated_dictionary.index].definitions.data;
+    auto names = std::vector<BoundLocalName>{};
+    for (size_t level = 0;; ++level) {
+        names.clear();
+        auto is_last_level = true;
+        FOR_EACH(i, dictionary.statements) {
+            const auto statement = storage.statements.data[i];
+            if (statement.type != DEFINITION) {
+                continue;
+            }
+            const auto definition = storage.definitions.data[statement.index];
+            if (definition.expression.type != LAZY_EXPRESSION) {
+                continue;
+            }
+            const auto lazy_level = storage.lazy_expressions.data[definition.expression.index].level;
+            is_last_level = is_last_level && lazy_level <= level;
+            const auto value = getDictionaryDefinition(evaluated_dictionary, definition.name);
+            if (lazy_level == level && value.type == THUNK) {
+                names.push_back(definition.name);
+            }
+        }
+        const auto values = evaluateTasks(names.size(), [&](size_t i) {
+            return forceDefinition(first + names[i].dictionary_index);
+        });
+        for (size_t i = 0; i < names.size(); ++i) {
+            setDictionaryDefinition(evaluated_dictionary, names[i], values[i]);
+        }
+        if (is_last_level) {
+            return;
+        }
+    }
+}
+
+// Computed goto is a GNU extension, so other compilers dispatch with a switch.
+// MANGLANG_SWITCH_DISPATCH makes GNU compilers use the switch too, so that it can be tested.
+#if defined(__GNUC__) && !defined(MANGLANG_SWITCH_DISPATCH)
+#define MANGLANG_COMPUTED_GOTO
+#endif
+
+#ifdef MANGLANG_COMPUTED_GOTO
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpedantic"
+#define INSTRUCTION(type) LABEL_##type
+#define DISPATCH() instruction = storage.instructions.data[first + i]; goto *labels[instruction.type]
+#else
+#define INSTRUCTION(type) case type
+#define DISPATCH() continue
+#endif
+
 Expression evaluateDictionary(Expression dictionary, Expression environment) {
-    const auto initial_definitions = initializeDefinitions(
-        storage.dictionaries.data[dictionary.index]
-    );
+    const auto dictionary_struct = storage.dictionaries.data[dictionary.index];
+    const auto initial_definitions = initializeDefinitions(dictionary_struct);
     const auto result = makeEvaluatedDictionary(
         dictionary.range, EvaluatedDictionary{environment, initial_definitions}
     );
 
-    const auto dict_statements = storage.dictionaries.data[dictionary.index].statements;
-    const auto base_index = dict_statements.data;
-    const auto statement_count = dict_statements.count;
-    
+    const auto first = dictionary_struct.instructions.data;
     auto i = size_t{0};
-    while (i < statement_count) {
-        const auto statement = storage.statements.data[base_index + i];
-        const auto type = statement.type;
-        if (type == DEFINITION) {
-            const auto definition = storage.definitions.data[statement.index];
-            const auto right_expression = definition.expression;
-            const auto value = evaluate(right_expression, result);
-            // Bottleneck:
-            setDictionaryDefinition(result, definition.name, value);
-            i += 1;
-        }
-        else if (type == PUT_ASSIGNMENT) {
-            const auto put_assignment = storage.put_assignments.data[statement.index];
-            const auto right_expression = put_assignment.expression;
-            const auto value = evaluate(right_expression, result);
-            const auto current = getDictionaryDefinition(result, put_assignment.name);
-            const auto tuple = makeEvaluatedTuple2(value, current);
-            const auto new_value = container_functions::put(tuple);
-            setDictionaryDefinition(result, put_assignment.name, new_value);
-            i += 1;
-        }
-        else if (type == PUT_EACH_ASSIGNMENT) {
-            const auto put_each_assignment = storage.put_each_assignments.data[statement.index];
-            const auto right_expression = put_each_assignment.expression;
-            auto container = evaluate(right_expression, result);
-            for (;;) {
-                auto condition = boolean(container);
-                if (condition.error.type == ERROR_EXPRESSION) {
-                    return condition.error;
-                }
-                if (!condition.value) {
-                    break;
-                }
-                const auto current = getDictionaryDefinition(result, put_each_assignment.name);
-                const auto value = container_functions::take(container);
-                const auto tuple = makeEvaluatedTuple2(value, current);
-                const auto new_value = container_functions::put(tuple);
-                setDictionaryDefinition(result, put_each_assignment.name, new_value);
-                container = container_functions::drop(container);
-            }
-            i += 1;
-        }
-        else if (type == DROP_ASSIGNMENT) {
-            const auto drop_assignment = storage.drop_assignments.data[statement.index];
-            const auto current = getDictionaryDefinition(result, drop_assignment.name);
-            const auto new_value = container_functions::drop(current);
-            setDictionaryDefinition(result, drop_assignment.name, new_value);
-            i += 1;
-        }
-        else if (type == WHILE_STATEMENT) {
-            const auto while_statement = storage.while_statements.data[statement.index];
-            auto condition = boolean(evaluate(while_statement.expression, result));
-            if (condition.error.type == ERROR_EXPRESSION) {
-                return condition.error;
-            }
-            if (condition.value) {
-                i += 1;
-            } else {
-                i = while_statement.end_index + 1;
-            }
-        }
-        else if (type == FOR_STATEMENT) {
-            const auto for_statement = storage.for_statements.data[statement.index];
-            const auto container = getDictionaryDefinition(result, for_statement.container_name);
+    auto instruction = Instruction{};
+
+#ifdef MANGLANG_COMPUTED_GOTO
+    // Same order as InstructionType:
+    static void* const labels[] = {
+        &&LABEL_OP_DEFINITION,
+        &&LABEL_OP_PUT,
+        &&LABEL_OP_PUT_EACH,
+        &&LABEL_OP_DROP,
+        &&LABEL_OP_WHILE,
+        &&LABEL_OP_FOR,
+        &&LABEL_OP_FOR_SIMPLE,
+        &&LABEL_OP_WHILE_END,
+        &&LABEL_OP_FOR_END,
+        &&LABEL_OP_RETURN,
+        &&LABEL_OP_DICTIONARY_END,
+        &&LABEL_OP_FOR_DEFINITION,
+        &&LABEL_OP_DEFINITION_WHILE_END,
+        &&LABEL_OP_DEFINITION_FOR_END,
+        &&LABEL_OP_PUT_WHILE_END,
+        &&LABEL_OP_PUT_FOR_END,
+        &&LABEL_OP_DICTIONARY_END_PARALLEL,
+    };
+    DISPATCH();
+#else
+    for (;;) {
+    instruction = storage.instructions.data[first + i];
+    switch (instruction.type) {
+#endif
+
+    INSTRUCTION(OP_DEFINITION): {
+        const auto definition = storage.definitions.data[instruction.index];
+        const auto value = evaluate(definition.expression, result);
+        // Bottleneck:
+        setDictionaryDefinition(result, definition.name, value);
+        i += 1;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_PUT): {
+        const auto put_assignment = storage.put_assignments.data[instruction.index];
+        const auto value = evaluate(put_assignment.expression, result);
+        const auto current = getDictionaryDefinition(result, put_assignment.name);
+        const auto new_value = container_functions::putBinary(value, current);
+        setDictionaryDefinition(result, put_assignment.name, new_value);
+        i += 1;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_PUT_EACH): {
+        const auto put_each_assignment = storage.put_each_assignments.data[instruction.index];
+        auto container = evaluate(put_each_assignment.expression, result);
+        for (;;) {
             auto condition = boolean(container);
             if (condition.error.type == ERROR_EXPRESSION) {
                 return condition.error;
             }
-            if (condition.value) {
-                const auto value = container_functions::take(container);
-                setDictionaryDefinition(result, for_statement.item_name, value);
-                i += 1;
-            } else {
-                i = for_statement.end_index + 1;
+            if (!condition.value) {
+                break;
             }
+            const auto current = getDictionaryDefinition(result, put_each_assignment.name);
+            const auto value = container_functions::take(container);
+            const auto new_value = container_functions::putBinary(value, current);
+            setDictionaryDefinition(result, put_each_assignment.name, new_value);
+            container = container_functions::drop(container);
         }
-        else if (type == FOR_SIMPLE_STATEMENT) {
-            const auto for_statement = storage.for_simple_statements.data[statement.index];
-            const auto condition = boolean(getDictionaryDefinition(result, for_statement.container_name));
-            if (condition.error.type == ERROR_EXPRESSION) {
-                return condition.error;
-            }
-            if (condition.value) {
-                i += 1;
-            } else {
-                i = for_statement.end_index + 1;
-            }
+        i += 1;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_DROP): {
+        const auto drop_assignment = storage.drop_assignments.data[instruction.index];
+        const auto current = getDictionaryDefinition(result, drop_assignment.name);
+        const auto new_value = container_functions::drop(current);
+        setDictionaryDefinition(result, drop_assignment.name, new_value);
+        i += 1;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_WHILE): {
+        const auto while_statement = storage.while_statements.data[instruction.index];
+        auto condition = boolean(evaluate(while_statement.expression, result));
+        if (condition.error.type == ERROR_EXPRESSION) {
+            return condition.error;
         }
-        else if (type == WHILE_END_STATEMENT) {
-            const auto end_statement = storage.while_end_statements.data[statement.index];
-            i = end_statement.start_index;
+        i = condition.value ? i + 1 : instruction.jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_FOR): {
+        const auto for_statement = storage.for_statements.data[instruction.index];
+        const auto container = getDictionaryDefinition(result, for_statement.container_name);
+        auto condition = boolean(container);
+        if (condition.error.type == ERROR_EXPRESSION) {
+            return condition.error;
         }
-        else if (type == FOR_END_STATEMENT) {
-            const auto end_statement = storage.for_end_statements.data[statement.index];
-            i = end_statement.start_index;
-            const auto start_statement = storage.statements.data[base_index + i];
-            const auto name_index = storage.for_statements.data[start_statement.index].container_name;
-            const auto old_container = getDictionaryDefinition(result, name_index);
-            const auto new_container = container_functions::drop(old_container);
-            setDictionaryDefinition(result, name_index, new_container);
+        if (condition.value) {
+            const auto value = container_functions::take(container);
+            setDictionaryDefinition(result, for_statement.item_name, value);
+            i += 1;
+        } else {
+            i = instruction.jump;
         }
-        else if (type == FOR_SIMPLE_END_STATEMENT) {
-            const auto end_statement = storage.for_simple_end_statements.data[statement.index];
-            i = end_statement.start_index;
-            const auto start_statement = storage.statements.data[base_index + i];
-            const auto name_index = storage.for_simple_statements.data[start_statement.index].container_name;
-            const auto old_container = getDictionaryDefinition(result, name_index);
-            const auto new_container = container_functions::drop(old_container);
-            setDictionaryDefinition(result, name_index, new_container);
+        DISPATCH();
+    }
+    INSTRUCTION(OP_FOR_SIMPLE): {
+        const auto for_statement = storage.for_simple_statements.data[instruction.index];
+        const auto condition = boolean(getDictionaryDefinition(result, for_statement.container_name));
+        if (condition.error.type == ERROR_EXPRESSION) {
+            return condition.error;
         }
-        else if (type == RETURN_STATEMENT) {
-            break;
+        i = condition.value ? i + 1 : instruction.jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_WHILE_END): {
+        i = instruction.jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_FOR_END): {
+        const auto container = BoundLocalName{0, instruction.index};
+        const auto old_container = getDictionaryDefinition(result, container);
+        setDictionaryDefinition(result, container, container_functions::drop(old_container));
+        i = instruction.jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_RETURN): {
+        return result;
+    }
+    INSTRUCTION(OP_DICTIONARY_END): {
+        return result;
+    }
+    INSTRUCTION(OP_DICTIONARY_END_PARALLEL): {
+        forceDefinitionsInParallel(dictionary_struct, result);
+        return result;
+    }
+    INSTRUCTION(OP_FOR_DEFINITION): {
+        const auto for_statement = storage.for_statements.data[instruction.index];
+        const auto container = getDictionaryDefinition(result, for_statement.container_name);
+        auto condition = boolean(container);
+        if (condition.error.type == ERROR_EXPRESSION) {
+            return condition.error;
         }
+        if (!condition.value) {
+            i = instruction.jump;
+            DISPATCH();
+        }
+        const auto item = container_functions::take(container);
+        setDictionaryDefinition(result, for_statement.item_name, item);
+        const auto next = storage.instructions.data[first + i + 1];
+        const auto definition = storage.definitions.data[next.index];
+        const auto value = evaluate(definition.expression, result);
+        setDictionaryDefinition(result, definition.name, value);
+        i += 2;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_DEFINITION_WHILE_END): {
+        const auto definition = storage.definitions.data[instruction.index];
+        const auto value = evaluate(definition.expression, result);
+        setDictionaryDefinition(result, definition.name, value);
+        i = storage.instructions.data[first + i + 1].jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_DEFINITION_FOR_END): {
+        const auto definition = storage.definitions.data[instruction.index];
+        const auto value = evaluate(definition.expression, result);
+        setDictionaryDefinition(result, definition.name, value);
+        const auto next = storage.instructions.data[first + i + 1];
+        const auto container = BoundLocalName{0, next.index};
+        const auto old_container = getDictionaryDefinition(result, container);
+        setDictionaryDefinition(result, container, container_functions::drop(old_container));
+        i = next.jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_PUT_WHILE_END): {
+        const auto put_assignment = storage.put_assignments.data[instruction.index];
+        const auto value = evaluate(put_assignment.expression, result);
+        const auto current = getDictionaryDefinition(result, put_assignment.name);
+        setDictionaryDefinition(result, put_assignment.name, container_functions::putBinary(value, current));
+        i = storage.instructions.data[first + i + 1].jump;
+        DISPATCH();
+    }
+    INSTRUCTION(OP_PUT_FOR_END): {
+        const auto put_assignment = storage.put_assignments.data[instruction.index];
+        const auto value = evaluate(put_assignment.expression, result);
+        const auto current = getDictionaryDefinition(result, put_assignment.name);
+        setDictionaryDefinition(result, put_assignment.name, container_functions::putBinary(value, current));
+        const auto next = storage.instructions.data[first + i + 1];
+        const auto container = BoundLocalName{0, next.index};
+        const auto old_container = getDictionaryDefinition(result, container);
+        setDictionaryDefinition(result, container, container_functions::drop(old_container));
+        i = next.jump;
+        DISPATCH();
+    }
+
+#ifdef MANGLANG_COMPUTED_GOTO
+}
+#pragma GCC diagnostic pop
+#else
+    }
     }
-    return result;
 }
+#endif
+
+#undef INSTRUCTION
+#undef DISPATCH
 
 std::string stdStringFromManglang(Expression key) {
     auto buffer = StringBuilder{};
@@ -983,14 +1551,14 @@ Expression applyTableIndexing(Expression table, Expression key) {
 }
 
 Expression applyStackIndexing(Expression stack, Expression input) {
-    if (input.type != NUMBER) {
+    if (!isNumber(input)) {
         return makeErrorExpression(stack.range,
             "\n\nI have found a dynamic type error.\n"
             "It happens when indexing a stack.\n"
             "The index is expected to be a %s,\n"
-            "but now it is a %s.\n",
+            "but now it is %s %s.\n",
             getExpressionName(NUMBER),
-            getExpressionName(input.type)
+            getExpressionArticle(input.type), getExpressionName(input.type)
         );
     }
     const auto number = getNumber(input);
@@ -1019,15 +1587,70 @@ Expression applyStackIndexing(Expression stack, Expression input) {
     return stack_struct.top;
 }
 
+Expression applyRangeIndexing(Expression range, Expression input) {
+    if (!isNumber(input)) {
+        return makeErrorExpression(range.range,
+            "\n\nI have found a dynamic type error.\n"
+            "It happens when indexing a stack.\n"
+            "The index is expected to be a %s,\n"
+            "but now it is %s %s.\n",
+            getExpressionName(NUMBER),
+            getExpressionArticle(input.type), getExpressionName(input.type)
+        );
+    }
+    const auto number = getNumber(input);
+    if (number < 0) {
+        return makeErrorExpression(range.range,
+            "Cannot have negative index: %f", number
+        );
+    }
+    const auto range_struct = storage.evaluated_ranges.data[range.index];
+    const auto value = range_struct.start + (Number)(size_t)number * range_struct.step;
+    const auto is_inside = range_struct.step > 0 ? value < range_struct.stop : value > range_struct.stop;
+    if (!is_inside) {
+        return makeErrorExpression(range.range,
+            "Stack index out of range"
+        );
+    }
+    return makeNumber(CodeRange{}, value);
+}
+
+Expression applyDequeIndexing(Expression deque, Expression input) {
+    if (!isNumber(input)) {
+        return makeErrorExpression(deque.range,
+            "\n\nI have found a dynamic type error.\n"
+            "It happens when indexing a deque.\n"
+            "The index is expected to be a %s,\n"
+            "but now it is %s %s.\n",
+            getExpressionName(NUMBER),
+            getExpressionArticle(input.type), getExpressionName(input.type)
+        );
+    }
+    const auto number = getNumber(input);
+    if (number < 0) {
+        return makeErrorExpression(deque.range,
+            "Cannot have negative index: %f", number
+        );
+    }
+    const auto deque_struct = storage.evaluated_deques.data[deque.index];
+    const auto index = deque_struct.first + (size_t)number;
+    if (index >= deque_struct.last) {
+        return makeErrorExpression(deque.range,
+            "Deque index out of range"
+        );
+    }
+    return storage.deque_buffers.at(deque_struct.buffer).at(index);
+}
+
 Expression applyStringIndexing(Expression string, Expression input) {
-    if (input.type != NUMBER) {
+    if (!isNumber(input)) {
         return makeErrorExpression(string.range,
             "\n\nI have found a dynamic type error.\n"
             "It happens when indexing a string.\n"
             "The index is expected to be a %s,\n"
-            "but now it is a %s.\n",
+            "but now it is %s %s.\n",
             getExpressionName(NUMBER),
-            getExpressionName(input.type)
+            getExpressionArticle(input.type), getExpressionName(input.type)
         );
     }
     const auto number = getNumber(input);
@@ -1069,14 +1692,16 @@ Expression evaluateFunctionApplicationTypes(
     switch (function.type) {
         case ERROR_EXPRESSION: return function;
 
-        case FUNCTION: return applyFunction(evaluate_types, function, input);
-        case FUNCTION_BUILT_IN: return applyFunctionBuiltIn(function, input);
-        case FUNCTION_DICTIONARY: return applyFunctionDictionary(evaluate_types, function, input);
-        case FUNCTION_TUPLE: return applyFunctionTuple(evaluate_types, function, input);
+        case FUNCTION: return applyFunction(evaluate_types, checkArgumentTypes, function, input);
+        case FUNCTION_BUILT_IN: return applyFunctionBuiltInTypes(function_application, function, input);
+        case FUNCTION_DICTIONARY: return applyFunctionDictionary(evaluate_types, checkArgumentTypes, function, input);
+        case FUNCTION_TUPLE: return applyFunctionTuple(evaluate_types, checkArgumentTypes, function, input);
 
         case EVALUATED_TABLE: return applyTableIndexingTypes(function);
         case EVALUATED_TUPLE: return applyTupleIndexing(function, input);
         case EVALUATED_STACK: return applyStackIndexingTypes(function);
+        case EVALUATED_DEQUE: return applyDequeIndexingTypes(function);
+        case EVALUATED_GRID: return applyGridIndexingTypes(function);
         case STRING: return applyStringIndexingTypes(function);
 
         case EMPTY_STACK: return Expression{0, function_application.range, ANY};
@@ -1084,8 +1709,8 @@ Expression evaluateFunctionApplicationTypes(
     
         default: return makeErrorExpression(function_application.range,
             "I found an error during type checking.\n"
-            "The application operator (!) received an %s, which I did not expect.",
-            getExpressionName(function.type)
+            "The application operator (!) received %s %s, which I did not expect.",
+            getExpressionArticle(function.type), getExpressionName(function.type)
         );
     }
 }
@@ -1095,43 +1720,284 @@ Expression evaluateFunctionApplication(
 ) {
     auto name = storage.function_applications.data[function_application.index].name;
     const auto function = lookupDictionary(function_application.range, name, environment);
-    const auto input = evaluate(
-        storage.function_applications.data[function_application.index].child,
-        environment
+    const auto child = storage.function_applications.data[function_application.index].child;
+    if (function.type == FUNCTION_BUILT_IN &&
+        storage.built_in_functions.data[function.index].binary_function &&
+        isTupleLiteralOfTwo(child)
+    ) {
+        return applyFunctionBuiltInBinary(function_application, function, environment);
+    }
+    const auto input = evaluate(child, environment);
+    return applyFunctionValue(function_application.range, function, input);
+}
+
+Expression evaluateFunctionBody(Expression body, Expression environment) {
+    const auto compiled_function = hotFunction(body);
+    if (compiled_function) {
+        return compiled_function(environment);
+    }
+    return evaluate(body, environment);
+}
+
+} // namespace
+
+Expression lookupDictionary(CodeRange range, BoundGlobalName name, Expression expression) {
+    if (expression.type != EVALUATED_DICTIONARY) {
+        auto symbol = storage.names.data + name.global_index;
+        auto expression_name = getExpressionName(expression.type);
+        return makeErrorExpression(range,
+            "Cannot find symbol %s in environment of type %s.", symbol, expression_name);
+    }
+    const auto dictionary = storage.evaluated_dictionaries.data[expression.index];
+    const auto result = optionalLookup(dictionary, name.global_index);
+    if (result.ok) {
+        return result.value;
+    }
+    return lookupDictionary(range, name, dictionary.environment);
+}
+
+BooleanResult boolean(Expression expression) {
+    const auto type = expression.type;
+    const auto index = expression.index;
+    switch (type) {
+    case ERROR_EXPRESSION: return MAKE(BooleanResult, .error=expression);
+    case EVALUATED_TABLE: return MAKE(BooleanResult, .value=!storage.evaluated_tables.at(index).empty());
+    case EVALUATED_TABLE_VIEW: return MAKE(BooleanResult, .value=!storage.evaluated_table_views.data[index].empty());
+    case NUMBER: return MAKE(BooleanResult, .value=static_cast<bool>(getNumber(expression)));
+    case INTEGER: return MAKE(BooleanResult, .value=getInteger(expression) != 0);
+    case YES: return MAKE(BooleanResult, .value=true);
+    case NO: return MAKE(BooleanResult, .value=false);
+    case EVALUATED_STACK: return MAKE(BooleanResult, .value=true);
+    case EVALUATED_RANGE: return MAKE(BooleanResult, .value=true);
+    case EVALUATED_DEQUE: return MAKE(BooleanResult, .value=!isEmptyDeque(expression));
+    case EVALUATED_SET: return MAKE(BooleanResult, .value=!isEmptySet(expression));
+    case EVALUATED_GRID: return MAKE(BooleanResult, .value=!isEmptyGrid(expression));
+    case EMPTY_STACK: return MAKE(BooleanResult, .value=false);
+    case STRING: return MAKE(BooleanResult, .value=true);
+    case EMPTY_STRING: return MAKE(BooleanResult, .value=false);
+    default: return MAKE(BooleanResult, .error=makeErrorExpression(expression.range,
+        "I found an error while trying to evaluate a boolean expression.\n"
+        "I got an unexpected type %s.", getExpressionName(type)));
+    }
+}
+
+Indices initializeDefinitions(const Dictionary& dictionary) {
+    // TODO: allocate on storage.expressions directly.
+    // Allocation:
+    auto first = storage.definitions.count;
+    auto definitions = Indices{first, dictionary.definition_count};
+    FOR_EACH(i, definitions) {
+        makeDefinition(CodeRange{}, Definition{});
+    }
+    FOR_EACH(i, dictionary.statements) {
+        auto statement = storage.statements.data[i];
+        auto type = statement.type;
+        if (type == DEFINITION) {
+            auto definition = storage.definitions.data[statement.index];
+            definition.expression = Expression{0, statement.range, ANY};
+            auto dictionary_index = definition.name.dictionary_index;
+            storage.definitions.data[first + dictionary_index] = definition;
+        }
+        else if (type == FOR_STATEMENT) {
+            auto for_statement = storage.for_statements.data[statement.index];
+            auto dictionary_index = for_statement.item_name.dictionary_index;
+            auto definition = Definition{
+                for_statement.item_name, Expression{0, statement.range, ANY}
+            };
+            storage.definitions.data[first + dictionary_index] = definition;
+        }
+    }
+    auto last = storage.definitions.count;
+    return Indices{first, last - first};
+}
+
+void setDictionaryDefinition(
+    Expression evaluated_dictionary, BoundLocalName name, Expression value
+) {
+    CHECK_INTERNAL(
+        evaluated_dictionary.type == EVALUATED_DICTIONARY,
+        "setDictionaryDefinition expected %s got %s",
+        getExpressionName(EVALUATED_DICTIONARY),
+        getExpressionName(evaluated_dictionary.type)
     );
+    auto first = storage.evaluated_dictionaries.data[evaluated_dictionary.index].definitions.data;
+    storage.definitions.data[first + name.dictionary_index].expression = value;
+}
+
+Expression getDictionaryDefinition(
+    Expression evaluated_dictionary, BoundLocalName name
+) {
+    CHECK_INTERNAL(
+        evaluated_dictionary.type == EVALUATED_DICTIONARY,
+        "getDictionaryDefinition expected %s got %s",
+        getExpressionName(EVALUATED_DICTIONARY),
+        getExpressionName(evaluated_dictionary.type)
+    );
+    auto first = storage.evaluated_dictionaries.data[evaluated_dictionary.index].definitions.data;
+    return storage.definitions.data[first + name.dictionary_index].expression;
+}
+
+Expression lookupChild(CodeRange range, size_t name, Expression child) {
+    if (child.type == ERROR_EXPRESSION) {
+        return child;
+    }
+    if (child.type != EVALUATED_DICTIONARY) {
+        return makeErrorExpression(range,
+            "\n\nI have found an error.\n"
+            "It happens when trying to lookup the child named \"%s\" in a dictionary,\n"
+            "but instead of a dictionary I got a %s.\n",
+            storage.names.data + name,
+            getExpressionName(child.type)
+        );
+    }
+    const auto dictionary = storage.evaluated_dictionaries.data[child.index];
+    return requiredLookup(dictionary, name);
+}
+
+Expression applyFunctionValue(CodeRange range, Expression function, Expression input) {
     switch (function.type) {
         case ERROR_EXPRESSION: return function;
 
-        case FUNCTION: return applyFunction(evaluate, function, input);
+        case FUNCTION: return applyFunction(evaluateFunctionBody, checkArgument, function, input);
         case FUNCTION_BUILT_IN: return applyFunctionBuiltIn(function, input);
-        case FUNCTION_DICTIONARY: return applyFunctionDictionary(evaluate, function, input);
-        case FUNCTION_TUPLE: return applyFunctionTuple(evaluate, function, input);
+        case FUNCTION_DICTIONARY: return applyFunctionDictionary(evaluateFunctionBody, checkArgument, function, input);
+        case FUNCTION_TUPLE: return applyFunctionTuple(evaluateFunctionBody, checkArgument, function, input);
+        case FUNCTION_MEMO: return applyFunctionMemo(function, input);
         
         case EVALUATED_TABLE: return applyTableIndexing(function, input);
         case EVALUATED_TUPLE: return applyTupleIndexing(function, input);
         case EVALUATED_STACK: return applyStackIndexing(function, input);
+        case EVALUATED_RANGE: return applyRangeIndexing(function, input);
+        case EVALUATED_DEQUE: return applyDequeIndexing(function, input);
+        case EVALUATED_GRID: return applyGridIndexing(function, input);
         case STRING: return applyStringIndexing(function, input);
         
-        case EMPTY_STACK: return makeErrorExpression(function_application.range,
+        case EMPTY_STACK: return makeErrorExpression(range,
             "I caught a run-time error when trying to index an empty stack.");
-        case EMPTY_STRING: return makeErrorExpression(function_application.range,
+        case EMPTY_STRING: return makeErrorExpression(range,
             "I caught a run-time error when trying to index an empty string.");
 
-        default: return makeErrorExpression(function_application.range,
+        default: return makeErrorExpression(range,
             "I found an error during evaluation.\n"
-            "The application operator (!) received an %s, which I did not expect.",
-            getExpressionName(function.type)
+            "The application operator (!) received %s %s, which I did not expect.",
+            getExpressionArticle(function.type), getExpressionName(function.type)
         );
     }
 }
 
-} // namespace
+// Used by built-in functions that call functions, to find the type of their result.
+Expression applyFunctionValueTypes(CodeRange range, Expression function, Expression input) {
+    if (input.type == ERROR_EXPRESSION) return input;
+    switch (function.type) {
+        case ERROR_EXPRESSION: return function;
+
+        case FUNCTION: return applyFunction(evaluate_types, checkArgumentTypes, function, input);
+        case FUNCTION_BUILT_IN: return applyFunctionBuiltIn(function, input);
+        case FUNCTION_DICTIONARY: return applyFunctionDictionary(evaluate_types, checkArgumentTypes, function, input);
+        case FUNCTION_TUPLE: return applyFunctionTuple(evaluate_types, checkArgumentTypes, function, input);
+
+        default: return Expression{0, range, ANY};
+    }
+}
+
+Expression forceDefinition(size_t definition) {
+    const auto value = storage.definitions.data[definition].expression;
+    if (value.type != THUNK) {
+        return value;
+    }
+    const auto thunk = storage.thunks.data[value.index];
+    // The name is not defined while its expression is evaluated, like when evaluating eagerly.
+    storage.definitions.data[definition].expression = Expression{0, value.range, ANY};
+    const auto result = evaluate(thunk.expression, thunk.environment);
+    storage.definitions.data[definition].expression = result;
+    return result;
+}
+
+size_t hashExpression(Expression expression) {
+    switch (expression.type) {
+        case NUMBER: return combineHash(NUMBER, hashNumber(getNumber(expression)));
+        // Integers and other numbers that are equal should have the same hash.
+        case INTEGER: return combineHash(NUMBER, hashNumber(getNumber(expression)));
+        case CHARACTER: return combineHash(CHARACTER, (size_t)getCharacter(expression));
+        case STRING: return hashString(expression);
+        case EVALUATED_STACK: return hashEvaluatedStack(expression);
+        case EVALUATED_RANGE: return hashRange(expression);
+        case EVALUATED_TUPLE: return hashEvaluatedTuple(expression);
+        default: return expression.type;
+    }
+}
+
+bool isEqual(Expression left, Expression right) {
+    const auto left_type = left.type;
+    const auto right_type = right.type;
+    if (left_type == INTEGER && right_type == INTEGER) {
+        return getInteger(left) == getInteger(right);
+    }
+    if (isNumber(left) && isNumber(right)) {
+        return getNumber(left) == getNumber(right);
+    }
+    if (left_type == CHARACTER && right_type == CHARACTER) {
+        return getCharacter(left) == getCharacter(right);
+    }
+    if (left_type == YES && right_type == YES) {
+        return true;
+    }
+    if (left_type == NO && right_type == NO) {
+        return true;
+    }
+    if (left_type == EMPTY_STACK && right_type == EMPTY_STACK) {
+        return true;
+    }
+    if (left_type == EVALUATED_STACK && right_type == EVALUATED_STACK) {
+        if (isInterned(left) && isInterned(right)) {
+            return left.index == right.index;
+        }
+        return hashExpression(left) == hashExpression(right) && isStackPairwiseEqual(left, right);
+    }
+    if ((left_type == EVALUATED_RANGE || left_type == EVALUATED_STACK) &&
+        (right_type == EVALUATED_RANGE || right_type == EVALUATED_STACK)
+    ) {
+        return isRangePairwiseEqual(left, right);
+    }
+    if (left_type == EVALUATED_DEQUE && right_type == EVALUATED_DEQUE) {
+        return isDequePairwiseEqual(
+            storage.evaluated_deques.data[left.index],
+            storage.evaluated_deques.data[right.index]
+        );
+    }
+    if (left_type == EVALUATED_SET && right_type == EVALUATED_SET) {
+        return isSetEqual(left, right);
+    }
+    if (left_type == EVALUATED_GRID && right_type == EVALUATED_GRID) {
+        return isGridEqual(left, right);
+    }
+    if (left_type == EMPTY_STRING && right_type == EMPTY_STRING) {
+        return true;
+    }
+    if (left_type == STRING && right_type == STRING) {
+        if (isInterned(left) && isInterned(right)) {
+            return left.index == right.index;
+        }
+        return hashExpression(left) == hashExpression(right) && isStringPairwiseEqual(left, right);
+    }
+    if (left_type == EVALUATED_TUPLE && right_type == EVALUATED_TUPLE) {
+        if (isInterned(left) && isInterned(right)) {
+            return left.index == right.index;
+        }
+        return hashExpression(left) == hashExpression(right) && isTuplePairwiseEqual(
+            storage.evaluated_tuples.data[left.index],
+            storage.evaluated_tuples.data[right.index]
+        );
+    }
+    return false;
+}
 
 Expression evaluate_types(Expression expression, Expression environment) {
     switch (expression.type) {
         // These are the same for types and values, and just pass through:
         case ERROR_EXPRESSION: return expression;
         case NUMBER: return expression;
+        case INTEGER: return expression;
         case CHARACTER: return expression;
         case YES: return expression;
         case NO: return expression;
@@ -1139,6 +2005,10 @@ Expression evaluate_types(Expression expression, Expression environment) {
         case STRING: return expression;
         case EMPTY_STACK: return expression;
         case EVALUATED_STACK: return expression;
+        case EVALUATED_RANGE: return expression;
+        case EVALUATED_DEQUE: return expression;
+        case EVALUATED_SET: return expression;
+        case EVALUATED_GRID: return expression;
         case EVALUATED_DICTIONARY: return expression;
         case EVALUATED_TUPLE: return expression;
         case EVALUATED_TABLE: return expression;
@@ -1155,10 +2025,12 @@ Expression evaluate_types(Expression expression, Expression environment) {
         case TUPLE: return evaluateTuple(evaluate_types, expression, environment);
         case TABLE: return evaluateTable(evaluate_types, serialize_types, expression, environment);
         case LOOKUP_CHILD: return evaluateLookupChild(evaluate_types, expression, environment);
-        case TYPED_EXPRESSION: return evaluateTypedExpression(evaluate_types, expression, environment);
 
         // These are different for types and values:
+        case TYPED_EXPRESSION: return evaluateTypedExpressionTypes(expression, environment);
         case DYNAMIC_EXPRESSION: return evaluateDynamicExpressionTyped(expression);
+        case FOLDED_EXPRESSION: return evaluateFoldedExpressionTypes(expression, environment);
+        case LAZY_EXPRESSION: return evaluateLazyExpressionTypes(expression, environment);
         case CONDITIONAL: return evaluateConditionalTypes(expression, environment);
         case IS: return evaluateIsTypes(expression, environment);
         case DICTIONARY: return evaluateDictionaryTypes(expression, environment);
@@ -1166,8 +2038,8 @@ Expression evaluate_types(Expression expression, Expression environment) {
     
         default: return makeErrorExpression(expression.range,
             "I found an error during type checking.\n"
-            "I received an %s, which I did not expect.",
-            getExpressionName(expression.type)
+            "I received %s %s, which I did not expect.",
+            getExpressionArticle(expression.type), getExpressionName(expression.type)
         );
     }
 }
@@ -1177,6 +2049,7 @@ Expression evaluate(Expression expression, Expression environment) {
         // These are the same for types and values, and just pass through:
         case ERROR_EXPRESSION: return expression;
         case NUMBER: return expression;
+        case INTEGER: return expression;
         case CHARACTER: return expression;
         case YES: return expression;
         case NO: return expression;
@@ -1184,6 +2057,10 @@ Expression evaluate(Expression expression, Expression environment) {
         case STRING: return expression;
         case EMPTY_STACK: return expression;
         case EVALUATED_STACK: return expression;
+        case EVALUATED_RANGE: return expression;
+        case EVALUATED_DEQUE: return expression;
+        case EVALUATED_SET: return expression;
+        case EVALUATED_GRID: return expression;
         case EVALUATED_DICTIONARY: return expression;
         case EVALUATED_TUPLE: return expression;
         case EVALUATED_TABLE: return expression;
@@ -1200,19 +2077,24 @@ Expression evaluate(Expression expression, Expression environment) {
         case TUPLE: return evaluateTuple(evaluate, expression, environment);
         case TABLE: return evaluateTable(evaluate, serialize, expression, environment);
         case LOOKUP_CHILD: return evaluateLookupChild(evaluate, expression, environment);
-        case TYPED_EXPRESSION: return evaluateTypedExpression(evaluate, expression, environment);
 
         // These are different for types and values:
+        case TYPED_EXPRESSION: return evaluateTypedExpression(expression, environment);
         case DYNAMIC_EXPRESSION: return evaluateDynamicExpression(expression, environment);
+        case FOLDED_EXPRESSION: return evaluateFoldedExpression(expression, environment);
+        case LAZY_EXPRESSION: return evaluateLazyExpression(expression, environment);
+        case STREAM: return evaluateStream(expression, environment);
         case CONDITIONAL: return evaluateConditional(expression, environment);
         case IS: return evaluateIs(expression, environment);
+        case IS_TABLE: return evaluateIsTable(expression, environment);
+        case NUMERIC: return evaluateNumeric(expression, environment);
         case DICTIONARY: return evaluateDictionary(expression, environment);
         case FUNCTION_APPLICATION: return evaluateFunctionApplication(expression, environment);
     
         default: return makeErrorExpression(expression.range,
             "I found an error during evaluation.\n"
-            "I received an %s, which I did not expect.",
-            getExpressionName(expression.type)
+            "I received %s %s, which I did not expect.",
+            getExpressionArticle(expression.type), getExpressionName(expression.type)
         );
     }
 }
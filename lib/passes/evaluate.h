@@ -1,6 +1,29 @@
 #pragma once
 
-struct Expression;
+#include <stddef.h>
+
+#include "../expression.h"
+
+struct BooleanResult {
+    bool value;
+    Expression error;
+};
 
 Expression evaluate_types(Expression expression, Expression environment);
 Expression evaluate(Expression expression, Expression environment);
+bool isEqual(Expression left, Expression right);
+// Expressions that are equal according to isEqual have the same hash.
+// The hashes of strings, stacks and tuples are cached when first computed.
+size_t hashExpression(Expression expression);
+Expression forceDefinition(size_t definition);
+
+// These evaluate parts of expressions.
+// They are also used by programs that are transpiled to C++.
+Expression lookupDictionary(CodeRange range, BoundGlobalName name, Expression expression);
+Expression lookupChild(CodeRange range, size_t name, Expression child);
+Expression applyFunctionValue(CodeRange range, Expression function, Expression input);
+Expression applyFunctionValueTypes(CodeRange range, Expression function, Expression input);
+BooleanResult boolean(Expression expression);
+Indices initializeDefinitions(const Dictionary& dictionary);
+void setDictionaryDefinition(Expression evaluated_dictionary, BoundLocalName name, Expression value);
+Expression getDictionaryDefinition(Expression evaluated_dictionary, BoundLocalName name);
@@ -0,0 +1,621 @@
+#include "fold.h"
+
+#include <string.h>
+
+#include <carma/carma.h>
+
+#include "../built_in_functions/arithmetic.h"
+#include "../factory.h"
+#include "evaluate.h"
+#include "scope.h"
+
+// This pass runs after type checking and before evaluation.
+// It replaces expressions whose values are known before evaluation,
+// like built-in functions called with literals, and names of constants.
+// Compositions of functions like map and fold from the standard library
+// are replaced with streams, that are evaluated as one loop.
+// The replaced expressions are kept for serialization,
+// so that the output of a program does not change.
+
+namespace {
+
+struct Constant {
+    size_t scope; // Index to the dictionary that defines the constant.
+    size_t name;
+    Expression value;
+};
+
+struct Folder {
+    Expression environment; // Evaluated dictionary around the folded expression.
+    DARRAY(Expression) scopes; // Dictionaries and functions that bind names.
+    DARRAY(Constant) constants; // Constants that are defined so far in the scopes.
+};
+
+Expression foldExpression(Folder& folder, Expression expression);
+
+Expression unfold(Expression expression) {
+    if (expression.type == FOLDED_EXPRESSION) {
+        return storage.folded_expressions.data[expression.index].folded;
+    }
+    return expression;
+}
+
+bool isConstant(Expression expression) {
+    switch (unfold(expression).type) {
+        case NUMBER: return true;
+        case INTEGER: return true;
+        case CHARACTER: return true;
+        case YES: return true;
+        case NO: return true;
+        case EMPTY_STACK: return true;
+        case EMPTY_STRING: return true;
+        case STRING: return true;
+        default: return false;
+    }
+}
+
+bool isConstantInput(Expression expression) {
+    if (expression.type != TUPLE) {
+        return isConstant(expression);
+    }
+    FOR_EACH(i, storage.tuples.data[expression.index].indices) {
+        if (!isConstant(storage.expressions.data[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Returns YES or NO for conditions that are known before evaluation, and ANY otherwise.
+ExpressionType constantCondition(Expression expression) {
+    const auto value = unfold(expression);
+    switch (value.type) {
+        case NUMBER: return getNumber(value) ? YES : NO;
+        case INTEGER: return getInteger(value) ? YES : NO;
+        case YES: return YES;
+        case NO: return NO;
+        case EMPTY_STACK: return NO;
+        case EMPTY_STRING: return NO;
+        case STRING: return YES;
+        default: return ANY;
+    }
+}
+
+Expression makeFolded(Expression original, Expression folded) {
+    return makeFoldedExpression(original.range, FoldedExpression{original, unfold(folded)});
+}
+
+Expression lookupEnvironment(Expression environment, size_t name) {
+    while (environment.type == EVALUATED_DICTIONARY) {
+        const auto dictionary = storage.evaluated_dictionaries.data[environment.index];
+        auto result = Expression{};
+        auto ok = false;
+        FOR_EACH(i, dictionary.definitions) {
+            if (storage.definitions.data[i].name.global_index == name) {
+                result = storage.definitions.data[i].expression;
+                ok = true;
+            }
+        }
+        if (ok) {
+            return result;
+        }
+        environment = dictionary.environment;
+    }
+    return Expression{};
+}
+
+// Returns the value that a name has whenever it is evaluated, or ANY if it is not known.
+Expression lookupName(const Folder& folder, size_t name) {
+    for (auto scope = folder.scopes.count; scope-- > 0;) {
+        if (!isBinding(folder.scopes.data[scope], name)) {
+            continue;
+        }
+        for (size_t i = 0; i < folder.constants.count; ++i) {
+            const auto constant = folder.constants.data[i];
+            if (constant.scope == scope && constant.name == name) {
+                return constant.value;
+            }
+        }
+        return Expression{};
+    }
+    return lookupEnvironment(folder.environment, name);
+}
+
+Expression foldLookupSymbol(Folder& folder, Expression lookup_symbol) {
+    const auto name = storage.symbol_lookups.data[lookup_symbol.index].name;
+    const auto value = lookupName(folder, name.global_index);
+    if (isConstant(value)) {
+        return makeFolded(lookup_symbol, value);
+    }
+    return lookup_symbol;
+}
+
+// Only functions of the standard library are fused to streams,
+// and not other functions with the same names.
+bool isStandardFunction(Expression function, size_t name, const char* standard_name) {
+    return (function.type == FUNCTION || function.type == FUNCTION_TUPLE) &&
+        strcmp(storage.names.data + name, standard_name) == 0;
+}
+
+Expression tupleItem(Expression tuple, size_t count, size_t i) {
+    if (tuple.type != TUPLE) {
+        return Expression{0, tuple.range, ANY};
+    }
+    const auto indices = storage.tuples.data[tuple.index].indices;
+    if (indices.count != count) {
+        return Expression{0, tuple.range, ANY};
+    }
+    return storage.expressions.data[indices.data + i];
+}
+
+bool isCollectedStream(Expression expression) {
+    if (expression.type != FOLDED_EXPRESSION) {
+        return false;
+    }
+    const auto folded = storage.folded_expressions.data[expression.index].folded;
+    return folded.type == STREAM && storage.streams.data[folded.index].sink == STREAM_COLLECT;
+}
+
+// Continues a stream that is collected to a container, instead of iterating the container.
+Stream inputStream(Expression original, Expression input) {
+    if (!isCollectedStream(input)) {
+        return Stream{original, STREAM_CONTAINER, input, Expression{}, Indices{}, STREAM_COLLECT};
+    }
+    const auto folded = storage.folded_expressions.data[input.index].folded;
+    auto stream = storage.streams.data[folded.index];
+    stream.original = original;
+    // Copies the stages, so that more stages can be added after them.
+    const auto first = storage.stream_stages.count;
+    FOR_EACH(i, stream.stages) {
+        APPEND(storage.stream_stages, storage.stream_stages.data[i]);
+    }
+    stream.stages = Indices{first, stream.stages.count};
+    return stream;
+}
+
+Stream addStage(Stream stream, StreamStageType type, Expression function) {
+    if (stream.stages.count == 0) {
+        stream.stages.data = storage.stream_stages.count;
+    }
+    APPEND(storage.stream_stages, (StreamStage{type, function}));
+    ++stream.stages.count;
+    return stream;
+}
+
+// Returns a stream for compositions of functions that iterate containers, or ANY.
+Expression foldStream(Expression function_application, Expression function) {
+    const auto application = storage.function_applications.data[function_application.index];
+    const auto name = application.name.global_index;
+    const auto child = application.child;
+    const auto range = function_application.range;
+    const auto any = Expression{0, range, ANY};
+    if (isStandardFunction(function, name, "zip2")) {
+        const auto left = tupleItem(child, 2, 0);
+        const auto right = tupleItem(child, 2, 1);
+        if (left.type == ANY) {
+            return any;
+        }
+        const auto stream = Stream{
+            function_application, STREAM_ZIP2, left, right, Indices{}, STREAM_COLLECT
+        };
+        return makeStream(range, stream);
+    }
+    if (isStandardFunction(function, name, "map")) {
+        const auto f = tupleItem(child, 2, 0);
+        if (f.type == ANY) {
+            return any;
+        }
+        const auto input = inputStream(function_application, tupleItem(child, 2, 1));
+        return makeStream(range, addStage(input, STREAM_MAP, f));
+    }
+    if (isStandardFunction(function, name, "clear_if")) {
+        const auto predicate = tupleItem(child, 2, 0);
+        if (predicate.type == ANY) {
+            return any;
+        }
+        const auto input = inputStream(function_application, tupleItem(child, 2, 1));
+        return makeStream(range, addStage(input, STREAM_CLEAR_IF, predicate));
+    }
+    if (isStandardFunction(function, name, "reverse")) {
+        if (!isCollectedStream(child)) {
+            return any;
+        }
+        auto stream = inputStream(function_application, child);
+        stream.sink = STREAM_COLLECT_REVERSED;
+        return makeStream(range, stream);
+    }
+    if (isStandardFunction(function, name, "fold")) {
+        const auto operation = tupleItem(child, 3, 0);
+        if (operation.type == ANY) {
+            return any;
+        }
+        auto stream = inputStream(function_application, tupleItem(child, 3, 1));
+        stream.sink = STREAM_FOLD;
+        stream.sink_function = operation;
+        stream.sink_input = tupleItem(child, 3, 2);
+        return makeStream(range, stream);
+    }
+    if (isStandardFunction(function, name, "map_generic")) {
+        const auto f = tupleItem(child, 3, 0);
+        if (f.type == ANY) {
+            return any;
+        }
+        auto stream = inputStream(function_application, tupleItem(child, 3, 1));
+        stream.sink = STREAM_MAP_GENERIC;
+        stream.sink_function = f;
+        stream.sink_input = tupleItem(child, 3, 2);
+        return makeStream(range, stream);
+    }
+    if (isStandardFunction(function, name, "count_if")) {
+        const auto predicate = tupleItem(child, 2, 0);
+        if (predicate.type == ANY) {
+            return any;
+        }
+        auto stream = inputStream(function_application, tupleItem(child, 2, 1));
+        stream.sink = STREAM_COUNT_IF;
+        stream.sink_function = predicate;
+        return makeStream(range, stream);
+    }
+    return any;
+}
+
+// Returns the operation of a call of add, sub, mul, div, mod or less,
+// that type checking has proven is made with numbers, or NUMERIC_EXPRESSION otherwise.
+NumericOperationType numericOperationType(const Folder& folder, Expression function_application) {
+    if (function_application.type == FOLDED_EXPRESSION &&
+        unfold(function_application).type == NUMERIC
+    ) {
+        function_application = storage.folded_expressions.data[function_application.index].original;
+    }
+    if (function_application.type != FUNCTION_APPLICATION) {
+        return NUMERIC_EXPRESSION;
+    }
+    const auto application = storage.function_applications.data[function_application.index];
+    if (application.proof != TYPE_PROVEN ||
+        application.child.type != TUPLE ||
+        storage.tuples.data[application.child.index].indices.count != 2
+    ) {
+        return NUMERIC_EXPRESSION;
+    }
+    const auto function = lookupName(folder, application.name.global_index);
+    if (function.type != FUNCTION_BUILT_IN) {
+        return NUMERIC_EXPRESSION;
+    }
+    const auto pointer = storage.built_in_functions.data[function.index].function;
+    if (pointer != application.proven_function) return NUMERIC_EXPRESSION;
+    if (pointer == arithmetic::add) return NUMERIC_ADD;
+    if (pointer == arithmetic::sub) return NUMERIC_SUB;
+    if (pointer == arithmetic::mul) return NUMERIC_MUL;
+    if (pointer == arithmetic::div) return NUMERIC_DIV;
+    if (pointer == arithmetic::mod) return NUMERIC_MOD;
+    if (pointer == arithmetic::less) return NUMERIC_LESS;
+    return NUMERIC_EXPRESSION;
+}
+
+// Names of the innermost dictionary or function are read directly from its evaluated dictionary.
+NumericOperation numericOperand(const Folder& folder, Expression expression) {
+    const auto value = unfold(expression);
+    if (isNumber(value)) {
+        return NumericOperation{NUMERIC_CONSTANT, value};
+    }
+    if (expression.type == LOOKUP_SYMBOL && !IS_EMPTY(folder.scopes)) {
+        const auto name = storage.symbol_lookups.data[expression.index].name.global_index;
+        const auto slot = findSlot(LAST_ITEM(folder.scopes), name);
+        if (slot != NO_SLOT) {
+            return NumericOperation{NUMERIC_LOCAL, Expression{slot, expression.range, LOOKUP_SYMBOL}};
+        }
+    }
+    return NumericOperation{NUMERIC_EXPRESSION, expression};
+}
+
+bool addNumericOperands(const Folder& folder, Expression function_application, size_t depth);
+
+// Appends the operations that push the number of the expression,
+// on top of a stack that already holds depth numbers.
+bool addNumericOperations(const Folder& folder, Expression expression, size_t depth) {
+    if (depth == NUMERIC_STACK_SIZE) {
+        return false;
+    }
+    const auto type = numericOperationType(folder, expression);
+    if (type == NUMERIC_EXPRESSION || type == NUMERIC_LESS) {
+        APPEND(storage.numeric_operations, numericOperand(folder, expression));
+        return true;
+    }
+    if (expression.type == FOLDED_EXPRESSION) {
+        expression = storage.folded_expressions.data[expression.index].original;
+    }
+    if (!addNumericOperands(folder, expression, depth)) {
+        return false;
+    }
+    APPEND(storage.numeric_operations, (NumericOperation{type, Expression{}}));
+    return true;
+}
+
+bool addNumericOperands(const Folder& folder, Expression function_application, size_t depth) {
+    const auto child = storage.function_applications.data[function_application.index].child;
+    const auto first = storage.tuples.data[child.index].indices.data;
+    return addNumericOperations(folder, storage.expressions.data[first + 0], depth) &&
+        addNumericOperations(folder, storage.expressions.data[first + 1], depth + 1);
+}
+
+// Nested arithmetic is compiled to one sequence of operations.
+Expression makeNumericFromApplication(const Folder& folder, Expression function_application) {
+    const auto type = numericOperationType(folder, function_application);
+    if (type == NUMERIC_EXPRESSION) {
+        return function_application;
+    }
+    const auto first = storage.numeric_operations.count;
+    if (!addNumericOperands(folder, function_application, 0)) {
+        storage.numeric_operations.count = first;
+        return function_application;
+    }
+    APPEND(storage.numeric_operations, (NumericOperation{type, Expression{}}));
+    const auto operations = Indices{first, storage.numeric_operations.count - first};
+    const auto numeric = makeNumeric(
+        function_application.range, Numeric{function_application, operations}
+    );
+    return makeFolded(function_application, numeric);
+}
+
+Expression foldFunctionApplication(Folder& folder, Expression function_application) {
+    const auto child = foldExpression(
+        folder, storage.function_applications.data[function_application.index].child
+    );
+    storage.function_applications.data[function_application.index].child = child;
+    const auto name = storage.function_applications.data[function_application.index].name;
+    // Built-in functions are pure, so they give the same value each time
+    // they are called with the same constant input.
+    const auto function = lookupName(folder, name.global_index);
+    const auto stream = foldStream(function_application, function);
+    if (stream.type == STREAM) {
+        return makeFolded(function_application, stream);
+    }
+    if (function.type != FUNCTION_BUILT_IN || !isConstantInput(child)) {
+        return makeNumericFromApplication(folder, function_application);
+    }
+    const auto value = evaluate(function_application, folder.environment);
+    if (isConstant(value)) {
+        return makeFolded(function_application, value);
+    }
+    return makeNumericFromApplication(folder, function_application);
+}
+
+Expression foldConditional(Folder& folder, Expression conditional) {
+    const auto alternatives = storage.conditionals.data[conditional.index].alternatives;
+    FOR_EACH(a, alternatives) {
+        const auto left = foldExpression(folder, storage.alternatives.data[a].left);
+        storage.alternatives.data[a].left = left;
+        const auto right = foldExpression(folder, storage.alternatives.data[a].right);
+        storage.alternatives.data[a].right = right;
+    }
+    const auto expression_else = foldExpression(
+        folder, storage.conditionals.data[conditional.index].expression_else
+    );
+    storage.conditionals.data[conditional.index].expression_else = expression_else;
+    FOR_EACH(a, alternatives) {
+        const auto alternative = storage.alternatives.data[a];
+        const auto condition = constantCondition(alternative.left);
+        if (condition == ANY) {
+            return conditional;
+        }
+        if (condition == YES) {
+            return makeFolded(conditional, alternative.right);
+        }
+    }
+    return makeFolded(conditional, expression_else);
+}
+
+// Looks up the alternative by the hash of the input,
+// when there are several alternatives and all of them are constant.
+// Alternatives that are equal to an earlier one can never match and are left out.
+Expression makeIsTableFromAlternatives(Expression is) {
+    const auto alternatives = storage.is_expressions.data[is.index].alternative;
+    if (alternatives.count < 2) {
+        return is;
+    }
+    auto entries = std::unordered_multimap<size_t, IsTableEntry>{};
+    FOR_EACH(a, alternatives) {
+        const auto left = storage.alternatives.data[a].left;
+        if (!isConstant(left)) {
+            return is;
+        }
+        const auto key = unfold(left);
+        const auto hash = hashExpression(key);
+        const auto range = entries.equal_range(hash);
+        auto is_new = true;
+        for (auto it = range.first; it != range.second; ++it) {
+            if (isEqual(it->second.key, key)) {
+                is_new = false;
+            }
+        }
+        if (is_new) {
+            entries.emplace(hash, IsTableEntry{key, a});
+        }
+    }
+    storage.is_table_entries.push_back(std::move(entries));
+    const auto table = makeIsTable(is.range, IsTable{is, storage.is_table_entries.size() - 1});
+    return makeFolded(is, table);
+}
+
+Expression foldIs(Folder& folder, Expression is) {
+    const auto input = foldExpression(folder, storage.is_expressions.data[is.index].input);
+    storage.is_expressions.data[is.index].input = input;
+    const auto alternatives = storage.is_expressions.data[is.index].alternative;
+    FOR_EACH(a, alternatives) {
+        const auto left = foldExpression(folder, storage.alternatives.data[a].left);
+        storage.alternatives.data[a].left = left;
+        const auto right = foldExpression(folder, storage.alternatives.data[a].right);
+        storage.alternatives.data[a].right = right;
+    }
+    const auto expression_else = foldExpression(
+        folder, storage.is_expressions.data[is.index].expression_else
+    );
+    storage.is_expressions.data[is.index].expression_else = expression_else;
+    if (!isConstant(input)) {
+        return makeIsTableFromAlternatives(is);
+    }
+    FOR_EACH(a, alternatives) {
+        const auto alternative = storage.alternatives.data[a];
+        if (!isConstant(alternative.left)) {
+            return is;
+        }
+        if (isEqual(unfold(input), unfold(alternative.left))) {
+            return makeFolded(is, alternative.right);
+        }
+    }
+    return makeFolded(is, expression_else);
+}
+
+Expression foldDictionary(Folder& folder, Expression dictionary) {
+    const auto statements = storage.dictionaries.data[dictionary.index].statements;
+    const auto scope = folder.scopes.count;
+    const auto constant_count = folder.constants.count;
+    APPEND(folder.scopes, dictionary);
+    // A definition outside of loops is evaluated once before the statements after it.
+    // If nothing else assigns the name, then it is constant for those statements.
+    auto loop_depth = 0;
+    FOR_EACH(i, statements) {
+        const auto statement = storage.statements.data[i];
+        switch (statement.type) {
+            case DEFINITION: {
+                const auto expression = foldExpression(
+                    folder, storage.definitions.data[statement.index].expression
+                );
+                storage.definitions.data[statement.index].expression = expression;
+                const auto name = storage.definitions.data[statement.index].name.global_index;
+                if (loop_depth == 0 && isConstant(expression) &&
+                    countAssignments(statements, name) == 1
+                ) {
+                    APPEND(folder.constants, (Constant{scope, name, unfold(expression)}));
+                }
+                break;
+            }
+            case PUT_ASSIGNMENT: {
+                const auto expression = foldExpression(
+                    folder, storage.put_assignments.data[statement.index].expression
+                );
+                storage.put_assignments.data[statement.index].expression = expression;
+                break;
+            }
+            case PUT_EACH_ASSIGNMENT: {
+                const auto expression = foldExpression(
+                    folder, storage.put_each_assignments.data[statement.index].expression
+                );
+                storage.put_each_assignments.data[statement.index].expression = expression;
+                break;
+            }
+            case WHILE_STATEMENT: {
+                const auto expression = foldExpression(
+                    folder, storage.while_statements.data[statement.index].expression
+                );
+                storage.while_statements.data[statement.index].expression = expression;
+                ++loop_depth;
+                break;
+            }
+            case FOR_STATEMENT: ++loop_depth; break;
+            case FOR_SIMPLE_STATEMENT: ++loop_depth; break;
+            case WHILE_END_STATEMENT: --loop_depth; break;
+            case FOR_END_STATEMENT: --loop_depth; break;
+            case FOR_SIMPLE_END_STATEMENT: --loop_depth; break;
+            default: break;
+        }
+    }
+    folder.constants.count = constant_count;
+    folder.scopes.count = scope;
+    return dictionary;
+}
+
+Expression foldFunction(Folder& folder, Expression function) {
+    APPEND(folder.scopes, function);
+    const auto body = foldExpression(folder, storage.functions.data[function.index].body);
+    storage.functions.data[function.index].body = body;
+    --folder.scopes.count;
+    return function;
+}
+
+Expression foldFunctionTuple(Folder& folder, Expression function) {
+    APPEND(folder.scopes, function);
+    const auto body = foldExpression(folder, storage.tuple_functions.data[function.index].body);
+    storage.tuple_functions.data[function.index].body = body;
+    --folder.scopes.count;
+    return function;
+}
+
+Expression foldTuple(Folder& folder, Expression tuple) {
+    FOR_EACH(i, storage.tuples.data[tuple.index].indices) {
+        const auto expression = foldExpression(folder, storage.expressions.data[i]);
+        storage.expressions.data[i] = expression;
+    }
+    return tuple;
+}
+
+Expression foldStack(Folder& folder, Expression stack) {
+    for (auto item = stack; item.type == STACK; item = storage.stacks.data[item.index].rest) {
+        const auto top = foldExpression(folder, storage.stacks.data[item.index].top);
+        storage.stacks.data[item.index].top = top;
+    }
+    return stack;
+}
+
+Expression foldTable(Folder& folder, Expression table) {
+    FOR_EACH(i, storage.tables.data[table.index].rows) {
+        const auto key = foldExpression(folder, storage.rows.data[i].key);
+        storage.rows.data[i].key = key;
+        const auto value = foldExpression(folder, storage.rows.data[i].value);
+        storage.rows.data[i].value = value;
+    }
+    return table;
+}
+
+Expression foldLookupChild(Folder& folder, Expression lookup_child) {
+    const auto child = foldExpression(folder, storage.child_lookups.data[lookup_child.index].child);
+    storage.child_lookups.data[lookup_child.index].child = child;
+    return lookup_child;
+}
+
+Expression foldTypedExpression(Folder& folder, Expression typed_expression) {
+    const auto value = foldExpression(folder, storage.typed_expressions.data[typed_expression.index].value);
+    storage.typed_expressions.data[typed_expression.index].value = value;
+    return typed_expression;
+}
+
+Expression foldDynamicExpression(Folder& folder, Expression dynamic_expression) {
+    const auto expression = foldExpression(
+        folder, storage.dynamic_expressions.data[dynamic_expression.index].expression
+    );
+    storage.dynamic_expressions.data[dynamic_expression.index].expression = expression;
+    return dynamic_expression;
+}
+
+Expression foldExpression(Folder& folder, Expression expression) {
+    switch (expression.type) {
+        case LOOKUP_SYMBOL: return foldLookupSymbol(folder, expression);
+        case FUNCTION_APPLICATION: return foldFunctionApplication(folder, expression);
+        case CONDITIONAL: return foldConditional(folder, expression);
+        case IS: return foldIs(folder, expression);
+        case DICTIONARY: return foldDictionary(folder, expression);
+        case FUNCTION: return foldFunction(folder, expression);
+        case FUNCTION_TUPLE: return foldFunctionTuple(folder, expression);
+        case TUPLE: return foldTuple(folder, expression);
+        case STACK: return foldStack(folder, expression);
+        case TABLE: return foldTable(folder, expression);
+        case LOOKUP_CHILD: return foldLookupChild(folder, expression);
+        case TYPED_EXPRESSION: return foldTypedExpression(folder, expression);
+        case DYNAMIC_EXPRESSION: return foldDynamicExpression(folder, expression);
+        // The body of a dictionary function looks up names in its input,
+        // so they are not known before evaluation.
+        case FUNCTION_DICTIONARY: return expression;
+        default: return expression;
+    }
+}
+
+} // namespace
+
+Expression fold(Expression expression, Expression environment) {
+    auto folder = Folder{};
+    folder.environment = environment;
+    const auto result = foldExpression(folder, expression);
+    FREE_DARRAY(folder.scopes);
+    FREE_DARRAY(folder.constants);
+    return result;
+}
@@ -0,0 +1,5 @@
+#pragma once
+
+struct Expression;
+
+Expression fold(Expression expression, Expression environment);
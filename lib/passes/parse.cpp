@@ -11,6 +11,7 @@
 #include "../built_in_functions/container.h"
 #include "../parsing.h"
 #include "../mang_lang_string.h"
+#include "../numeric.h"
 
 namespace {
 
@@ -393,6 +394,72 @@ struct DynamicIndices {
     size_t capacity;
 };
 
+Instruction decodeStatement(Indices statements, size_t i) {
+    const auto statement = storage.statements.data[statements.data + i];
+    switch (statement.type) {
+        case DEFINITION: return Instruction{OP_DEFINITION, statement.index, 0};
+        case PUT_ASSIGNMENT: return Instruction{OP_PUT, statement.index, 0};
+        case PUT_EACH_ASSIGNMENT: return Instruction{OP_PUT_EACH, statement.index, 0};
+        case DROP_ASSIGNMENT: return Instruction{OP_DROP, statement.index, 0};
+        case WHILE_STATEMENT: {
+            const auto end_index = storage.while_statements.data[statement.index].end_index;
+            return Instruction{OP_WHILE, statement.index, end_index + 1};
+        }
+        case FOR_STATEMENT: {
+            const auto end_index = storage.for_statements.data[statement.index].end_index;
+            return Instruction{OP_FOR, statement.index, end_index + 1};
+        }
+        case FOR_SIMPLE_STATEMENT: {
+            const auto end_index = storage.for_simple_statements.data[statement.index].end_index;
+            return Instruction{OP_FOR_SIMPLE, statement.index, end_index + 1};
+        }
+        case WHILE_END_STATEMENT: {
+            const auto start_index = storage.while_end_statements.data[statement.index].start_index;
+            return Instruction{OP_WHILE_END, 0, start_index};
+        }
+        case FOR_END_STATEMENT: {
+            const auto start_index = storage.for_end_statements.data[statement.index].start_index;
+            const auto start = storage.statements.data[statements.data + start_index];
+            const auto container = storage.for_statements.data[start.index].container_name;
+            return Instruction{OP_FOR_END, container.dictionary_index, start_index};
+        }
+        case FOR_SIMPLE_END_STATEMENT: {
+            const auto start_index = storage.for_simple_end_statements.data[statement.index].start_index;
+            const auto start = storage.statements.data[statements.data + start_index];
+            const auto container = storage.for_simple_statements.data[start.index].container_name;
+            return Instruction{OP_FOR_END, container.dictionary_index, start_index};
+        }
+        case RETURN_STATEMENT: return Instruction{OP_RETURN, 0, 0};
+        default: return Instruction{OP_DICTIONARY_END, 0, 0};
+    }
+}
+
+// The second statement of a superinstruction is only reached from the first one,
+// so the superinstruction can evaluate both and continue after them.
+InstructionType superinstruction(InstructionType first, InstructionType second) {
+    if (first == OP_FOR && second == OP_DEFINITION) return OP_FOR_DEFINITION;
+    if (first == OP_DEFINITION && second == OP_WHILE_END) return OP_DEFINITION_WHILE_END;
+    if (first == OP_DEFINITION && second == OP_FOR_END) return OP_DEFINITION_FOR_END;
+    if (first == OP_PUT && second == OP_WHILE_END) return OP_PUT_WHILE_END;
+    if (first == OP_PUT && second == OP_FOR_END) return OP_PUT_FOR_END;
+    return first;
+}
+
+Indices decodeInstructions(Dictionary dictionary) {
+    const auto first = storage.instructions.count;
+    const auto count = dictionary.statements.count;
+    for (size_t i = 0; i < count; ++i) {
+        APPEND(storage.instructions, decodeStatement(dictionary.statements, i));
+    }
+    APPEND(storage.instructions, (Instruction{OP_DICTIONARY_END, 0, 0}));
+    for (size_t i = 0; i < count; ++i) {
+        auto& instruction = storage.instructions.data[first + i];
+        const auto next = storage.instructions.data[first + i + 1];
+        instruction.type = superinstruction(instruction.type, next.type);
+    }
+    return Indices{first, count + 1};
+}
+
 Expression parseDictionary(CodeRange code) {
     auto whole = code;
     if (!startsWith(code, '{')) {
@@ -462,6 +529,7 @@ Expression parseDictionary(CodeRange code) {
     
     auto dictionary = Dictionary{Indices{statements_first, statements_last - statements_first}, 0};
     bindDictionaryNames(dictionary);
+    dictionary.instructions = decodeInstructions(dictionary);
     return makeDictionary(firstPart(whole, code), dictionary);
 }
 
@@ -761,10 +829,22 @@ Expression parseNumber(CodeRange code) {
         return makeErrorExpression(code, "Reached end of file when parsing number");
     }
     double integer_part = 0.0;
+    // Numbers without fraction are also parsed exactly, if they fit in an integer.
+    Integer exact_integer_part = 0;
+    bool is_exact = true;
     while (startsWithDigit(code)) {
-        integer_part = integer_part * 10 + parseDigitAsDouble(code);
+        const auto digit = parseDigitAsDouble(code);
+        integer_part = integer_part * 10 + digit;
+        is_exact = is_exact &&
+            mulIntegers(exact_integer_part, 10, exact_integer_part) &&
+            addIntegers(exact_integer_part, static_cast<Integer>(digit), exact_integer_part);
         DROP_FRONT(code);
     }
+    if (is_exact && !startsWith(code, '.') && !(is_negative && exact_integer_part == 0)) {
+        return makeInteger(
+            firstPart(start, code), is_negative ? -exact_integer_part : exact_integer_part
+        );
+    }
     double fraction_part = 0.0;
     if (startsWith(code, '.')) {
         DROP_FRONT(code);
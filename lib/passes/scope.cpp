@@ -0,0 +1,108 @@
+#include "scope.h"
+
+#include <carma/carma.h>
+
+#include "../factory.h"
+
+size_t countAssignments(Indices statements, size_t name) {
+    auto count = size_t{0};
+    FOR_EACH(i, statements) {
+        const auto statement = storage.statements.data[i];
+        switch (statement.type) {
+            case DEFINITION: {
+                const auto& definition = storage.definitions.data[statement.index];
+                count += definition.name.global_index == name;
+                break;
+            }
+            case PUT_ASSIGNMENT: {
+                const auto& put_assignment = storage.put_assignments.data[statement.index];
+                count += put_assignment.name.global_index == name;
+                break;
+            }
+            case PUT_EACH_ASSIGNMENT: {
+                const auto& put_each_assignment = storage.put_each_assignments.data[statement.index];
+                count += put_each_assignment.name.global_index == name;
+                break;
+            }
+            case DROP_ASSIGNMENT: {
+                const auto& drop_assignment = storage.drop_assignments.data[statement.index];
+                count += drop_assignment.name.global_index == name;
+                break;
+            }
+            case FOR_STATEMENT: {
+                const auto& for_statement = storage.for_statements.data[statement.index];
+                count += for_statement.item_name.global_index == name;
+                count += for_statement.container_name.global_index == name;
+                break;
+            }
+            case FOR_SIMPLE_STATEMENT: {
+                const auto& for_simple_statement = storage.for_simple_statements.data[statement.index];
+                count += for_simple_statement.container_name.global_index == name;
+                break;
+            }
+            default: break;
+        }
+    }
+    return count;
+}
+
+bool isBinding(Expression scope, size_t name) {
+    switch (scope.type) {
+        case DICTIONARY: {
+            const auto statements = storage.dictionaries.data[scope.index].statements;
+            return countAssignments(statements, name) > 0;
+        }
+        case FUNCTION: {
+            const auto argument = storage.functions.data[scope.index].argument;
+            return storage.arguments.data[argument].name == name;
+        }
+        case FUNCTION_TUPLE: {
+            FOR_EACH(i, storage.tuple_functions.data[scope.index].arguments) {
+                if (storage.arguments.data[i].name == name) {
+                    return true;
+                }
+            }
+            return false;
+        }
+        default: return false;
+    }
+}
+
+size_t findSlot(Expression scope, size_t name) {
+    switch (scope.type) {
+        case DICTIONARY: {
+            FOR_EACH(i, storage.dictionaries.data[scope.index].statements) {
+                const auto statement = storage.statements.data[i];
+                if (statement.type == DEFINITION) {
+                    const auto definition_name = storage.definitions.data[statement.index].name;
+                    if (definition_name.global_index == name) {
+                        return definition_name.dictionary_index;
+                    }
+                }
+                if (statement.type == FOR_STATEMENT) {
+                    const auto item_name = storage.for_statements.data[statement.index].item_name;
+                    if (item_name.global_index == name) {
+                        return item_name.dictionary_index;
+                    }
+                }
+            }
+            return NO_SLOT;
+        }
+        case FUNCTION: {
+            const auto argument = storage.functions.data[scope.index].argument;
+            return storage.arguments.data[argument].name == name ? 0 : NO_SLOT;
+        }
+        case FUNCTION_TUPLE: {
+            // The last argument with the name is the one that is looked up.
+            const auto arguments = storage.tuple_functions.data[scope.index].arguments;
+            auto slot = NO_SLOT;
+            for (size_t i = 0; i < arguments.count; ++i) {
+                if (storage.arguments.data[arguments.data + i].name == name) {
+                    slot = i;
+                }
+            }
+            return slot;
+        }
+        default: return NO_SLOT;
+    }
+}
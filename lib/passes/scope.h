@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct Expression;
+struct Indices;
+
+// Counts the statements of a dictionary that assign a name.
+size_t countAssignments(Indices statements, size_t name);
+// Checks if a dictionary or function binds a name, so that it shadows outer names.
+bool isBinding(Expression scope, size_t name);
+
+const size_t NO_SLOT = SIZE_MAX;
+
+// Returns the index of a name in the evaluated dictionary of a dictionary or function,
+// like initializeDefinitions and applyFunction, or NO_SLOT if it has no definition there.
+size_t findSlot(Expression scope, size_t name);
@@ -1,10 +1,13 @@
 #include "serialize.h"
 
+#include <stdio.h>
+
 #include <carma/carma.h>
 
 #include "../exceptions.h"
 #include "../factory.h"
 #include "../mang_lang_string.h"
+#include "evaluate.h"
 
 namespace {
 
@@ -37,6 +40,16 @@ StringBuilder serializeTypedExpression(StringBuilder s, const TypedExpression& t
     return s;
 }
 
+StringBuilder serializeFoldedExpression(StringBuilder s, const FoldedExpression& folded_expression) {
+    s = serialize(s, folded_expression.original);
+    return s;
+}
+
+StringBuilder serializeLazyExpression(StringBuilder s, const LazyExpression& lazy_expression) {
+    s = serialize(s, lazy_expression.expression);
+    return s;
+}
+
 StringBuilder serializeConditional(StringBuilder s, const Conditional& conditional) {
     s = concatenate(s, "if ");
     FOR_EACH(a, conditional.alternatives) {
@@ -121,17 +134,18 @@ StringBuilder serializeForSimpleStatement(StringBuilder s, const ForSimpleStatem
 }
 
 template<typename Serializer>
-StringBuilder serializeEvaluatedDictionary(StringBuilder s, Serializer serializer, const EvaluatedDictionary& dictionary) {
+StringBuilder serializeEvaluatedDictionary(StringBuilder s, Serializer serializer, EvaluatedDictionary dictionary) {
     if (IS_EMPTY(dictionary.definitions)) {
         s = concatenate(s, "{}");
         return s;
     }
     s = concatenate(s, "{");
     FOR_EACH(i, dictionary.definitions) {
+        const auto value = forceDefinition(i);
         auto definition = storage.definitions.data[i];
         s = serializeName(s, definition.name.global_index);
         s = concatenate(s, "=");
-        s = serializer(s, definition.expression);
+        s = serializer(s, value);
         s = concatenate(s, " ");
     }
     LAST_ITEM(s) = '}';
@@ -352,6 +366,83 @@ StringBuilder serializeEvaluatedStack(StringBuilder s, Expression expression) {
     return s;
 }
 
+StringBuilder serializeTypesEvaluatedDeque(StringBuilder s, EvaluatedDeque deque) {
+    s = concatenate(s, "deque![");
+    if (deque.first != deque.last) {
+        s = serialize_types(s, storage.deque_buffers.at(deque.buffer).at(deque.first));
+    }
+    s = concatenate(s, "]");
+    return s;
+}
+
+StringBuilder serializeEvaluatedDeque(StringBuilder s, EvaluatedDeque deque) {
+    s = concatenate(s, "deque![");
+    const auto& buffer = storage.deque_buffers.at(deque.buffer);
+    for (auto i = deque.first; i < deque.last; ++i) {
+        s = serialize(s, buffer.at(i));
+        s = concatenate(s, " ");
+    }
+    if (deque.first != deque.last) {
+        DROP_BACK(s);
+    }
+    s = concatenate(s, "]");
+    return s;
+}
+
+StringBuilder serializeTypesEvaluatedSet(StringBuilder s, EvaluatedSet set) {
+    s = concatenate(s, "set![");
+    if (set.first != set.last) {
+        s = serialize_types(s, storage.set_buffers.at(set.buffer).items.at(set.first));
+    }
+    s = concatenate(s, "]");
+    return s;
+}
+
+StringBuilder serializeEvaluatedSet(StringBuilder s, EvaluatedSet set) {
+    s = concatenate(s, "set![");
+    const auto& items = storage.set_buffers.at(set.buffer).items;
+    for (auto i = set.first; i < set.last; ++i) {
+        s = serialize(s, items.at(i));
+        s = concatenate(s, " ");
+    }
+    if (set.first != set.last) {
+        DROP_BACK(s);
+    }
+    s = concatenate(s, "]");
+    return s;
+}
+
+StringBuilder serializeTypesEvaluatedGrid(StringBuilder s, const EvaluatedGrid& grid) {
+    if (grid.cells.empty()) {
+        return concatenate(s, "[]");
+    }
+    s = concatenate(s, "[[");
+    s = serialize_types(s, grid.cells.at(0));
+    s = concatenate(s, "]]");
+    return s;
+}
+
+// Grids are serialized as a stack of rows.
+StringBuilder serializeEvaluatedGrid(StringBuilder s, const EvaluatedGrid& grid) {
+    s = concatenate(s, "[");
+    for (size_t y = 0; y < grid.height; ++y) {
+        s = concatenate(s, "[");
+        for (size_t x = 0; x < grid.width; ++x) {
+            s = serialize(s, grid.cells.at(x + y * grid.width));
+            s = concatenate(s, " ");
+        }
+        if (grid.width > 0) {
+            DROP_BACK(s);
+        }
+        s = concatenate(s, "] ");
+    }
+    if (grid.height > 0) {
+        DROP_BACK(s);
+    }
+    s = concatenate(s, "]");
+    return s;
+}
+
 StringBuilder serializeNumber(StringBuilder s, Number number) {
     if (number != number) {
         s = concatenate(s, "nan");
@@ -361,6 +452,26 @@ StringBuilder serializeNumber(StringBuilder s, Number number) {
     return s;
 }
 
+StringBuilder serializeInteger(StringBuilder s, Integer integer) {
+    char buffer[32];
+    snprintf(buffer, sizeof(buffer), "%lld", static_cast<long long>(integer));
+    s = concatenate(s, buffer);
+    return s;
+}
+
+StringBuilder serializeEvaluatedRange(StringBuilder s, EvaluatedRange range) {
+    s = concatenate(s, "[");
+    for (auto number = range.start;
+        range.step > 0 ? number < range.stop : number > range.stop;
+        number += range.step
+    ) {
+        s = serializeNumber(s, number);
+        s = concatenate(s, " ");
+    }
+    LAST_ITEM(s) = ']';
+    return s;
+}
+
 StringBuilder serializeString(StringBuilder s, Expression expression) {
     s = concatenate(s, "\"");
     while (expression.type != EMPTY_STRING) {
@@ -400,6 +511,10 @@ StringBuilder serialize_types(StringBuilder s, Expression expression) {
         case EVALUATED_DICTIONARY: return serializeEvaluatedDictionary(s, serialize_types, storage.evaluated_dictionaries.data[expression.index]);
         case EVALUATED_TUPLE: return serializeEvaluatedTuple(s, serialize_types, expression);
         case EVALUATED_STACK: return serializeTypesEvaluatedStack(s, expression);
+        case EVALUATED_RANGE: return concatenate(s, "[NUMBER]");
+        case EVALUATED_DEQUE: return serializeTypesEvaluatedDeque(s, storage.evaluated_deques.data[expression.index]);
+        case EVALUATED_SET: return serializeTypesEvaluatedSet(s, storage.evaluated_sets.data[expression.index]);
+        case EVALUATED_GRID: return serializeTypesEvaluatedGrid(s, storage.evaluated_grids.at(expression.index));
         case EVALUATED_TABLE: return serializeTypesEvaluatedTable(s, expression);
         // TODO: EVALUATED_TABLE_VIEW?
         default: return concatenate(s, getExpressionName(expression.type)); return s;
@@ -425,6 +540,7 @@ StringBuilder serialize(StringBuilder s, Expression expression) {
         case FUNCTION: return serializeFunction(s, storage.functions.data[expression.index]);
         case FUNCTION_DICTIONARY: return serializeFunctionDictionary(s, storage.dictionary_functions.data[expression.index]);
         case FUNCTION_TUPLE: return serializeFunctionTuple(s, storage.tuple_functions.data[expression.index]);
+        case FUNCTION_MEMO: return serialize(s, storage.memo_functions.data[expression.index].function);
         case TABLE: return serializeTable(s, expression);
         case EVALUATED_TABLE: return serializeEvaluatedTable(s, storage.evaluated_tables.at(expression.index).rows);
         case EVALUATED_TABLE_VIEW: return serializeEvaluatedTable(s, storage.evaluated_table_views.data[expression.index]);
@@ -432,14 +548,21 @@ StringBuilder serialize(StringBuilder s, Expression expression) {
         case EVALUATED_TUPLE: return serializeEvaluatedTuple(s, serialize, expression);
         case STACK: return serializeStack(s, expression);
         case EVALUATED_STACK: return serializeEvaluatedStack(s, expression);
+        case EVALUATED_RANGE: return serializeEvaluatedRange(s, storage.evaluated_ranges.data[expression.index]);
+        case EVALUATED_DEQUE: return serializeEvaluatedDeque(s, storage.evaluated_deques.data[expression.index]);
+        case EVALUATED_SET: return serializeEvaluatedSet(s, storage.evaluated_sets.data[expression.index]);
+        case EVALUATED_GRID: return serializeEvaluatedGrid(s, storage.evaluated_grids.at(expression.index));
         case LOOKUP_CHILD: return serializeLookupChild(s, storage.child_lookups.data[expression.index]);
         case FUNCTION_APPLICATION: return serializeFunctionApplication(s, storage.function_applications.data[expression.index]);
         case LOOKUP_SYMBOL: return serializeLookupSymbol(s, storage.symbol_lookups.data[expression.index]);
         case NUMBER: return serializeNumber(s, getNumber(expression));
+        case INTEGER: return serializeInteger(s, getInteger(expression));
         case EMPTY_STRING: return serializeString(s, expression);
         case STRING: return serializeString(s, expression);
         case DYNAMIC_EXPRESSION: return serializeDynamicExpression(s, storage.dynamic_expressions.data[expression.index]);
         case TYPED_EXPRESSION: return serializeTypedExpression(s, storage.typed_expressions.data[expression.index]);
+        case FOLDED_EXPRESSION: return serializeFoldedExpression(s, storage.folded_expressions.data[expression.index]);
+        case LAZY_EXPRESSION: return serializeLazyExpression(s, storage.lazy_expressions.data[expression.index]);
         case EMPTY_STACK: return concatenate(s, "[]");
         case YES: return concatenate(s, "yes");
         case NO: return concatenate(s, "no");
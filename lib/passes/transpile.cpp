@@ -0,0 +1,687 @@
+#include "transpile.h"
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <carma/carma.h>
+
+#include "../factory.h"
+#include "../mang_lang_string.h"
+#include "scope.h"
+
+// This pass transpiles a program to C++, which is compiled and linked with manglang_lib.
+// Dictionaries are transpiled to C++ scopes with loops, where their names are
+// looked up directly, and names outside of the program are looked up once.
+// Built-in functions are called directly.
+// Functions are evaluated to closures by the interpreter, and their bodies are transpiled
+// to C++ functions, that the interpreter calls when the closures are called.
+// Other expressions that are not transpiled are evaluated by the interpreter,
+// from the syntax tree that the transpiled program gets by parsing the same code as the transpiler.
+// The body of a hot function can also be transpiled and compiled while it is evaluated.
+// Then names outside of the function are looked up in its environment each time.
+
+namespace {
+
+struct Scope {
+    Expression dictionary;
+    size_t variable; // Index of the C++ variable for the evaluated dictionary.
+};
+
+struct Global {
+    size_t name;
+    size_t variable; // Index of the C++ variable for the value of the name.
+};
+
+struct Transpiler {
+    StringBuilder body;
+    StringBuilder globals;
+    DARRAY(Scope) scopes;
+    DARRAY(Global) global_names;
+    DARRAY(Expression) function_bodies; // Bodies of the functions that are evaluated to closures.
+    bool is_function;
+    size_t variable_count;
+    size_t transpiled_count; // Expressions that are transpiled instead of evaluated by the interpreter.
+    int indentation;
+};
+
+StringBuilder emitFormat(StringBuilder s, const char* format, va_list args) {
+    const auto text = format_cstring_v(format, args);
+    s = concatenate(s, text);
+    free((void*)text);
+    return s;
+}
+
+void emit(Transpiler& transpiler, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    transpiler.body = emitFormat(transpiler.body, format, args);
+    va_end(args);
+}
+
+void emitLine(Transpiler& transpiler, const char* format, ...) {
+    APPEND(transpiler.body, '\n');
+    for (auto i = 0; i < transpiler.indentation; ++i) {
+        transpiler.body = concatenate(transpiler.body, "    ");
+    }
+    va_list args;
+    va_start(args, format);
+    transpiler.body = emitFormat(transpiler.body, format, args);
+    va_end(args);
+}
+
+StringBuilder emitString(StringBuilder s, const char* string) {
+    s = concatenate(s, "\"");
+    for (auto c = string; *c; ++c) {
+        switch (*c) {
+            case '"': s = concatenate(s, "\\\""); break;
+            case '\\': s = concatenate(s, "\\\\"); break;
+            case '\n': s = concatenate(s, "\\n\"\n\""); break;
+            default: {
+                if (*c < ' ' || *c > '~') {
+                    const auto escaped = format_cstring("\\%03o", (unsigned char)*c);
+                    s = concatenate(s, escaped);
+                    free((void*)escaped);
+                } else {
+                    APPEND(s, *c);
+                }
+            }
+        }
+    }
+    return concatenate(s, "\"");
+}
+
+// Nodes of the syntax tree are the same when the program parses the code again.
+void emitNode(Transpiler& transpiler, Expression expression) {
+    // Integers are named numbers for the user, but not in the emitted code.
+    emit(transpiler, "Expression{%zuu, {%u, %u}, %s}",
+        expression.index,
+        (unsigned)expression.range.data,
+        (unsigned)expression.range.count,
+        expression.type == INTEGER ? "INTEGER" : getExpressionName(expression.type)
+    );
+}
+
+void emitRange(Transpiler& transpiler, CodeRange range) {
+    emit(transpiler, "CodeRange{%u, %u}", (unsigned)range.data, (unsigned)range.count);
+}
+
+void emitEnvironment(Transpiler& transpiler) {
+    if (IS_EMPTY(transpiler.scopes)) {
+        emit(transpiler, "environment");
+    } else {
+        emit(transpiler, "d%zu", LAST_ITEM(transpiler.scopes).variable);
+    }
+}
+
+// Names that are not defined in the transpiled dictionaries are defined outside of the program,
+// where they do not change.
+size_t globalVariable(Transpiler& transpiler, size_t name) {
+    FOR_EACH(global, transpiler.global_names) {
+        if (global->name == name) {
+            return global->variable;
+        }
+    }
+    const auto variable = transpiler.variable_count++;
+    APPEND(transpiler.global_names, (Global{name, variable}));
+    const auto line = format_cstring(
+        "\n    const auto g%zu = lookupDictionary(CodeRange{}, BoundGlobalName{%zu}, environment); // %s",
+        variable, name, storage.names.data + name
+    );
+    transpiler.globals = concatenate(transpiler.globals, line);
+    free((void*)line);
+    return variable;
+}
+
+bool isGlobal(const Transpiler& transpiler, size_t name) {
+    FOR_EACH(scope, transpiler.scopes) {
+        if (findSlot(scope->dictionary, name) != NO_SLOT) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void emitBoundLocalName(Transpiler& transpiler, BoundLocalName name) {
+    emit(transpiler, "BoundLocalName{%zu, %zu}", name.global_index, name.dictionary_index);
+}
+
+void emitName(Transpiler& transpiler, size_t name) {
+    FOR_EACH_BACKWARD(scope, transpiler.scopes) {
+        const auto slot = findSlot(scope->dictionary, name);
+        if (slot != NO_SLOT) {
+            emit(transpiler, "getDictionaryDefinition(d%zu, ", scope->variable);
+            emitBoundLocalName(transpiler, BoundLocalName{name, slot});
+            emit(transpiler, ")");
+            return;
+        }
+    }
+    if (transpiler.is_function) {
+        emit(transpiler, "lookupDictionary(CodeRange{}, BoundGlobalName{%zu}, environment)", name);
+        return;
+    }
+    emit(transpiler, "g%zu", globalVariable(transpiler, name));
+}
+
+void emitExpression(Transpiler& transpiler, Expression expression);
+
+void emitStatements(Transpiler& transpiler, Expression dictionary, size_t first, size_t last);
+
+void emitDefinition(Transpiler& transpiler, size_t variable, BoundLocalName name) {
+    emitLine(transpiler, "setDictionaryDefinition(d%zu, ", variable);
+    emitBoundLocalName(transpiler, name);
+    emit(transpiler, ", ");
+}
+
+void emitCurrentValue(Transpiler& transpiler, size_t variable, BoundLocalName name) {
+    emit(transpiler, "getDictionaryDefinition(d%zu, ", variable);
+    emitBoundLocalName(transpiler, name);
+    emit(transpiler, ")");
+}
+
+void emitCondition(Transpiler& transpiler) {
+    emitLine(transpiler, "if (condition.error.type == ERROR_EXPRESSION) return condition.error;");
+}
+
+// Emits the statements of a loop, and returns the index of the statement after it.
+size_t emitLoop(Transpiler& transpiler, Expression dictionary, size_t i) {
+    const auto variable = LAST_ITEM(transpiler.scopes).variable;
+    const auto statements = storage.dictionaries.data[dictionary.index].statements;
+    const auto statement = storage.statements.data[statements.data + i];
+    emitLine(transpiler, "for (;;) {");
+    ++transpiler.indentation;
+    switch (statement.type) {
+        case WHILE_STATEMENT: {
+            const auto while_statement = storage.while_statements.data[statement.index];
+            emitLine(transpiler, "const auto condition = boolean(");
+            emitExpression(transpiler, while_statement.expression);
+            emit(transpiler, ");");
+            emitCondition(transpiler);
+            emitLine(transpiler, "if (!condition.value) break;");
+            emitStatements(transpiler, dictionary, i + 1, while_statement.end_index);
+            --transpiler.indentation;
+            emitLine(transpiler, "}");
+            return while_statement.end_index + 1;
+        }
+        case FOR_STATEMENT: {
+            const auto for_statement = storage.for_statements.data[statement.index];
+            emitLine(transpiler, "const auto condition = boolean(");
+            emitCurrentValue(transpiler, variable, for_statement.container_name);
+            emit(transpiler, ");");
+            emitCondition(transpiler);
+            emitLine(transpiler, "if (!condition.value) break;");
+            emitDefinition(transpiler, variable, for_statement.item_name);
+            emit(transpiler, "container_functions::take(");
+            emitCurrentValue(transpiler, variable, for_statement.container_name);
+            emit(transpiler, "));");
+            emitStatements(transpiler, dictionary, i + 1, for_statement.end_index);
+            emitDefinition(transpiler, variable, for_statement.container_name);
+            emit(transpiler, "container_functions::drop(");
+            emitCurrentValue(transpiler, variable, for_statement.container_name);
+            emit(transpiler, "));");
+            --transpiler.indentation;
+            emitLine(transpiler, "}");
+            return for_statement.end_index + 1;
+        }
+        case FOR_SIMPLE_STATEMENT: {
+            const auto for_statement = storage.for_simple_statements.data[statement.index];
+            emitLine(transpiler, "const auto condition = boolean(");
+            emitCurrentValue(transpiler, variable, for_statement.container_name);
+            emit(transpiler, ");");
+            emitCondition(transpiler);
+            emitLine(transpiler, "if (!condition.value) break;");
+            emitStatements(transpiler, dictionary, i + 1, for_statement.end_index);
+            emitDefinition(transpiler, variable, for_statement.container_name);
+            emit(transpiler, "container_functions::drop(");
+            emitCurrentValue(transpiler, variable, for_statement.container_name);
+            emit(transpiler, "));");
+            --transpiler.indentation;
+            emitLine(transpiler, "}");
+            return for_statement.end_index + 1;
+        }
+        default: return i + 1;
+    }
+}
+
+void emitStatements(Transpiler& transpiler, Expression dictionary, size_t first, size_t last) {
+    const auto variable = LAST_ITEM(transpiler.scopes).variable;
+    const auto statements = storage.dictionaries.data[dictionary.index].statements;
+    auto i = first;
+    while (i < last) {
+        const auto statement = storage.statements.data[statements.data + i];
+        switch (statement.type) {
+            case DEFINITION: {
+                const auto definition = storage.definitions.data[statement.index];
+                emitDefinition(transpiler, variable, definition.name);
+                emitExpression(transpiler, definition.expression);
+                emit(transpiler, ");");
+                ++i;
+                break;
+            }
+            case PUT_ASSIGNMENT: {
+                const auto put_assignment = storage.put_assignments.data[statement.index];
+                emitLine(transpiler, "{");
+                ++transpiler.indentation;
+                emitLine(transpiler, "const auto value = ");
+                emitExpression(transpiler, put_assignment.expression);
+                emit(transpiler, ";");
+                emitDefinition(transpiler, variable, put_assignment.name);
+                emit(transpiler, "container_functions::putBinary(value, ");
+                emitCurrentValue(transpiler, variable, put_assignment.name);
+                emit(transpiler, "));");
+                --transpiler.indentation;
+                emitLine(transpiler, "}");
+                ++i;
+                break;
+            }
+            case PUT_EACH_ASSIGNMENT: {
+                const auto put_each_assignment = storage.put_each_assignments.data[statement.index];
+                emitLine(transpiler, "for (auto container = ");
+                emitExpression(transpiler, put_each_assignment.expression);
+                emit(transpiler, ";;) {");
+                ++transpiler.indentation;
+                emitLine(transpiler, "const auto condition = boolean(container);");
+                emitCondition(transpiler);
+                emitLine(transpiler, "if (!condition.value) break;");
+                emitDefinition(transpiler, variable, put_each_assignment.name);
+                emit(transpiler, "container_functions::putBinary(container_functions::take(container), ");
+                emitCurrentValue(transpiler, variable, put_each_assignment.name);
+                emit(transpiler, "));");
+                emitLine(transpiler, "container = container_functions::drop(container);");
+                --transpiler.indentation;
+                emitLine(transpiler, "}");
+                ++i;
+                break;
+            }
+            case DROP_ASSIGNMENT: {
+                const auto drop_assignment = storage.drop_assignments.data[statement.index];
+                emitDefinition(transpiler, variable, drop_assignment.name);
+                emit(transpiler, "container_functions::drop(");
+                emitCurrentValue(transpiler, variable, drop_assignment.name);
+                emit(transpiler, "));");
+                ++i;
+                break;
+            }
+            case WHILE_STATEMENT: i = emitLoop(transpiler, dictionary, i); break;
+            case FOR_STATEMENT: i = emitLoop(transpiler, dictionary, i); break;
+            case FOR_SIMPLE_STATEMENT: i = emitLoop(transpiler, dictionary, i); break;
+            case RETURN_STATEMENT: emitLine(transpiler, "return d%zu;", variable); ++i; break;
+            default: ++i; break;
+        }
+    }
+}
+
+void emitDictionary(Transpiler& transpiler, Expression dictionary) {
+    const auto variable = transpiler.variable_count++;
+    emit(transpiler, "[&]() -> Expression {");
+    ++transpiler.indentation;
+    emitLine(transpiler, "const auto d%zu = beginDictionary(", variable);
+    emitNode(transpiler, dictionary);
+    emit(transpiler, ", ");
+    emitEnvironment(transpiler);
+    emit(transpiler, ");");
+    APPEND(transpiler.scopes, (Scope{dictionary, variable}));
+    const auto statements = storage.dictionaries.data[dictionary.index].statements;
+    emitStatements(transpiler, dictionary, 0, statements.count);
+    --transpiler.scopes.count;
+    emitLine(transpiler, "return d%zu;", variable);
+    --transpiler.indentation;
+    emitLine(transpiler, "}()");
+}
+
+void emitConditional(Transpiler& transpiler, Expression conditional) {
+    const auto conditional_struct = storage.conditionals.data[conditional.index];
+    emit(transpiler, "[&]() -> Expression {");
+    ++transpiler.indentation;
+    FOR_EACH(a, conditional_struct.alternatives) {
+        const auto alternative = storage.alternatives.data[a];
+        emitLine(transpiler, "{");
+        ++transpiler.indentation;
+        emitLine(transpiler, "const auto condition = boolean(");
+        emitExpression(transpiler, alternative.left);
+        emit(transpiler, ");");
+        emitCondition(transpiler);
+        emitLine(transpiler, "if (condition.value) return ");
+        emitExpression(transpiler, alternative.right);
+        emit(transpiler, ";");
+        --transpiler.indentation;
+        emitLine(transpiler, "}");
+    }
+    emitLine(transpiler, "return ");
+    emitExpression(transpiler, conditional_struct.expression_else);
+    emit(transpiler, ";");
+    --transpiler.indentation;
+    emitLine(transpiler, "}()");
+}
+
+void emitIs(Transpiler& transpiler, Expression is) {
+    const auto is_struct = storage.is_expressions.data[is.index];
+    emit(transpiler, "[&]() -> Expression {");
+    ++transpiler.indentation;
+    emitLine(transpiler, "const auto value = ");
+    emitExpression(transpiler, is_struct.input);
+    emit(transpiler, ";");
+    FOR_EACH(a, is_struct.alternative) {
+        const auto alternative = storage.alternatives.data[a];
+        emitLine(transpiler, "if (isEqual(value, ");
+        emitExpression(transpiler, alternative.left);
+        emit(transpiler, ")) return ");
+        emitExpression(transpiler, alternative.right);
+        emit(transpiler, ";");
+    }
+    emitLine(transpiler, "return ");
+    emitExpression(transpiler, is_struct.expression_else);
+    emit(transpiler, ";");
+    --transpiler.indentation;
+    emitLine(transpiler, "}()");
+}
+
+void emitTuple(Transpiler& transpiler, Expression tuple) {
+    emit(transpiler, "makeTupleOf(");
+    emitRange(transpiler, tuple.range);
+    emit(transpiler, ", {");
+    auto separator = "";
+    FOR_EACH(i, storage.tuples.data[tuple.index].indices) {
+        emit(transpiler, separator);
+        emitExpression(transpiler, storage.expressions.data[i]);
+        separator = ", ";
+    }
+    emit(transpiler, "})");
+}
+
+void emitFunctionApplication(Transpiler& transpiler, Expression function_application) {
+    const auto application = storage.function_applications.data[function_application.index];
+    const auto name = application.name.global_index;
+    const auto child = application.child;
+    if (child.type == TUPLE && storage.tuples.data[child.index].indices.count == 2) {
+        // Names outside of the program are the same as when the type pass proved the call.
+        const auto is_proven = application.proof == TYPE_PROVEN && isGlobal(transpiler, name);
+        const auto items = storage.tuples.data[child.index].indices;
+        emit(transpiler, "applyFunctionBinary(");
+        emitRange(transpiler, function_application.range);
+        emit(transpiler, ", ");
+        emitName(transpiler, name);
+        emit(transpiler, ", {");
+        emitExpression(transpiler, storage.expressions.data[items.data + 0]);
+        emit(transpiler, ", ");
+        emitExpression(transpiler, storage.expressions.data[items.data + 1]);
+        emit(transpiler, "}, %s)", is_proven ? "true" : "false");
+        return;
+    }
+    emit(transpiler, "applyFunctionValue(");
+    emitRange(transpiler, function_application.range);
+    emit(transpiler, ", ");
+    emitName(transpiler, name);
+    emit(transpiler, ", ");
+    emitExpression(transpiler, child);
+    emit(transpiler, ")");
+}
+
+void emitLookupChild(Transpiler& transpiler, Expression lookup_child) {
+    const auto lookup_child_struct = storage.child_lookups.data[lookup_child.index];
+    emit(transpiler, "lookupChild(");
+    emitRange(transpiler, lookup_child.range);
+    emit(transpiler, ", %zu, ", lookup_child_struct.name);
+    emitExpression(transpiler, lookup_child_struct.child);
+    emit(transpiler, ")");
+}
+
+void emitEvaluate(Transpiler& transpiler, Expression expression) {
+    emit(transpiler, "evaluate(");
+    emitNode(transpiler, expression);
+    emit(transpiler, ", ");
+    emitEnvironment(transpiler);
+    emit(transpiler, ")");
+}
+
+// Numbers are kept unboxed in C++ variables, with the arithmetic of numeric.h.
+// The original expression is evaluated instead when an operand is not a number,
+// like in the interpreter.
+void emitNumeric(Transpiler& transpiler, Expression numeric) {
+    const auto numeric_struct = storage.numerics.data[numeric.index];
+    size_t stack[NUMERIC_STACK_SIZE]; // Variables of the numbers on the stack.
+    auto count = size_t{0};
+    auto is_boolean = false;
+    emit(transpiler, "[&]() -> Expression {");
+    ++transpiler.indentation;
+    FOR_EACH(i, numeric_struct.operations) {
+        const auto operation = storage.numeric_operations.data[i];
+        const auto variable = transpiler.variable_count++;
+        if (operation.type == NUMERIC_CONSTANT) {
+            emitLine(transpiler, "const auto n%zu = makeStackNumber(", variable);
+            emitNode(transpiler, operation.operand);
+            emit(transpiler, ");");
+            stack[count++] = variable;
+            continue;
+        }
+        if (operation.type == NUMERIC_LOCAL || operation.type == NUMERIC_EXPRESSION) {
+            emitLine(transpiler, "const auto e%zu = ", variable);
+            if (operation.type == NUMERIC_LOCAL) {
+                emit(transpiler, "getDictionaryDefinition(");
+                emitEnvironment(transpiler);
+                emit(transpiler, ", ");
+                emitBoundLocalName(transpiler, BoundLocalName{0, operation.operand.index});
+                emit(transpiler, ")");
+            } else {
+                emitExpression(transpiler, operation.operand);
+            }
+            emit(transpiler, ";");
+            emitLine(transpiler, "if (!isStackNumber(e%zu)) return ", variable);
+            emitEvaluate(transpiler, numeric_struct.original);
+            emit(transpiler, ";");
+            emitLine(transpiler, "const auto n%zu = makeStackNumber(e%zu);", variable, variable);
+            stack[count++] = variable;
+            continue;
+        }
+        --count;
+        const auto left = stack[count - 1];
+        const auto right = stack[count];
+        switch (operation.type) {
+            case NUMERIC_ADD: emitLine(transpiler, "const auto n%zu = addStackNumbers(n%zu, n%zu);", variable, left, right); break;
+            case NUMERIC_SUB: emitLine(transpiler, "const auto n%zu = subStackNumbers(n%zu, n%zu);", variable, left, right); break;
+            case NUMERIC_MUL: emitLine(transpiler, "const auto n%zu = mulStackNumbers(n%zu, n%zu);", variable, left, right); break;
+            case NUMERIC_DIV: emitLine(transpiler, "const auto n%zu = divStackNumbers(n%zu, n%zu);", variable, left, right); break;
+            case NUMERIC_MOD: emitLine(transpiler, "const auto n%zu = modStackNumbers(n%zu, n%zu);", variable, left, right); break;
+            case NUMERIC_LESS: {
+                emitLine(transpiler, "return lessStackNumbers(n%zu, n%zu);", left, right);
+                is_boolean = true;
+                break;
+            }
+            default: break;
+        }
+        stack[count - 1] = variable;
+    }
+    if (!is_boolean) {
+        emitLine(transpiler, "return makeExpressionFromStack(n%zu);", stack[0]);
+    }
+    --transpiler.indentation;
+    emitLine(transpiler, "}()");
+}
+
+// Folded, dynamic and proven typed expressions are transpiled as the expressions that they wrap.
+// Typed expressions that are not proven are evaluated, so that their type is checked at run-time.
+Expression unwrap(Expression expression) {
+    for (;;) {
+        switch (expression.type) {
+            case FOLDED_EXPRESSION: expression = storage.folded_expressions.data[expression.index].folded; break;
+            case DYNAMIC_EXPRESSION: expression = storage.dynamic_expressions.data[expression.index].expression; break;
+            case TYPED_EXPRESSION: {
+                const auto typed_expression = storage.typed_expressions.data[expression.index];
+                if (typed_expression.proof != TYPE_PROVEN) {
+                    return expression;
+                }
+                expression = typed_expression.value;
+                break;
+            }
+            default: return expression;
+        }
+    }
+}
+
+void emitExpression(Transpiler& transpiler, Expression expression) {
+    expression = unwrap(expression);
+    switch (expression.type) {
+        case NUMBER: emitNode(transpiler, expression); break;
+        case INTEGER: emitNode(transpiler, expression); break;
+        case CHARACTER: emitNode(transpiler, expression); break;
+        case YES: emitNode(transpiler, expression); break;
+        case NO: emitNode(transpiler, expression); break;
+        case EMPTY_STACK: emitNode(transpiler, expression); break;
+        case EMPTY_STRING: emitNode(transpiler, expression); break;
+        case STRING: emitNode(transpiler, expression); break;
+        case LOOKUP_SYMBOL: emitName(transpiler, storage.symbol_lookups.data[expression.index].name.global_index); break;
+        case LOOKUP_CHILD: emitLookupChild(transpiler, expression); break;
+        case FUNCTION_APPLICATION: emitFunctionApplication(transpiler, expression); break;
+        case CONDITIONAL: emitConditional(transpiler, expression); break;
+        case IS: emitIs(transpiler, expression); break;
+        case DICTIONARY: emitDictionary(transpiler, expression); break;
+        case TUPLE: emitTuple(transpiler, expression); break;
+        case NUMERIC: emitNumeric(transpiler, expression); break;
+        // Functions are evaluated to closures over the transpiled dictionaries.
+        case FUNCTION: {
+            APPEND(transpiler.function_bodies, storage.functions.data[expression.index].body);
+            emitEvaluate(transpiler, expression);
+            return;
+        }
+        case FUNCTION_DICTIONARY: {
+            APPEND(transpiler.function_bodies, storage.dictionary_functions.data[expression.index].body);
+            emitEvaluate(transpiler, expression);
+            return;
+        }
+        case FUNCTION_TUPLE: {
+            APPEND(transpiler.function_bodies, storage.tuple_functions.data[expression.index].body);
+            emitEvaluate(transpiler, expression);
+            return;
+        }
+        default: emitEvaluate(transpiler, expression); return;
+    }
+    ++transpiler.transpiled_count;
+}
+
+// Transpiles the bodies of the functions in the program, and the functions in them,
+// to C++ functions that are evaluated in the environment of each call.
+// Bodies that would only call the interpreter are left to the interpreter.
+StringBuilder emitFunctionBodies(StringBuilder s, Transpiler& transpiler, size_t& function_count) {
+    const auto program_body = transpiler.body;
+    auto table = StringBuilder{};
+    transpiler.is_function = true;
+    for (size_t i = 0; i < transpiler.function_bodies.count; ++i) {
+        const auto body = transpiler.function_bodies.data[i];
+        transpiler.body = StringBuilder{};
+        transpiler.transpiled_count = 0;
+        emitExpression(transpiler, body);
+        if (transpiler.transpiled_count > 0) {
+            const auto header = format_cstring(
+                "\n\nstatic Expression function%zu(Expression environment) {\n    return ",
+                function_count
+            );
+            s = concatenate(s, header);
+            free((void*)header);
+            CONCAT(s, transpiler.body);
+            s = concatenate(s, ";\n}");
+            transpiler.body.count = 0;
+            emit(transpiler, "\n    {");
+            emitNode(transpiler, body);
+            emit(transpiler, ", function%zu},", function_count);
+            CONCAT(table, transpiler.body);
+            ++function_count;
+        }
+        FREE_DARRAY(transpiler.body);
+    }
+    if (function_count > 0) {
+        s = concatenate(s, "\n\nstatic const TranspiledFunction FUNCTIONS[] = {");
+        CONCAT(s, table);
+        s = concatenate(s, "\n};");
+    }
+    FREE_DARRAY(table);
+    transpiler.body = program_body;
+    transpiler.is_function = false;
+    return s;
+}
+
+} // namespace
+
+StringBuilder transpile(StringBuilder s, Expression expression, const char* code) {
+    auto transpiler = Transpiler{};
+    transpiler.indentation = 1;
+    emitExpression(transpiler, expression);
+    s = concatenate(s,
+        "// This program is transpiled from Manglang by manglang_aot.\n"
+        "\n"
+        "#include <transpiled_program.h>\n"
+        "\n"
+        "static const char CODE[] =\n"
+    );
+    s = emitString(s, code);
+    s = concatenate(s, ";");
+    auto function_count = size_t{0};
+    s = emitFunctionBodies(s, transpiler, function_count);
+    s = concatenate(s, "\n\nstatic Expression program(Expression environment) {");
+    CONCAT(s, transpiler.globals);
+    s = concatenate(s, "\n    return ");
+    CONCAT(s, transpiler.body);
+    s = concatenate(s, ";\n}\n\nint main() {\n    const auto ast = ");
+    transpiler.body.count = 0;
+    emitNode(transpiler, expression);
+    CONCAT(s, transpiler.body);
+    const auto functions = function_count > 0 ?
+        format_cstring("FUNCTIONS, %zu", function_count) : format_cstring("nullptr, 0");
+    const auto call = format_cstring(
+        ";\n    const auto result = evaluate_transpiled(CODE, ast, program, %s);\n", functions
+    );
+    s = concatenate(s, call);
+    free((void*)call);
+    free((void*)functions);
+    s = concatenate(s,
+        "    printf(\"%s\", result.data);\n"
+        "}\n"
+    );
+    FREE_DARRAY(transpiler.body);
+    FREE_DARRAY(transpiler.globals);
+    FREE_DARRAY(transpiler.function_bodies);
+    FREE_DARRAY(transpiler.scopes);
+    FREE_DARRAY(transpiler.global_names);
+    return s;
+}
+
+StringBuilder transpileFunction(StringBuilder s, Expression body, bool& is_transpiled) {
+    auto transpiler = Transpiler{};
+    transpiler.is_function = true;
+    transpiler.indentation = 1;
+    emitExpression(transpiler, body);
+    is_transpiled = transpiler.transpiled_count > 0;
+    s = concatenate(s,
+        "// This function is transpiled from Manglang while it is evaluated.\n"
+        "\n"
+        "#include <jit_program.h>\n"
+        "\n"
+        "extern \"C\" Expression manglang_jit_function(Expression environment) {\n"
+        "    return "
+    );
+    CONCAT(s, transpiler.body);
+    s = concatenate(s, ";\n}\n");
+    FREE_DARRAY(transpiler.body);
+    FREE_DARRAY(transpiler.scopes);
+    FREE_DARRAY(transpiler.function_bodies);
+    return s;
+}
+
+StringBuilder transpileError(StringBuilder s, const char* message) {
+    s = concatenate(s,
+        "// This program is transpiled from Manglang by manglang_aot.\n"
+        "// The code has an error, which the program writes.\n"
+        "\n"
+        "#include <stdio.h>\n"
+        "\n"
+        "static const char ERROR[] =\n"
+    );
+    s = emitString(s, message);
+    s = concatenate(s,
+        ";\n"
+        "\n"
+        "int main() {\n"
+        "    printf(\"%s\", ERROR);\n"
+        "}\n"
+    );
+    return s;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "../expression.h"
+#include "../mang_lang_string.h"
+
+StringBuilder transpile(StringBuilder s, Expression expression, const char* code);
+// Transpiles the body of a function, which is evaluated in the environment of the function.
+// is_transpiled is false when the transpiled function only calls the interpreter.
+StringBuilder transpileFunction(StringBuilder s, Expression body, bool& is_transpiled);
+// Transpiles a program that writes the error message of code that does not type check.
+StringBuilder transpileError(StringBuilder s, const char* message);
@@ -0,0 +1,233 @@
+#include "trim.h"
+
+#include <stdint.h>
+
+#include <carma/carma.h>
+
+#include "../factory.h"
+#include "scope.h"
+
+// This pass runs after folding and before evaluation.
+// It finds the dictionaries around each function that do not define
+// any of the names that the function refers to. The closure of the function
+// skips those dictionaries, so that it does not keep them alive,
+// and so that the lookups in its body visit fewer dictionaries.
+// The environment of a closure is still shared and not copied,
+// so that it sees later assignments, and can refer to itself recursively.
+
+namespace {
+
+const size_t NO_SCOPE = SIZE_MAX;
+
+struct Scope {
+    Expression expression; // DICTIONARY, FUNCTION or FUNCTION_TUPLE.
+    size_t parent; // Scope whose evaluated dictionary is the environment of this scope.
+    size_t outer; // Scope that this scope is evaluated in.
+};
+
+struct Trimmer {
+    bool is_trimming; // Only collect names, when false.
+    size_t scope; // Scope that the current expression is evaluated in.
+    DARRAY(Scope) scopes;
+    DARRAY(size_t) names; // Names that the visited expressions refer to.
+};
+
+void trimExpression(Trimmer& trimmer, Expression expression);
+
+bool isBindingAny(Expression scope, const size_t* first, const size_t* last) {
+    for (auto name = first; name != last; ++name) {
+        if (isBinding(scope, *name)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the number of scopes from the current scope to the innermost scope
+// that binds a name that the visited expression refers to.
+// The outermost scope is kept, since the names around it are not known here.
+size_t countSkippedScopes(Trimmer& trimmer, size_t first_name, size_t& scope) {
+    const auto first = trimmer.names.data + first_name;
+    const auto last = trimmer.names.data + trimmer.names.count;
+    auto steps = size_t{0};
+    scope = trimmer.scope;
+    while (scope != NO_SCOPE) {
+        const auto s = trimmer.scopes.data[scope];
+        if (s.parent == NO_SCOPE || isBindingAny(s.expression, first, last)) {
+            break;
+        }
+        scope = s.parent;
+        ++steps;
+    }
+    return steps;
+}
+
+void enterScope(Trimmer& trimmer, Expression scope, size_t parent) {
+    APPEND(trimmer.scopes, (Scope{scope, parent, trimmer.scope}));
+    trimmer.scope = trimmer.scopes.count - 1;
+}
+
+void exitScope(Trimmer& trimmer) {
+    const auto scope = trimmer.scope;
+    trimmer.scope = trimmer.scopes.data[scope].outer;
+    trimmer.scopes.count = scope;
+}
+
+void trimArguments(Trimmer& trimmer, Indices arguments) {
+    FOR_EACH(i, arguments) {
+        trimExpression(trimmer, storage.arguments.data[i].type);
+    }
+}
+
+void trimStatements(Trimmer& trimmer, Indices statements) {
+    FOR_EACH(i, statements) {
+        const auto statement = storage.statements.data[i];
+        switch (statement.type) {
+            case DEFINITION: trimExpression(trimmer, storage.definitions.data[statement.index].expression); break;
+            case PUT_ASSIGNMENT: trimExpression(trimmer, storage.put_assignments.data[statement.index].expression); break;
+            case PUT_EACH_ASSIGNMENT: trimExpression(trimmer, storage.put_each_assignments.data[statement.index].expression); break;
+            case WHILE_STATEMENT: trimExpression(trimmer, storage.while_statements.data[statement.index].expression); break;
+            default: break;
+        }
+    }
+}
+
+void trimDictionary(Trimmer& trimmer, Expression dictionary) {
+    enterScope(trimmer, dictionary, trimmer.scope);
+    trimStatements(trimmer, storage.dictionaries.data[dictionary.index].statements);
+    exitScope(trimmer);
+}
+
+// The names of a function are collected before it is trimmed,
+// since the functions inside it need to know which scopes it skips.
+template<typename FunctionStruct>
+void trimFunction(
+    Trimmer& trimmer, Expression function, FunctionStruct& function_struct, Indices arguments
+) {
+    if (!trimmer.is_trimming) {
+        trimArguments(trimmer, arguments);
+        trimExpression(trimmer, function_struct.body);
+        return;
+    }
+    const auto first_name = trimmer.names.count;
+    trimmer.is_trimming = false;
+    trimArguments(trimmer, arguments);
+    trimExpression(trimmer, function_struct.body);
+    trimmer.is_trimming = true;
+    auto environment = NO_SCOPE;
+    function_struct.environment_steps = countSkippedScopes(trimmer, first_name, environment);
+    trimmer.names.count = first_name;
+    // The argument types are evaluated in the environment of the closure.
+    const auto outer_scope = trimmer.scope;
+    trimmer.scope = environment;
+    trimArguments(trimmer, arguments);
+    trimmer.scope = outer_scope;
+    enterScope(trimmer, function, environment);
+    trimExpression(trimmer, function_struct.body);
+    exitScope(trimmer);
+}
+
+// Dictionary functions look up names in their input, and are not trimmed.
+void trimFunctionDictionary(Trimmer& trimmer, Expression function) {
+    const auto function_struct = storage.dictionary_functions.data[function.index];
+    trimArguments(trimmer, function_struct.arguments);
+    const auto is_trimming = trimmer.is_trimming;
+    trimmer.is_trimming = false;
+    trimExpression(trimmer, function_struct.body);
+    trimmer.is_trimming = is_trimming;
+}
+
+void trimAlternatives(Trimmer& trimmer, Indices alternatives) {
+    FOR_EACH(a, alternatives) {
+        const auto alternative = storage.alternatives.data[a];
+        trimExpression(trimmer, alternative.left);
+        trimExpression(trimmer, alternative.right);
+    }
+}
+
+void trimConditional(Trimmer& trimmer, Expression conditional) {
+    const auto conditional_struct = storage.conditionals.data[conditional.index];
+    trimAlternatives(trimmer, conditional_struct.alternatives);
+    trimExpression(trimmer, conditional_struct.expression_else);
+}
+
+void trimIs(Trimmer& trimmer, Expression is) {
+    const auto is_struct = storage.is_expressions.data[is.index];
+    trimExpression(trimmer, is_struct.input);
+    trimAlternatives(trimmer, is_struct.alternative);
+    trimExpression(trimmer, is_struct.expression_else);
+}
+
+void trimTuple(Trimmer& trimmer, Expression tuple) {
+    FOR_EACH(i, storage.tuples.data[tuple.index].indices) {
+        trimExpression(trimmer, storage.expressions.data[i]);
+    }
+}
+
+void trimStack(Trimmer& trimmer, Expression stack) {
+    for (auto item = stack; item.type == STACK; item = storage.stacks.data[item.index].rest) {
+        trimExpression(trimmer, storage.stacks.data[item.index].top);
+    }
+}
+
+void trimTable(Trimmer& trimmer, Expression table) {
+    FOR_EACH(i, storage.tables.data[table.index].rows) {
+        trimExpression(trimmer, storage.rows.data[i].key);
+        trimExpression(trimmer, storage.rows.data[i].value);
+    }
+}
+
+void trimFunctionApplication(Trimmer& trimmer, Expression function_application) {
+    const auto function_application_struct = storage.function_applications.data[function_application.index];
+    APPEND(trimmer.names, function_application_struct.name.global_index);
+    trimExpression(trimmer, function_application_struct.child);
+}
+
+void trimTypedExpression(Trimmer& trimmer, Expression typed_expression) {
+    const auto typed_expression_struct = storage.typed_expressions.data[typed_expression.index];
+    APPEND(trimmer.names, typed_expression_struct.type_name.global_index);
+    trimExpression(trimmer, typed_expression_struct.value);
+}
+
+void trimExpression(Trimmer& trimmer, Expression expression) {
+    switch (expression.type) {
+        case LOOKUP_SYMBOL: APPEND(trimmer.names, storage.symbol_lookups.data[expression.index].name.global_index); break;
+        case FUNCTION_APPLICATION: trimFunctionApplication(trimmer, expression); break;
+        case TYPED_EXPRESSION: trimTypedExpression(trimmer, expression); break;
+        case LOOKUP_CHILD: trimExpression(trimmer, storage.child_lookups.data[expression.index].child); break;
+        case DYNAMIC_EXPRESSION: trimExpression(trimmer, storage.dynamic_expressions.data[expression.index].expression); break;
+        case FOLDED_EXPRESSION: trimExpression(trimmer, storage.folded_expressions.data[expression.index].folded); break;
+        case LAZY_EXPRESSION: trimExpression(trimmer, storage.lazy_expressions.data[expression.index].expression); break;
+        case STREAM: trimExpression(trimmer, storage.streams.data[expression.index].original); break;
+        case IS_TABLE: trimExpression(trimmer, storage.is_tables.data[expression.index].is); break;
+        case NUMERIC: trimExpression(trimmer, storage.numerics.data[expression.index].original); break;
+        case CONDITIONAL: trimConditional(trimmer, expression); break;
+        case IS: trimIs(trimmer, expression); break;
+        case DICTIONARY: trimDictionary(trimmer, expression); break;
+        case FUNCTION: {
+            auto& function_struct = storage.functions.data[expression.index];
+            trimFunction(trimmer, expression, function_struct, Indices{function_struct.argument, 1});
+            break;
+        }
+        case FUNCTION_TUPLE: {
+            auto& function_struct = storage.tuple_functions.data[expression.index];
+            trimFunction(trimmer, expression, function_struct, function_struct.arguments);
+            break;
+        }
+        case FUNCTION_DICTIONARY: trimFunctionDictionary(trimmer, expression); break;
+        case TUPLE: trimTuple(trimmer, expression); break;
+        case STACK: trimStack(trimmer, expression); break;
+        case TABLE: trimTable(trimmer, expression); break;
+        default: break;
+    }
+}
+
+} // namespace
+
+Expression trim(Expression expression) {
+    auto trimmer = Trimmer{true, NO_SCOPE, {}, {}};
+    trimExpression(trimmer, expression);
+    FREE_DARRAY(trimmer.scopes);
+    FREE_DARRAY(trimmer.names);
+    return expression;
+}
@@ -0,0 +1,37 @@
+#include "transpiled_program.h"
+
+#include <carma/carma.h>
+
+#include "factory.h"
+
+Expression beginDictionary(Expression dictionary, Expression environment) {
+    const auto definitions = initializeDefinitions(storage.dictionaries.data[dictionary.index]);
+    return makeEvaluatedDictionary(
+        dictionary.range, EvaluatedDictionary{environment, definitions}
+    );
+}
+
+Expression applyFunctionBinary(
+    CodeRange range, Expression function, Operands operands, bool is_proven
+) {
+    if (function.type == FUNCTION_BUILT_IN) {
+        const auto function_struct = storage.built_in_functions.data[function.index];
+        if (is_proven && function_struct.proven_binary_function) {
+            return function_struct.proven_binary_function(operands.left, operands.right);
+        }
+        if (function_struct.binary_function) {
+            return function_struct.binary_function(operands.left, operands.right);
+        }
+    }
+    const auto input = makeTupleOf(range, {operands.left, operands.right});
+    return applyFunctionValue(range, function, input);
+}
+
+Expression makeTupleOf(CodeRange range, std::initializer_list<Expression> items) {
+    const auto first = storage.expressions.count;
+    for (const auto& item : items) {
+        APPEND(storage.expressions, item);
+    }
+    const auto last = storage.expressions.count;
+    return makeEvaluatedTuple(range, EvaluatedTuple{Indices{first, last - first}});
+}
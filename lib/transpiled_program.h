@@ -0,0 +1,24 @@
+#pragma once
+
+// Functions used by programs that are transpiled to C++ by manglang_aot.
+// They are compiled and linked together with manglang_lib.
+
+#include <initializer_list>
+#include <stdio.h>
+
+#include "built_in_functions/container.h"
+#include "mang_lang.h"
+#include "numeric.h"
+#include "passes/evaluate.h"
+
+struct Operands {
+    Expression left;
+    Expression right;
+};
+
+Expression beginDictionary(Expression dictionary, Expression environment);
+// Applies a built-in function directly to the operands, and other functions to a tuple of them.
+Expression applyFunctionBinary(
+    CodeRange range, Expression function, Operands operands, bool is_proven
+);
+Expression makeTupleOf(CodeRange range, std::initializer_list<Expression> items);
@@ -0,0 +1,319 @@
+#include "workers.h"
+
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "factory.h"
+#include "jit.h"
+
+namespace {
+
+struct Workers {
+    size_t count;
+    bool is_worker;
+};
+
+Workers workers;
+
+// ENCODING BEGIN
+
+typedef std::vector<char> Bytes;
+
+template<typename T>
+void writeValue(Bytes& bytes, T value) {
+    const auto data = (const char*)&value;
+    bytes.insert(bytes.end(), data, data + sizeof(value));
+}
+
+template<typename T>
+T readValue(const char*& data) {
+    auto value = T{};
+    memcpy(&value, data, sizeof(value));
+    data += sizeof(value);
+    return value;
+}
+
+size_t countItems(Expression sequence) {
+    auto count = size_t{0};
+    while (sequence.type == EVALUATED_STACK || sequence.type == STRING) {
+        sequence = sequence.type == STRING ?
+            storage.strings.data[sequence.index].rest :
+            storage.evaluated_stacks.data[sequence.index].rest;
+        ++count;
+    }
+    return count;
+}
+
+// Returns false for values that only have a meaning in the storage of the worker.
+bool encode(Bytes& bytes, Expression value) {
+    writeValue(bytes, value.type);
+    switch (value.type) {
+        case NUMBER: writeValue(bytes, getNumber(value)); return true;
+        case INTEGER: writeValue(bytes, getInteger(value)); return true;
+        case CHARACTER: writeValue(bytes, getCharacter(value)); return true;
+        case YES: return true;
+        case NO: return true;
+        case EMPTY_STACK: return true;
+        case EMPTY_STRING: return true;
+        case EVALUATED_RANGE: writeValue(bytes, storage.evaluated_ranges.data[value.index]); return true;
+        case STRING: {
+            writeValue(bytes, countItems(value));
+            for (auto item = value; item.type == STRING;) {
+                const auto string = storage.strings.data[item.index];
+                if (!encode(bytes, string.top)) {
+                    return false;
+                }
+                item = string.rest;
+            }
+            return true;
+        }
+        case EVALUATED_STACK: {
+            writeValue(bytes, countItems(value));
+            for (auto item = value; item.type == EVALUATED_STACK;) {
+                const auto stack = storage.evaluated_stacks.data[item.index];
+                if (!encode(bytes, stack.top)) {
+                    return false;
+                }
+                item = stack.rest;
+            }
+            return true;
+        }
+        case EVALUATED_TUPLE: {
+            const auto indices = storage.evaluated_tuples.data[value.index].indices;
+            writeValue(bytes, indices.count);
+            FOR_EACH(i, indices) {
+                if (!encode(bytes, storage.expressions.data[i])) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        default: return false;
+    }
+}
+
+Expression decode(const char*& data);
+
+std::vector<Expression> decodeItems(const char*& data) {
+    const auto count = readValue<size_t>(data);
+    auto items = std::vector<Expression>{};
+    items.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        items.push_back(decode(data));
+    }
+    return items;
+}
+
+Expression decode(const char*& data) {
+    const auto type = readValue<ExpressionType>(data);
+    switch (type) {
+        case NUMBER: return makeNumber(CodeRange{}, readValue<Number>(data));
+        case INTEGER: return makeInteger(CodeRange{}, readValue<Integer>(data));
+        case CHARACTER: return makeCharacter(CodeRange{}, readValue<Character>(data));
+        case EVALUATED_RANGE: return makeEvaluatedRange(CodeRange{}, readValue<EvaluatedRange>(data));
+        case STRING: {
+            const auto items = decodeItems(data);
+            auto result = Expression{0, CodeRange{}, EMPTY_STRING};
+            for (auto it = items.rbegin(); it != items.rend(); ++it) {
+                result = makeString(CodeRange{}, String{*it, result});
+            }
+            return result;
+        }
+        case EVALUATED_STACK: {
+            const auto items = decodeItems(data);
+            auto result = Expression{0, CodeRange{}, EMPTY_STACK};
+            for (auto it = items.rbegin(); it != items.rend(); ++it) {
+                result = makeEvaluatedStack(CodeRange{}, EvaluatedStack{*it, result});
+            }
+            return result;
+        }
+        case EVALUATED_TUPLE: {
+            // The items are decoded before they are appended,
+            // since nested tuples append their own items.
+            const auto items = decodeItems(data);
+            const auto first = storage.expressions.count;
+            for (const auto& item : items) {
+                APPEND(storage.expressions, item);
+            }
+            return makeEvaluatedTuple(CodeRange{}, EvaluatedTuple{Indices{first, items.size()}});
+        }
+        default: return Expression{0, CodeRange{}, type};
+    }
+}
+
+// ENCODING END
+
+std::vector<Expression> evaluateTasksLocally(size_t count, const WorkerTask& task) {
+    auto results = std::vector<Expression>{};
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        results.push_back(task(i));
+    }
+    return results;
+}
+
+#ifdef _WIN32
+
+size_t processorCount() {
+    return 1;
+}
+
+std::vector<Expression> evaluateTasksInWorkers(size_t count, const WorkerTask& task) {
+    return evaluateTasksLocally(count, task);
+}
+
+#else
+
+size_t processorCount() {
+    const auto count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (size_t)count : 1;
+}
+
+struct Worker {
+    pid_t pid;
+    int pipe;
+    size_t task;
+};
+
+bool writeAll(int pipe, const Bytes& bytes) {
+    auto data = bytes.data();
+    auto count = bytes.size();
+    while (count > 0) {
+        const auto written = ::write(pipe, data, count);
+        if (written < 0 && errno == EINTR) {
+            continue;
+        }
+        if (written <= 0) {
+            return false;
+        }
+        data += written;
+        count -= (size_t)written;
+    }
+    return true;
+}
+
+// Runs in the forked process, which exits without returning,
+// so that it does not flush or free anything that it shares with the interpreter.
+[[noreturn]] void runWorker(int pipe, size_t task_index, const WorkerTask& task) {
+    workers.is_worker = true;
+    stopJitCompilation();
+    auto bytes = Bytes{};
+    const auto is_ok = encode(bytes, task(task_index));
+    _exit(is_ok && writeAll(pipe, bytes) ? 0 : 1);
+}
+
+bool startWorker(std::vector<Worker>& running, size_t task_index, const WorkerTask& task) {
+    int pipes[2];
+    if (pipe(pipes) != 0) {
+        return false;
+    }
+    const auto pid = fork();
+    if (pid < 0) {
+        close(pipes[0]);
+        close(pipes[1]);
+        return false;
+    }
+    if (pid == 0) {
+        close(pipes[0]);
+        runWorker(pipes[1], task_index, task);
+    }
+    close(pipes[1]);
+    running.push_back(Worker{pid, pipes[0], task_index});
+    return true;
+}
+
+// Returns true if the worker is done, after its pipe has been closed.
+bool readWorker(const Worker& worker, Bytes& bytes) {
+    char buffer[1 << 16];
+    const auto count = ::read(worker.pipe, buffer, sizeof(buffer));
+    if (count < 0 && errno == EINTR) {
+        return false;
+    }
+    if (count > 0) {
+        bytes.insert(bytes.end(), buffer, buffer + count);
+        return false;
+    }
+    return true;
+}
+
+bool finishWorker(const Worker& worker) {
+    close(worker.pipe);
+    auto status = 0;
+    while (waitpid(worker.pid, &status, 0) < 0 && errno == EINTR) {}
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+std::vector<Expression> evaluateTasksInWorkers(size_t count, const WorkerTask& task) {
+    auto outputs = std::vector<Bytes>(count);
+    auto is_done = std::vector<bool>(count, false);
+    auto running = std::vector<Worker>{};
+    auto polls = std::vector<pollfd>{};
+    auto next = size_t{0};
+    while (next < count || !running.empty()) {
+        while (next < count && running.size() < workers.count) {
+            if (!startWorker(running, next, task)) {
+                break;
+            }
+            ++next;
+        }
+        if (running.empty()) {
+            // Tasks that could not be started are evaluated by the interpreter.
+            break;
+        }
+        polls.clear();
+        for (const auto& worker : running) {
+            polls.push_back(pollfd{worker.pipe, POLLIN, 0});
+        }
+        if (poll(polls.data(), polls.size(), -1) < 0 && errno != EINTR) {
+            break;
+        }
+        for (size_t i = running.size(); i-- > 0;) {
+            if (polls[i].revents == 0) {
+                continue;
+            }
+            const auto worker = running[i];
+            if (readWorker(worker, outputs[worker.task])) {
+                is_done[worker.task] = finishWorker(worker);
+                running.erase(running.begin() + (std::ptrdiff_t)i);
+            }
+        }
+    }
+    for (const auto& worker : running) {
+        finishWorker(worker);
+    }
+    auto results = std::vector<Expression>{};
+    results.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const char* data = outputs[i].data();
+        results.push_back(is_done[i] ? decode(data) : task(i));
+    }
+    return results;
+}
+
+#endif
+
+} // namespace
+
+void setWorkerCount(size_t count) {
+    workers.count = count;
+}
+
+size_t getWorkerCount() {
+    if (workers.count == 0) {
+        workers.count = processorCount();
+    }
+    return workers.is_worker ? 1 : workers.count;
+}
+
+std::vector<Expression> evaluateTasks(size_t count, const WorkerTask& task) {
+    if (count < 2 || getWorkerCount() < 2) {
+        return evaluateTasksLocally(count, task);
+    }
+    return evaluateTasksInWorkers(count, task);
+}
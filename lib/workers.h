@@ -0,0 +1,25 @@
+#pragma once
+
+// Tasks are evaluated in worker processes that are forked from the interpreter.
+// Each worker gets a copy of the storage, so it can allocate without locks,
+// and sends its result back in a binary encoding that is decoded into the storage
+// of the interpreter, in the order of the tasks.
+// Results that can not be sent, like functions, tables and errors,
+// are evaluated again by the interpreter, as are tasks of workers that fail.
+// Changes that a task makes to tables that it did not create are lost.
+
+#include <stddef.h>
+
+#include <functional>
+#include <vector>
+
+#include "expression.h"
+
+typedef std::function<Expression(size_t task)> WorkerTask;
+
+// Zero gives one worker per processor. Without fork there is only one worker.
+void setWorkerCount(size_t count);
+size_t getWorkerCount();
+// Evaluates the tasks with indices 0 to count - 1 and returns their results.
+// A worker is given the next task when it is done, so the tasks can differ in cost.
+std::vector<Expression> evaluateTasks(size_t count, const WorkerTask& task);